@@ -0,0 +1,394 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_capture.h"
+
+#include <cmath>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CAPTURE_MAGIC[8] = {'E', 'S', 'P', '3', '2', 'L', 'C', 'F'};
+static const size_t HEADER_SIZE = 64;
+static const size_t SCHEMA_ENTRY_SIZE = 8;
+static const size_t INDEX_ENTRY_SIZE = 40;
+
+static void putLittleEndian(uint8_t* out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+static uint64_t getLittleEndian(const uint8_t* in, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+static size_t roundUp8(size_t value) {
+  return (value + 7) & ~static_cast<size_t>(7);
+}
+
+// The mapped columns are read in place, which needs a little-endian host.
+static bool hostIsLittleEndian() {
+  const uint16_t probe = 1;
+  uint8_t first;
+  memcpy(&first, &probe, 1);
+  return first == 1;
+}
+
+/* --------------------------------------------------------------------------
+   Writer
+   -------------------------------------------------------------------------- */
+
+LiveCaptureWriter::~LiveCaptureWriter() {
+  close();
+}
+
+bool LiveCaptureWriter::open(
+    const char* path,
+    const uint8_t* nums,
+    size_t count,
+    uint32_t blockRows) {
+
+  close();
+
+  if (count == 0 || count > 256 || blockRows == 0 || !hostIsLittleEndian()) {
+    return false;
+  }
+
+  file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  for (int16_t& entry : columnOf) {
+    entry = -1;
+  }
+
+  schema.assign(nums, nums + count);
+  columns.assign(count, std::vector<double>());
+  lastValues.assign(count, NAN);
+  for (size_t i = 0; i < count; ++i) {
+    columnOf[nums[i]] = static_cast<int16_t>(i);
+    columns[i].reserve(blockRows);
+  }
+
+  rowsPerBlock = blockRows;
+  totalRows = 0;
+  sampleIds.clear();
+  timestamps.clear();
+  indexBytes.clear();
+
+  // The header is rewritten by close(), once the offsets are known.
+  uint8_t header[HEADER_SIZE] = {};
+  std::vector<uint8_t> schemaEntries(count * SCHEMA_ENTRY_SIZE, 0);
+  for (size_t i = 0; i < count; ++i) {
+    schemaEntries[i * SCHEMA_ENTRY_SIZE] = nums[i];
+  }
+
+  schemaOffset = HEADER_SIZE;
+  ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+       fwrite(schemaEntries.data(), 1, schemaEntries.size(), file) ==
+           schemaEntries.size();
+  return ok;
+}
+
+bool LiveCaptureWriter::append(const LiveHostFrame& frame) {
+  if (file == nullptr || !ok) {
+    return false;
+  }
+
+  sampleIds.push_back(frame.sampleId);
+  timestamps.push_back(frame.timestampMs);
+  // A change-only frame leaves out the probes that kept their value.
+  for (size_t p = 0; p < columns.size(); ++p) {
+    columns[p].push_back(frame.changesOnly ? lastValues[p] : NAN);
+  }
+
+  for (size_t i = 0; i < frame.count; ++i) {
+    const int16_t position = columnOf[frame.nums[i]];
+    if (position >= 0) {
+      columns[position].back() = frame.values[i];
+    }
+  }
+
+  for (size_t p = 0; p < columns.size(); ++p) {
+    lastValues[p] = columns[p].back();
+  }
+
+  ++totalRows;
+
+  if (sampleIds.size() == rowsPerBlock) {
+    return writeBlock();
+  }
+  return true;
+}
+
+bool LiveCaptureWriter::writeBlock() {
+  const size_t rows = sampleIds.size();
+  if (rows == 0) {
+    return true;
+  }
+
+  const long offset = ftell(file);
+  if (offset < 0) {
+    ok = false;
+    return false;
+  }
+
+  static const uint8_t padding[8] = {};
+  const size_t idBytes = rows * sizeof(uint32_t);
+
+  ok = ok &&
+       fwrite(sampleIds.data(), 1, idBytes, file) == idBytes &&
+       fwrite(padding, 1, roundUp8(idBytes) - idBytes, file) ==
+           roundUp8(idBytes) - idBytes &&
+       fwrite(timestamps.data(), sizeof(uint64_t), rows, file) == rows;
+
+  for (const std::vector<double>& column : columns) {
+    ok = ok && fwrite(column.data(), sizeof(double), rows, file) == rows;
+  }
+
+  uint8_t entry[INDEX_ENTRY_SIZE] = {};
+  putLittleEndian(entry, sampleIds.front(), 4);
+  putLittleEndian(entry + 4, sampleIds.back(), 4);
+  putLittleEndian(entry + 8, timestamps.front(), 8);
+  putLittleEndian(entry + 16, timestamps.back(), 8);
+  putLittleEndian(entry + 24, static_cast<uint64_t>(offset), 8);
+  putLittleEndian(entry + 32, rows, 4);
+  indexBytes.insert(indexBytes.end(), entry, entry + INDEX_ENTRY_SIZE);
+
+  sampleIds.clear();
+  timestamps.clear();
+  for (std::vector<double>& column : columns) {
+    column.clear();
+  }
+  return ok;
+}
+
+bool LiveCaptureWriter::close() {
+  if (file == nullptr) {
+    return false;
+  }
+
+  writeBlock();
+
+  const long indexOffset = ftell(file);
+  ok = ok && indexOffset >= 0 &&
+       fwrite(indexBytes.data(), 1, indexBytes.size(), file) ==
+           indexBytes.size();
+
+  uint8_t header[HEADER_SIZE] = {};
+  memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+  putLittleEndian(header + 8, LIVE_CAPTURE_VERSION, 4);
+  putLittleEndian(header + 12, schema.size(), 4);
+  putLittleEndian(header + 16, rowsPerBlock, 4);
+  putLittleEndian(header + 20, indexBytes.size() / INDEX_ENTRY_SIZE, 4);
+  putLittleEndian(header + 24, totalRows, 8);
+  putLittleEndian(header + 32, schemaOffset, 8);
+  putLittleEndian(header + 40, static_cast<uint64_t>(indexOffset), 8);
+
+  ok = ok &&
+       fseek(file, 0, SEEK_SET) == 0 &&
+       fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+  ok = fclose(file) == 0 && ok;
+  file = nullptr;
+  return ok;
+}
+
+/* --------------------------------------------------------------------------
+   Reader
+   -------------------------------------------------------------------------- */
+
+LiveCaptureReader::~LiveCaptureReader() {
+  close();
+}
+
+void LiveCaptureReader::close() {
+  if (base != nullptr) {
+    munmap(const_cast<uint8_t*>(base), mappedBytes);
+  }
+  base = nullptr;
+  mappedBytes = 0;
+  probes = 0;
+  blocks = 0;
+  totalRows = 0;
+}
+
+bool LiveCaptureReader::open(const char* path) {
+  close();
+
+  if (!hostIsLittleEndian()) {
+    return false;
+  }
+
+  const int descriptor = ::open(path, O_RDONLY);
+  if (descriptor < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(descriptor, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < HEADER_SIZE) {
+    ::close(descriptor);
+    return false;
+  }
+
+  void* mapped = mmap(
+      nullptr,
+      static_cast<size_t>(info.st_size),
+      PROT_READ,
+      MAP_PRIVATE,
+      descriptor,
+      0);
+  ::close(descriptor);
+
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+
+  base = static_cast<const uint8_t*>(mapped);
+  mappedBytes = static_cast<size_t>(info.st_size);
+
+  const uint64_t schemaOffset = getLittleEndian(base + 32, 8);
+  const uint64_t indexOffset = getLittleEndian(base + 40, 8);
+  probes = static_cast<size_t>(getLittleEndian(base + 12, 4));
+  blocks = static_cast<size_t>(getLittleEndian(base + 20, 4));
+  totalRows = getLittleEndian(base + 24, 8);
+
+  const bool valid =
+      memcmp(base, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) == 0 &&
+      getLittleEndian(base + 8, 4) == LIVE_CAPTURE_VERSION &&
+      probes != 0 &&
+      schemaOffset + probes * SCHEMA_ENTRY_SIZE <= mappedBytes &&
+      indexOffset + blocks * INDEX_ENTRY_SIZE <= mappedBytes;
+
+  if (!valid) {
+    close();
+    return false;
+  }
+
+  schemaBytes = base + schemaOffset;
+  indexBytes = base + indexOffset;
+
+  // Every block must lie inside the file before it is handed out.
+  for (size_t i = 0; i < blocks; ++i) {
+    const uint8_t* entry = indexEntry(i);
+    const uint64_t offset = getLittleEndian(entry + 24, 8);
+    const uint64_t rows = getLittleEndian(entry + 32, 4);
+    const uint64_t bytes =
+        roundUp8(rows * sizeof(uint32_t)) + rows * 8 * (1 + probes);
+
+    if (offset % 8 != 0 || offset + bytes > indexOffset) {
+      close();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+uint8_t LiveCaptureReader::probeNum(size_t position) const {
+  return position < probes ? schemaBytes[position * SCHEMA_ENTRY_SIZE] : 0;
+}
+
+int LiveCaptureReader::probePosition(uint8_t num) const {
+  for (size_t i = 0; i < probes; ++i) {
+    if (schemaBytes[i * SCHEMA_ENTRY_SIZE] == num) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+const uint8_t* LiveCaptureReader::indexEntry(size_t index) const {
+  return indexBytes + index * INDEX_ENTRY_SIZE;
+}
+
+bool LiveCaptureReader::block(size_t index, LiveCaptureBlock& out) const {
+  if (index >= blocks) {
+    return false;
+  }
+
+  const uint8_t* entry = indexEntry(index);
+  const uint8_t* start = base + getLittleEndian(entry + 24, 8);
+  const uint32_t rows = static_cast<uint32_t>(getLittleEndian(entry + 32, 4));
+  const size_t idBytes = roundUp8(rows * sizeof(uint32_t));
+
+  out.rows = rows;
+  out.sampleIds = reinterpret_cast<const uint32_t*>(start);
+  out.timestamps = reinterpret_cast<const uint64_t*>(start + idBytes);
+  out.values = reinterpret_cast<const double*>(
+      start + idBytes + rows * sizeof(uint64_t));
+  return true;
+}
+
+size_t LiveCaptureReader::findBlockById(uint32_t sampleId) const {
+  size_t low = 0;
+  size_t high = blocks;
+
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+
+    if (getLittleEndian(indexEntry(middle) + 4, 4) < sampleId) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+size_t LiveCaptureReader::findBlockByTime(uint64_t timestampMs) const {
+  size_t low = 0;
+  size_t high = blocks;
+
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+
+    if (getLittleEndian(indexEntry(middle) + 16, 8) < timestampMs) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool LiveCaptureReader::locateId(
+    uint32_t sampleId,
+    size_t& blockIndex,
+    uint32_t& row) const {
+
+  blockIndex = findBlockById(sampleId);
+
+  LiveCaptureBlock found;
+  if (!block(blockIndex, found)) {
+    return false;
+  }
+
+  uint32_t low = 0;
+  uint32_t high = found.rows;
+
+  while (low < high) {
+    const uint32_t middle = low + (high - low) / 2;
+
+    if (found.sampleIds[middle] < sampleId) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  row = low;
+  return low < found.rows;
+}
@@ -0,0 +1,156 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Capture file format for recorded sessions. Frames are stored in blocks of
+// columns, one column per probe, followed by a block index keyed by
+// sample_id and timestamp. A reader maps the file and locates any sample by
+// binary search over the index, without parsing the rest of the session.
+//
+// All integers are little-endian. Offsets are from the start of the file.
+//
+//   File header (64 bytes)
+//     0    8   magic "ESP32LCF"
+//     8    4   format version (LIVE_CAPTURE_VERSION)
+//     12   4   probe count P
+//     16   4   rows per block B
+//     20   4   block count
+//     24   8   total rows
+//     32   8   schema offset
+//     40   8   index offset
+//     48   16  reserved, zero
+//
+//   Schema: P entries of 8 bytes
+//     0    1   probe number
+//     1    7   reserved, zero
+//
+//   Block of n rows (n <= B), 8-byte aligned
+//     sample_id   n * 4, padded to 8
+//     timestamp   n * 8
+//     values      P columns of n * 8 (IEEE-754 double, NaN when missing)
+//
+//   Index: one 40-byte entry per block, in file order
+//     0    4   first sample_id
+//     4    4   last sample_id
+//     8    8   first timestamp
+//     16   8   last timestamp
+//     24   8   block offset
+//     32   4   rows
+//     36   4   reserved, zero
+//
+// The writer expects sample_id and timestamp not to decrease, which holds
+// for live frames of one device session.
+//
+
+#pragma once
+
+#include "esp32_live_host.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+static const uint32_t LIVE_CAPTURE_VERSION = 1;
+
+/* --------------------------------------------------------------------------
+   Writer
+   -------------------------------------------------------------------------- */
+
+class LiveCaptureWriter {
+public:
+  ~LiveCaptureWriter();
+
+  // The schema is fixed for the file: probes not listed are ignored.
+  bool open(
+      const char* path,
+      const uint8_t* nums,
+      size_t count,
+      uint32_t blockRows = 4096);
+
+  bool append(const LiveHostFrame& frame);
+
+  // Writes the last block, the index and the final header.
+  bool close();
+
+private:
+  bool writeBlock();
+
+  FILE* file = nullptr;
+  uint32_t rowsPerBlock = 0;
+  uint64_t totalRows = 0;
+  uint64_t schemaOffset = 0;
+  int16_t columnOf[256] = {};
+  std::vector<uint8_t> schema;
+
+  std::vector<uint32_t> sampleIds;
+  std::vector<uint64_t> timestamps;
+  std::vector<std::vector<double>> columns;
+  std::vector<double> lastValues;
+  std::vector<uint8_t> indexBytes;
+  bool ok = false;
+};
+
+/* --------------------------------------------------------------------------
+   Reader
+   -------------------------------------------------------------------------- */
+
+// One block, pointing into the mapped file.
+struct LiveCaptureBlock {
+  uint32_t rows;
+  const uint32_t* sampleIds;
+  const uint64_t* timestamps;
+
+  // Column of probe position p: values + p * rows.
+  const double* values;
+};
+
+class LiveCaptureReader {
+public:
+  ~LiveCaptureReader();
+
+  // Maps the file read-only and validates the header and index.
+  bool open(const char* path);
+  void close();
+
+  size_t probeCount() const {
+    return probes;
+  }
+
+  uint8_t probeNum(size_t position) const;
+
+  // Position of a probe number in the schema, or -1.
+  int probePosition(uint8_t num) const;
+
+  size_t blockCount() const {
+    return blocks;
+  }
+
+  uint64_t rows() const {
+    return totalRows;
+  }
+
+  bool block(size_t index, LiveCaptureBlock& out) const;
+
+  // Block holding sampleId, or the first block after it. blockCount() when
+  // the identifier is past the end. Binary search over the index.
+  size_t findBlockById(uint32_t sampleId) const;
+
+  // Block holding timestampMs, or the first block after it.
+  size_t findBlockByTime(uint64_t timestampMs) const;
+
+  // Block and row of the first sample at or after sampleId.
+  bool locateId(uint32_t sampleId, size_t& blockIndex, uint32_t& row) const;
+
+private:
+  const uint8_t* indexEntry(size_t index) const;
+
+  const uint8_t* base = nullptr;
+  size_t mappedBytes = 0;
+  size_t probes = 0;
+  size_t blocks = 0;
+  uint64_t totalRows = 0;
+  const uint8_t* schemaBytes = nullptr;
+  const uint8_t* indexBytes = nullptr;
+};
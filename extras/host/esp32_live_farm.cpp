@@ -0,0 +1,279 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_farm.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+   Devices
+   -------------------------------------------------------------------------- */
+
+// Simulated hardware probes are inputs.
+static const char* configOf(const LiveFarmProbe& probe) {
+  return probe.kind == LIVE_REFERENCE_ANALOG ? "ANALOG" : "DIGITAL";
+}
+
+// Virtual probes send the name of their variable instead of a direction.
+static const char* directionOf(const LiveFarmProbe& probe) {
+  return probe.kind == LIVE_REFERENCE_VIRTUAL_FLOAT ||
+                 probe.kind == LIVE_REFERENCE_VIRTUAL_INT
+             ? "simulated"
+             : "IN";
+}
+
+bool LiveFarmDevice::configure(const LiveFarmDeviceConfig& config) {
+  if (config.probes.empty() || config.intervalMs == 0 || config.mtu < 23) {
+    return false;
+  }
+
+  settings = config;
+  counters = LiveFarmDeviceStats();
+  nextSampleId = 0;
+  nextMs = 0;
+  burstLeft = 0;
+  state = config.seed != 0 ? config.seed : 1;
+
+  // Widths are measured on the worst-case text, as currentChunkPlan() does.
+  std::vector<uint16_t> widths;
+  for (const LiveFarmProbe& probe : settings.probes) {
+    widths.push_back(liveReferenceProbeWidth(
+        probe.num, probe.kind, configOf(probe), directionOf(probe), "hw"));
+  }
+
+  const size_t mtuPayload = static_cast<size_t>(settings.mtu) - 3;
+  liveBuildChunkPlan(
+      plan,
+      liveReferenceHeaderWidth(false),
+      widths.data(),
+      widths.size(),
+      mtuPayload < LIVE_FARM_CHUNK_LIMIT ? mtuPayload : LIVE_FARM_CHUNK_LIMIT);
+
+  values.assign(settings.probes.size(), 0.0);
+  for (size_t i = 0; i < values.size(); ++i) {
+    switch (settings.probes[i].kind) {
+      case LIVE_REFERENCE_VIRTUAL_FLOAT:
+        values[i] = (random() % 100000) / 1000.0;
+        break;
+      case LIVE_REFERENCE_VIRTUAL_INT:
+        values[i] = random() % 1000;
+        break;
+      case LIVE_REFERENCE_ANALOG:
+        values[i] = random() % 4096;
+        break;
+      case LIVE_REFERENCE_DIGITAL:
+        values[i] = random() & 1;
+        break;
+    }
+  }
+  return true;
+}
+
+// xorshift32: cheap, and reproducible from the configured seed.
+uint32_t LiveFarmDevice::random() {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+bool LiveFarmDevice::loseChunk() {
+  if (burstLeft > 0) {
+    --burstLeft;
+    return true;
+  }
+
+  if (settings.lossRate > 0.0 &&
+      random() < settings.lossRate * 4294967296.0) {
+    burstLeft = settings.burstLength > 0 ? settings.burstLength - 1 : 0;
+    return true;
+  }
+  return false;
+}
+
+void LiveFarmDevice::advanceValues() {
+  for (size_t i = 0; i < values.size(); ++i) {
+    double& value = values[i];
+    const int step = static_cast<int>(random() % 201) - 100;
+
+    switch (settings.probes[i].kind) {
+      case LIVE_REFERENCE_VIRTUAL_FLOAT:
+        value += step / 100.0;
+        if (value < 0.0 || value > 100.0) {
+          value -= 2 * step / 100.0;
+        }
+        break;
+      case LIVE_REFERENCE_VIRTUAL_INT:
+        value += 1;
+        break;
+      case LIVE_REFERENCE_ANALOG:
+        value += step / 4;
+        if (value < 0 || value > 4095) {
+          value -= 2 * (step / 4);
+        }
+        break;
+      case LIVE_REFERENCE_DIGITAL:
+        if ((random() & 15) == 0) {
+          value = 1 - value;
+        }
+        break;
+    }
+  }
+}
+
+void LiveFarmDevice::appendProbe(size_t index) {
+  const LiveFarmProbe& probe = settings.probes[index];
+  const double value = values[index];
+
+  char valueText[32];
+  char voltageText[32] = "0";
+
+  switch (probe.kind) {
+    case LIVE_REFERENCE_VIRTUAL_FLOAT:
+      liveReferenceDecimal(valueText, sizeof(valueText), value, 3);
+      break;
+    case LIVE_REFERENCE_VIRTUAL_INT:
+      snprintf(valueText, sizeof(valueText), "%d", static_cast<int>(value));
+      break;
+    case LIVE_REFERENCE_ANALOG:
+      snprintf(valueText, sizeof(valueText), "%d", static_cast<int>(value));
+      liveReferenceDecimal(
+          voltageText, sizeof(voltageText), 3.3 * value / 4095.0, 6);
+      break;
+    case LIVE_REFERENCE_DIGITAL:
+      snprintf(valueText, sizeof(valueText), "%d", static_cast<int>(value));
+      if (value != 0.0) {
+        strcpy(voltageText, "3.3");
+      }
+      break;
+  }
+
+  liveReferenceProbe(
+      chunk,
+      probe.num,
+      probe.kind,
+      configOf(probe),
+      directionOf(probe),
+      "hw",
+      valueText,
+      voltageText);
+}
+
+void LiveFarmDevice::sample(const Sender& send) {
+  const uint32_t sampleId = ++nextSampleId;
+  const uint64_t timestampMs = nextMs;
+  nextMs += settings.intervalMs;
+
+  char timestamp[24];
+  char rate[12];
+  char id[12];
+  snprintf(timestamp, sizeof(timestamp), "%llu",
+           static_cast<unsigned long long>(timestampMs));
+  snprintf(rate, sizeof(rate), "%u", static_cast<unsigned>(settings.intervalMs));
+  snprintf(id, sizeof(id), "%u", static_cast<unsigned>(sampleId));
+
+  const size_t chunks = plan.chunkCount();
+  bool delivered = true;
+
+  for (size_t index = 0; index < chunks; ++index) {
+    char seq[8];
+    snprintf(seq, sizeof(seq), "%u", static_cast<unsigned>(index));
+
+    chunk.clear();
+    liveReferenceHeader(
+        chunk, timestamp, rate, nullptr, id, seq, index + 1 == chunks);
+
+    for (size_t probe = plan.starts[index];
+         probe < plan.starts[index + 1];
+         ++probe) {
+      if (probe != plan.starts[index]) {
+        chunk += ',';
+      }
+      appendProbe(probe);
+    }
+    chunk += "]}";
+
+    ++counters.chunks;
+    if (loseChunk()) {
+      ++counters.droppedChunks;
+      delivered = false;
+      continue;
+    }
+    send(chunk.data(), chunk.size());
+  }
+
+  ++counters.frames;
+  if (delivered) {
+    ++counters.deliveredFrames;
+  }
+  advanceValues();
+}
+
+/* --------------------------------------------------------------------------
+   Loopback transport
+   -------------------------------------------------------------------------- */
+
+LiveFarmLoopback::LiveFarmLoopback(size_t receivers, size_t capacity)
+    : queues(receivers > 0 ? receivers : 1),
+      limit(capacity > 0 ? capacity : 1) {}
+
+void LiveFarmLoopback::send(uint32_t device, const char* data, size_t length) {
+  Queue& queue = queues[device % queues.size()];
+  std::unique_lock<std::mutex> guard(queue.lock);
+
+  queue.changed.wait(guard, [&] {
+    return queue.items.size() < limit || queue.closed;
+  });
+  if (queue.closed) {
+    return;
+  }
+
+  // Only a receiver waiting on an empty queue needs waking.
+  const bool wasEmpty = queue.items.empty();
+  queue.items.push_back(LiveFarmNotification{device, std::string(data, length)});
+  guard.unlock();
+
+  if (wasEmpty) {
+    queue.changed.notify_all();
+  }
+}
+
+bool LiveFarmLoopback::receive(
+    size_t receiver,
+    std::vector<LiveFarmNotification>& batch,
+    size_t max) {
+
+  Queue& queue = queues[receiver];
+  std::unique_lock<std::mutex> guard(queue.lock);
+
+  queue.changed.wait(guard, [&] {
+    return !queue.items.empty() || queue.closed;
+  });
+
+  const bool wasFull = queue.items.size() >= limit;
+
+  batch.clear();
+  while (!queue.items.empty() && batch.size() < max) {
+    batch.push_back(std::move(queue.items.front()));
+    queue.items.pop_front();
+  }
+  guard.unlock();
+
+  if (wasFull) {
+    queue.changed.notify_all();
+  }
+  return !batch.empty();
+}
+
+void LiveFarmLoopback::close() {
+  for (Queue& queue : queues) {
+    {
+      std::lock_guard<std::mutex> guard(queue.lock);
+      queue.closed = true;
+    }
+    queue.changed.notify_all();
+  }
+}
@@ -0,0 +1,143 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Simulated devices for load-testing receivers and gateways. Each virtual
+// device owns a probe set, a sampling interval and a loss pattern, and
+// produces the notify chunks a board would send: the chunk layout comes
+// from the library's own chunk plan (src/esp32_live_plan.cpp) and the text
+// from the reference encoder (esp32_live_reference.h).
+//
+// Devices run on simulated time, so a farm of hundreds of boards can be
+// driven as fast as the receiver under test consumes it. The loopback
+// transport hands the chunks to receiver threads.
+//
+
+#pragma once
+
+#include "../../src/esp32_live_plan.h"
+#include "esp32_live_reference.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Chunk limit of the device, BLE_CHUNK_LIMIT in esp32_live.h.
+static const size_t LIVE_FARM_CHUNK_LIMIT = 240;
+
+/* --------------------------------------------------------------------------
+   Devices
+   -------------------------------------------------------------------------- */
+
+struct LiveFarmProbe {
+  uint8_t num;
+  LiveReferenceKind kind;
+};
+
+struct LiveFarmDeviceConfig {
+  std::vector<LiveFarmProbe> probes;
+  uint32_t intervalMs = 50;
+  uint16_t mtu = 247;
+
+  // Chance that a chunk starts a loss burst, and the chunks lost per burst.
+  // burstLength 1 gives independent random loss.
+  double lossRate = 0.0;
+  uint32_t burstLength = 1;
+
+  uint32_t seed = 1;
+};
+
+struct LiveFarmDeviceStats {
+  uint64_t frames = 0;
+  uint64_t chunks = 0;
+  uint64_t droppedChunks = 0;
+
+  // Frames whose chunks all reached the transport.
+  uint64_t deliveredFrames = 0;
+};
+
+class LiveFarmDevice {
+public:
+  using Sender = std::function<void(const char* data, size_t length)>;
+
+  bool configure(const LiveFarmDeviceConfig& config);
+
+  // Time of the next sample, in simulated milliseconds.
+  uint64_t nextSampleMs() const {
+    return nextMs;
+  }
+
+  // Captures one snapshot, advances the probe values and passes every chunk
+  // that survives the loss pattern to send.
+  void sample(const Sender& send);
+
+  const LiveFarmDeviceStats& stats() const {
+    return counters;
+  }
+
+private:
+  uint32_t random();
+  bool loseChunk();
+  void advanceValues();
+  void appendProbe(size_t index);
+
+  LiveFarmDeviceConfig settings;
+  LiveChunkPlan plan;
+  LiveFarmDeviceStats counters;
+
+  std::vector<double> values;
+  std::string chunk;
+  uint32_t nextSampleId = 0;
+  uint64_t nextMs = 0;
+  uint32_t state = 1;
+  uint32_t burstLeft = 0;
+};
+
+/* --------------------------------------------------------------------------
+   Loopback transport
+   -------------------------------------------------------------------------- */
+
+struct LiveFarmNotification {
+  uint32_t device;
+  std::string payload;
+};
+
+// One bounded queue per receiver thread. Device d is always served by
+// receiver d % receivers, so its chunks stay in order.
+class LiveFarmLoopback {
+public:
+  LiveFarmLoopback(size_t receivers, size_t capacity);
+
+  // Blocks while the receiver's queue is full.
+  void send(uint32_t device, const char* data, size_t length);
+
+  // Moves up to max notifications into batch. Blocks until one is queued;
+  // returns false once the transport is closed and the queue is empty.
+  bool receive(
+      size_t receiver,
+      std::vector<LiveFarmNotification>& batch,
+      size_t max);
+
+  void close();
+
+  size_t receivers() const {
+    return queues.size();
+  }
+
+private:
+  struct Queue {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<LiveFarmNotification> items;
+    bool closed = false;
+  };
+
+  std::vector<Queue> queues;
+  size_t limit;
+};
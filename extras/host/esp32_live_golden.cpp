@@ -0,0 +1,138 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_golden.h"
+
+#include <fstream>
+
+/* --------------------------------------------------------------------------
+   Cases
+   -------------------------------------------------------------------------- */
+
+static const std::vector<GoldenProbe> MIXED = {
+    {2, LIVE_REFERENCE_DIGITAL, "DIGITAL", "OUT", "hw", false},
+    {4, LIVE_REFERENCE_DIGITAL, "DIGITAL", "IN", "hw", false},
+    {25, LIVE_REFERENCE_ANALOG, "ANALOG", "OUT", "dac", false},
+    {34, LIVE_REFERENCE_ANALOG, "ANALOG", "IN", "hw", false},
+    {200, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "temperature", "", false},
+    {201, LIVE_REFERENCE_VIRTUAL_INT, "", "loopCount", "", false},
+    {202, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "setpoint", "", false},
+};
+
+static const std::vector<GoldenProbe> VIRTUAL = {
+    {100, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "ax", "", false},
+    {101, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "ay", "", false},
+    {102, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "az", "", false},
+    {103, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "gx", "", false},
+    {104, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "gy", "", false},
+    {105, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "gz", "", false},
+    {106, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "roll", "", false},
+    {107, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "pitch", "", false},
+    {108, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "yaw", "", false},
+    {109, LIVE_REFERENCE_VIRTUAL_INT, "", "motorLeft", "", false},
+    {110, LIVE_REFERENCE_VIRTUAL_INT, "", "motorRight", "", false},
+    {111, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "batteryVoltage", "", false},
+};
+
+static const std::vector<GoldenProbe> QUANTIZED = {
+    {210, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "", "", true},
+    {211, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "", "", true},
+    {212, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "", "", true},
+    {213, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "", "", true},
+    {214, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "", "", true},
+    {215, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "", "", true},
+    {216, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "", "", true},
+    {217, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "", "", true},
+    {220, LIVE_REFERENCE_VIRTUAL_FLOAT, "", "current", "", false},
+    {221, LIVE_REFERENCE_VIRTUAL_INT, "", "faults", "", false},
+};
+
+static const std::vector<GoldenProbe> ULP = {
+    {4, LIVE_REFERENCE_DIGITAL, "DIGITAL", "IN", "hw", false},
+    {7, LIVE_REFERENCE_ANALOG, "ANALOG", "IN", "hw", false},
+};
+
+std::vector<GoldenCase> liveGoldenCases() {
+  return {
+      // The default BLE_CHUNK_LIMIT, a limit below one header and probe,
+      // where every probe is sent alone, and a 517-byte MTU.
+      {"mixed_240", &MIXED, 240, false, nullptr, nullptr, 3, {}},
+      {"mixed_120", &MIXED, 120, false, nullptr, nullptr, 2, {}},
+      {"mixed_temp_514", &MIXED, 514, true, nullptr, nullptr, 3, {}},
+      {"virtual_240", &VIRTUAL, 240, false, nullptr, nullptr, 2, {}},
+      {"virtual_500", &VIRTUAL, 500, false, nullptr, nullptr, 2, {}},
+      {"quantized_240", &QUANTIZED, 240, false, nullptr, nullptr, 3, {}},
+      {"quantized_100", &QUANTIZED, 100, false, nullptr, nullptr, 2, {}},
+      // Partial frames: the plan covers only the probes present and counts
+      // the tag in the header. A change-only frame may carry no probe.
+      {"changes_240", &MIXED, 240, false, "changes", nullptr, 4,
+       {{1, 4}, {}, {0, 1, 2, 3, 4, 5, 6}, {6}}},
+      {"blackbox_240", &MIXED, 240, false, "blackbox", "panic", 2, {}},
+      {"ulp_240", &ULP, 240, false, "ulp", nullptr, 3, {}},
+  };
+}
+
+std::vector<size_t> liveGoldenPresent(const GoldenCase& golden, size_t frame) {
+  if (!golden.subsets.empty()) {
+    return golden.subsets[frame];
+  }
+
+  std::vector<size_t> present;
+  for (size_t i = 0; i < golden.probes->size(); ++i) {
+    present.push_back(i);
+  }
+  return present;
+}
+
+/* --------------------------------------------------------------------------
+   Values
+   -------------------------------------------------------------------------- */
+
+static const float FLOAT_VALUES[] = {
+    0.0f, 3.14159f, -12.5f, 99.999f, -0.25f, 25.0f, 65535.123f, 0.001f};
+static const int32_t INT_VALUES[] = {0, -1, INT32_MAX, INT32_MIN, 42};
+static const unsigned ANALOG_VALUES[] = {0, 4095, 2048, 1, 1234};
+static const unsigned CODES[] = {0, 65535, 4095, 1, 32768};
+
+uint64_t liveGoldenTimestamp(size_t frame) {
+  return 86400000ULL + frame * 50ULL;
+}
+
+uint32_t liveGoldenSampleId(size_t frame) {
+  return static_cast<uint32_t>(1000 + frame);
+}
+
+float liveGoldenFloat(size_t pick) {
+  return FLOAT_VALUES[pick % 8];
+}
+
+int32_t liveGoldenInt(size_t pick) {
+  return INT_VALUES[pick % 5];
+}
+
+unsigned liveGoldenAnalog(size_t pick) {
+  return ANALOG_VALUES[pick % 5];
+}
+
+unsigned liveGoldenDigital(size_t pick) {
+  return static_cast<unsigned>(pick & 1);
+}
+
+unsigned liveGoldenCode(size_t pick) {
+  return CODES[pick % 5];
+}
+
+bool liveGoldenRead(const std::string& path, std::vector<std::string>& out) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    out.push_back(line);
+  }
+  return true;
+}
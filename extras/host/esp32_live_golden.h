@@ -0,0 +1,72 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Cases of the golden frames in golden/: the probe sets, chunk limits and
+// frames, and the value every probe carries in every frame. Shared by
+// test_golden, which renders them with the reference encoder, and
+// test_device_json, which renders them with the device serializer.
+//
+
+#pragma once
+
+#include "esp32_live_reference.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+struct GoldenProbe {
+  unsigned num;
+  LiveReferenceKind kind;
+  // Registration strings. direction is the variable name of a virtual
+  // probe; config and src are ignored for virtual probes.
+  const char* config;
+  const char* direction;
+  const char* src;
+  bool quantized;
+};
+
+struct GoldenCase {
+  const char* name;
+  const std::vector<GoldenProbe>* probes;
+  size_t limit;
+  bool temp;
+  const char* tagKey;
+  const char* tagValue;
+  size_t frames;
+  // Probes present in each frame of a partial case, as positions in
+  // probes. Empty: every frame carries every probe.
+  std::vector<std::vector<size_t>> subsets;
+};
+
+std::vector<GoldenCase> liveGoldenCases();
+
+// Positions in golden.probes of the probes present in one frame.
+std::vector<size_t> liveGoldenPresent(const GoldenCase& golden, size_t frame);
+
+// Header fields of one frame. The rate is 50 ms and the chip temperature,
+// when sent, 41.5.
+static const uint32_t LIVE_GOLDEN_RATE_MS = 50;
+static const float LIVE_GOLDEN_TEMPERATURE = 41.5f;
+
+uint64_t liveGoldenTimestamp(size_t frame);
+uint32_t liveGoldenSampleId(size_t frame);
+
+// Values are computed as the device holds them: virtual floats are floats,
+// analog probes carry the ADC count and digital probes the level. pick is
+// liveGoldenPick() of the frame and of the probe position.
+inline size_t liveGoldenPick(size_t frame, size_t position) {
+  return frame * 3 + position;
+}
+
+float liveGoldenFloat(size_t pick);
+int32_t liveGoldenInt(size_t pick);
+unsigned liveGoldenAnalog(size_t pick);
+unsigned liveGoldenDigital(size_t pick);
+unsigned liveGoldenCode(size_t pick);
+
+// Chunks of one golden file, one per line.
+bool liveGoldenRead(const std::string& path, std::vector<std::string>& out);
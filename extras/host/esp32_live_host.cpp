@@ -0,0 +1,615 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_host.h"
+
+#include "../../src/esp32_live_compact.h"
+#include "../../src/esp32_live_quant.h"
+
+#include <charconv>
+#include <cmath>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+   Chunk scanner
+   -------------------------------------------------------------------------- */
+
+// A minimal scanner for the chunk objects the library emits. It reads the
+// few fields it needs straight from the payload and skips everything else,
+// which keeps decoding far cheaper than building a document.
+namespace {
+
+struct Scanner {
+  const char* cursor;
+  const char* end;
+
+  void skipSpace() {
+    while (cursor < end &&
+           (*cursor == ' ' || *cursor == '\t' ||
+            *cursor == '\r' || *cursor == '\n')) {
+      ++cursor;
+    }
+  }
+
+  bool consume(char expected) {
+    skipSpace();
+    if (cursor < end && *cursor == expected) {
+      ++cursor;
+      return true;
+    }
+    return false;
+  }
+
+  bool peek(char expected) {
+    skipSpace();
+    return cursor < end && *cursor == expected;
+  }
+
+  // Key of the next member, without quotes. Keys never contain escapes.
+  bool key(const char*& name, size_t& length) {
+    if (!consume('"')) {
+      return false;
+    }
+
+    name = cursor;
+    while (cursor < end && *cursor != '"') {
+      ++cursor;
+    }
+    if (cursor == end) {
+      return false;
+    }
+
+    length = static_cast<size_t>(cursor - name);
+    ++cursor;
+    return consume(':');
+  }
+
+  bool number(double& value) {
+    skipSpace();
+    const std::from_chars_result result =
+        std::from_chars(cursor, end, value);
+    if (result.ec != std::errc()) {
+      return false;
+    }
+    cursor = result.ptr;
+    return true;
+  }
+
+  template <typename T>
+  bool integer(T& value) {
+    skipSpace();
+    const std::from_chars_result result =
+        std::from_chars(cursor, end, value);
+    if (result.ec != std::errc()) {
+      return false;
+    }
+    cursor = result.ptr;
+    return true;
+  }
+
+  bool boolean(bool& value) {
+    skipSpace();
+    if (end - cursor >= 4 && memcmp(cursor, "true", 4) == 0) {
+      value = true;
+      cursor += 4;
+      return true;
+    }
+    if (end - cursor >= 5 && memcmp(cursor, "false", 5) == 0) {
+      value = false;
+      cursor += 5;
+      return true;
+    }
+    return false;
+  }
+
+  // String without escapes, such as a units label.
+  bool string(std::string& value) {
+    if (!consume('"')) {
+      return false;
+    }
+    const char* start = cursor;
+    while (cursor < end && *cursor != '"') {
+      ++cursor;
+    }
+    if (cursor == end) {
+      return false;
+    }
+    value.assign(start, cursor);
+    ++cursor;
+    return true;
+  }
+
+  bool skipString() {
+    if (!consume('"')) {
+      return false;
+    }
+    while (cursor < end && *cursor != '"') {
+      cursor += *cursor == '\\' ? 2 : 1;
+    }
+    if (cursor >= end) {
+      return false;
+    }
+    ++cursor;
+    return true;
+  }
+
+  bool skipValue() {
+    skipSpace();
+    if (cursor == end) {
+      return false;
+    }
+
+    if (*cursor == '"') {
+      return skipString();
+    }
+
+    if (*cursor == '{' || *cursor == '[') {
+      int depth = 0;
+      while (cursor < end) {
+        if (*cursor == '"') {
+          if (!skipString()) {
+            return false;
+          }
+          continue;
+        }
+        if (*cursor == '{' || *cursor == '[') {
+          ++depth;
+        } else if (*cursor == '}' || *cursor == ']') {
+          if (--depth == 0) {
+            ++cursor;
+            return true;
+          }
+        }
+        ++cursor;
+      }
+      return false;
+    }
+
+    // Number or literal.
+    while (cursor < end && *cursor != ',' && *cursor != '}' &&
+           *cursor != ']') {
+      ++cursor;
+    }
+    return true;
+  }
+};
+
+bool keyIs(const char* name, size_t length, const char* expected) {
+  return strlen(expected) == length && memcmp(name, expected, length) == 0;
+}
+
+}
+
+/* --------------------------------------------------------------------------
+   Reassembly
+   -------------------------------------------------------------------------- */
+
+void LiveHostDecoder::reset() {
+  pending = false;
+  haveLastId = false;
+  counters = LiveHostStats();
+  nums.clear();
+  values.clear();
+
+  for (LiveHostSchema& declaration : schemas) {
+    declaration = LiveHostSchema();
+  }
+}
+
+void LiveHostDecoder::track(uint32_t sampleId) {
+  if (haveLastId) {
+    if (sampleId < lastId) {
+      ++counters.restarts;
+    } else if (sampleId > lastId + 1) {
+      const uint32_t missing = sampleId - lastId - 1;
+      ++counters.gaps;
+      counters.missingSamples += missing;
+
+      if (gapHandler) {
+        gapHandler(lastId + 1, missing);
+      }
+    }
+  }
+
+  haveLastId = true;
+  lastId = sampleId;
+}
+
+void LiveHostDecoder::beginFrame(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    bool replayed,
+    bool changesOnly) {
+
+  pending = true;
+  pendingId = sampleId;
+  pendingTimestampMs = timestampMs;
+  pendingComplete = true;
+  pendingReplayed = replayed;
+  pendingChangesOnly = changesOnly;
+  nextSeq = 0;
+  nums.clear();
+  values.clear();
+
+  if (!replayed) {
+    track(sampleId);
+  }
+}
+
+void LiveHostDecoder::deliver() {
+  pending = false;
+  ++counters.frames;
+  counters.values += values.size();
+
+  if (!pendingComplete) {
+    ++counters.incompleteFrames;
+  }
+
+  if (!frameHandler) {
+    return;
+  }
+
+  LiveHostFrame frame;
+  frame.sampleId = pendingId;
+  frame.timestampMs = pendingTimestampMs;
+  frame.nums = nums.data();
+  frame.values = values.data();
+  frame.count = values.size();
+  frame.complete = pendingComplete;
+  frame.replayed = pendingReplayed;
+  frame.changesOnly = pendingChangesOnly;
+  frameHandler(frame);
+}
+
+void LiveHostDecoder::flush() {
+  if (pending) {
+    pendingComplete = false;
+    deliver();
+  }
+}
+
+bool LiveHostDecoder::pushChunk(const uint8_t* data, size_t length) {
+  ++counters.chunks;
+
+  Scanner scanner{
+      reinterpret_cast<const char*>(data),
+      reinterpret_cast<const char*>(data) + length};
+
+  uint32_t sampleId = 0;
+  uint64_t timestampMs = 0;
+  uint16_t seq = 0;
+  bool last = false;
+  bool replayed = false;
+  bool changesOnly = false;
+  bool haveId = false;
+  const char* pinsStart = nullptr;
+  const char* pinsEnd = nullptr;
+
+  // First pass over the members: the probe array may come before or after
+  // the header fields, so it is only located here.
+  if (!scanner.consume('{')) {
+    ++counters.malformedChunks;
+    return false;
+  }
+
+  while (!scanner.peek('}')) {
+    const char* name = nullptr;
+    size_t nameLength = 0;
+    bool ok = scanner.key(name, nameLength);
+
+    if (ok && keyIs(name, nameLength, "sample_id")) {
+      ok = scanner.integer(sampleId);
+      haveId = ok;
+    } else if (ok && keyIs(name, nameLength, "timestamp")) {
+      ok = scanner.integer(timestampMs);
+    } else if (ok && keyIs(name, nameLength, "seq")) {
+      ok = scanner.integer(seq);
+    } else if (ok && keyIs(name, nameLength, "last")) {
+      ok = scanner.boolean(last);
+    } else if (ok && keyIs(name, nameLength, "pins")) {
+      scanner.skipSpace();
+      pinsStart = scanner.cursor;
+      ok = scanner.skipValue();
+      pinsEnd = scanner.cursor;
+    } else if (ok && (keyIs(name, nameLength, "blackbox") ||
+                      keyIs(name, nameLength, "ulp"))) {
+      replayed = true;
+      ok = scanner.skipValue();
+    } else if (ok && keyIs(name, nameLength, "changes")) {
+      changesOnly = true;
+      ok = scanner.skipValue();
+    } else if (ok) {
+      ok = scanner.skipValue();
+    }
+
+    if (!ok || (!scanner.consume(',') && !scanner.peek('}'))) {
+      ++counters.malformedChunks;
+      return false;
+    }
+  }
+
+  if (!haveId || pinsStart == nullptr) {
+    ++counters.malformedChunks;
+    return false;
+  }
+
+  // A chunk of another frame ends the pending one, complete or not.
+  if (pending && (pendingId != sampleId || seq == 0)) {
+    pendingComplete = false;
+    deliver();
+  }
+
+  if (!pending) {
+    beginFrame(sampleId, timestampMs, replayed, changesOnly);
+    if (seq != 0) {
+      pendingComplete = false;
+    }
+  } else if (seq != nextSeq) {
+    pendingComplete = false;
+  }
+  nextSeq = static_cast<uint16_t>(seq + 1);
+
+  Scanner pins{pinsStart, pinsEnd};
+  pins.consume('[');
+
+  while (pins.consume('{')) {
+    int num = -1;
+    double value = NAN;
+    uint32_t code = 0;
+    bool quantized = false;
+
+    while (!pins.peek('}')) {
+      const char* name = nullptr;
+      size_t nameLength = 0;
+      bool ok = pins.key(name, nameLength);
+
+      if (ok && keyIs(name, nameLength, "num")) {
+        ok = pins.integer(num);
+      } else if (ok && keyIs(name, nameLength, "value")) {
+        ok = pins.number(value);
+      } else if (ok && keyIs(name, nameLength, "q")) {
+        ok = pins.integer(code);
+        quantized = true;
+      } else if (ok) {
+        ok = pins.skipValue();
+      }
+
+      if (!ok || (!pins.consume(',') && !pins.peek('}'))) {
+        ++counters.malformedChunks;
+        pendingComplete = false;
+        return false;
+      }
+    }
+    pins.consume('}');
+    pins.consume(',');
+
+    if (num >= 0 && num <= 255 && quantized) {
+      const LiveHostSchema& declaration = schemas[num];
+      if (declaration.bits > 0) {
+        value = liveDequantize(
+            code, declaration.minimum, declaration.maximum, declaration.bits);
+      } else {
+        ++counters.unscaledValues;
+      }
+    }
+
+    if (num >= 0 && num <= 255) {
+      nums.push_back(static_cast<uint8_t>(num));
+      values.push_back(value);
+    }
+  }
+
+  if (last) {
+    deliver();
+  }
+  return true;
+}
+
+/* --------------------------------------------------------------------------
+   Events
+   -------------------------------------------------------------------------- */
+
+bool LiveHostDecoder::pushEvent(const uint8_t* data, size_t length) {
+  Scanner scanner{
+      reinterpret_cast<const char*>(data),
+      reinterpret_cast<const char*>(data) + length};
+
+  if (!scanner.consume('{')) {
+    return false;
+  }
+
+  bool isSchema = false;
+  int num = -1;
+  int bits = -1;
+  LiveHostSchema declaration;
+
+  while (!scanner.peek('}')) {
+    const char* name = nullptr;
+    size_t nameLength = 0;
+    bool ok = scanner.key(name, nameLength);
+
+    if (ok && keyIs(name, nameLength, "event")) {
+      std::string event;
+      ok = scanner.string(event);
+      isSchema = event == "schema";
+    } else if (ok && keyIs(name, nameLength, "num")) {
+      ok = scanner.integer(num);
+    } else if (ok && keyIs(name, nameLength, "bits")) {
+      ok = scanner.integer(bits);
+    } else if (ok && keyIs(name, nameLength, "min")) {
+      ok = scanner.number(declaration.minimum);
+    } else if (ok && keyIs(name, nameLength, "max")) {
+      ok = scanner.number(declaration.maximum);
+    } else if (ok && keyIs(name, nameLength, "units")) {
+      ok = scanner.string(declaration.units);
+    } else if (ok) {
+      ok = scanner.skipValue();
+    }
+
+    if (!ok || (!scanner.consume(',') && !scanner.peek('}'))) {
+      return false;
+    }
+  }
+
+  if (!isSchema) {
+    return true;
+  }
+
+  if (num < 0 || num > 255 || bits < 0 || bits > LIVE_QUANT_MAX_BITS ||
+      !(declaration.maximum > declaration.minimum)) {
+    return false;
+  }
+
+  declaration.declared = true;
+  declaration.bits = static_cast<uint8_t>(bits);
+  schemas[num] = declaration;
+  return true;
+}
+
+/* --------------------------------------------------------------------------
+   Binary encodings
+   -------------------------------------------------------------------------- */
+
+static uint64_t getLittleEndian(const uint8_t* in, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+static double decodeValue(uint32_t bits, bool integer) {
+  if (integer) {
+    return static_cast<double>(static_cast<int32_t>(bits));
+  }
+
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+bool LiveHostDecoder::pushCompact(const uint8_t* data, size_t length) {
+  // A snapshot read before the first capture is empty, not malformed.
+  if (length == 0) {
+    return false;
+  }
+
+  ++counters.chunks;
+
+  if (length < LIVE_COMPACT_HEADER_SIZE ||
+      data[0] != LIVE_COMPACT_FORMAT) {
+    ++counters.malformedChunks;
+    return false;
+  }
+
+  const size_t count = static_cast<size_t>(getLittleEndian(data + 2, 2));
+  if (length < LIVE_COMPACT_HEADER_SIZE + count * LIVE_COMPACT_PROBE_SIZE) {
+    ++counters.malformedChunks;
+    return false;
+  }
+
+  flush();
+
+  beginFrame(
+      static_cast<uint32_t>(getLittleEndian(data + 4, 4)),
+      getLittleEndian(data + 8, 8),
+      false,
+      false);
+  pendingComplete = (data[1] & LIVE_COMPACT_TRUNCATED) == 0;
+
+  const uint8_t* probe = data + LIVE_COMPACT_HEADER_SIZE;
+  for (size_t i = 0; i < count; ++i) {
+    nums.push_back(probe[0]);
+    values.push_back(decodeValue(
+        static_cast<uint32_t>(getLittleEndian(probe + 2, 4)),
+        probe[1] == LIVE_COMPACT_INT32));
+    probe += LIVE_COMPACT_PROBE_SIZE;
+  }
+
+  deliver();
+  return true;
+}
+
+bool liveHostDecodeBroadcast(
+    const uint8_t* data,
+    size_t length,
+    LiveHostBroadcast& out) {
+
+  if (length < 2 + LIVE_BROADCAST_HEADER_SIZE ||
+      data[2] != LIVE_BROADCAST_FORMAT) {
+    return false;
+  }
+
+  out.companyId = static_cast<uint16_t>(getLittleEndian(data, 2));
+  out.sampleId = static_cast<uint32_t>(getLittleEndian(data + 4, 4));
+
+  const uint8_t types = data[3];
+  const uint8_t* probe = data + 2 + LIVE_BROADCAST_HEADER_SIZE;
+  size_t count =
+      (length - 2 - LIVE_BROADCAST_HEADER_SIZE) / LIVE_BROADCAST_PROBE_SIZE;
+  if (count > 8) {
+    count = 8;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    out.nums[i] = probe[0];
+    out.values[i] = decodeValue(
+        static_cast<uint32_t>(getLittleEndian(probe + 1, 4)),
+        (types & (1u << i)) != 0);
+    probe += LIVE_BROADCAST_PROBE_SIZE;
+  }
+
+  out.count = count;
+  return true;
+}
+
+/* --------------------------------------------------------------------------
+   Columnar store
+   -------------------------------------------------------------------------- */
+
+void LiveHostColumns::append(const LiveHostFrame& frame) {
+  if (!mapped) {
+    for (int16_t& entry : columnOf) {
+      entry = -1;
+    }
+    mapped = true;
+  }
+
+  const size_t row = sampleIdColumn.size();
+  sampleIdColumn.push_back(frame.sampleId);
+  timestampColumn.push_back(frame.timestampMs);
+
+  for (std::vector<double>& column : columns) {
+    column.push_back(
+        frame.changesOnly && row > 0 ? column[row - 1] : NAN);
+  }
+
+  for (size_t i = 0; i < frame.count; ++i) {
+    const uint8_t num = frame.nums[i];
+
+    if (columnOf[num] < 0) {
+      columnOf[num] = static_cast<int16_t>(columns.size());
+      columns.emplace_back(row + 1, NAN);
+      probeOrder.push_back(num);
+    }
+
+    columns[columnOf[num]][row] = frame.values[i];
+  }
+}
+
+void LiveHostColumns::clear() {
+  sampleIdColumn.clear();
+  timestampColumn.clear();
+  columns.clear();
+  probeOrder.clear();
+  mapped = false;
+}
+
+const std::vector<double>* LiveHostColumns::column(uint8_t num) const {
+  if (!mapped || columnOf[num] < 0) {
+    return nullptr;
+  }
+  return &columns[columnOf[num]];
+}
@@ -0,0 +1,213 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Host-side receiver for the ESP32 Live stream. Reassembles the JSON chunks
+// of the notify characteristic into frames, decodes the compact binary
+// encodings and detects sample_id gaps. Decoded frames are handed out as
+// views into reused buffers and can be collected into columnar arrays.
+//
+// Standard C++17 only: no Arduino, ArduinoJson or Bluetooth dependency. The
+// transport (BlueZ, a serial bridge, a log file) feeds notification
+// payloads in.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/* --------------------------------------------------------------------------
+   Frames
+   -------------------------------------------------------------------------- */
+
+// One reassembled snapshot. nums and values point to count entries owned by
+// the decoder and stay valid until the handler returns.
+struct LiveHostFrame {
+  uint32_t sampleId;
+  uint64_t timestampMs;
+  const uint8_t* nums;
+  const double* values;
+  size_t count;
+
+  // False when a chunk of this frame was lost.
+  bool complete;
+
+  // Replayed frames (black box, deep-sleep upload) carry older identifiers
+  // and are not part of gap detection.
+  bool replayed;
+
+  // Change-only streaming: only the probes that changed are present, the
+  // others keep the value of the previous frame.
+  bool changesOnly;
+};
+
+struct LiveHostStats {
+  uint64_t chunks = 0;
+  uint64_t frames = 0;
+  uint64_t incompleteFrames = 0;
+  uint64_t malformedChunks = 0;
+  uint64_t values = 0;
+
+  // sample_id gaps between consecutive live frames, and the identifiers
+  // missing in them.
+  uint64_t gaps = 0;
+  uint64_t missingSamples = 0;
+
+  // sample_id went backwards: the device restarted.
+  uint64_t restarts = 0;
+
+  // Quantized values received before the schema event of their probe,
+  // delivered as NaN.
+  uint64_t unscaledValues = 0;
+};
+
+// Units, range and bit depth of a probe, from its schema event. bits is 0
+// when the probe is not quantized and the range is only a plot hint.
+struct LiveHostSchema {
+  bool declared = false;
+  uint8_t bits = 0;
+  double minimum = 0.0;
+  double maximum = 0.0;
+  std::string units;
+};
+
+/* --------------------------------------------------------------------------
+   Decoder
+   -------------------------------------------------------------------------- */
+
+class LiveHostDecoder {
+public:
+  using FrameHandler = std::function<void(const LiveHostFrame&)>;
+  using GapHandler = std::function<void(uint32_t firstMissing, uint32_t count)>;
+
+  void onFrame(FrameHandler handler) {
+    frameHandler = handler;
+  }
+
+  void onGap(GapHandler handler) {
+    gapHandler = handler;
+  }
+
+  // One notification of the notify characteristic. The payload is parsed in
+  // place and not retained. Returns false for a malformed chunk.
+  bool pushChunk(const uint8_t* data, size_t length);
+
+  // One record in the compact encoding, from the snapshot characteristic or
+  // a periodic advertising train. Returns false for a malformed record and
+  // for the empty value read before the first capture.
+  bool pushCompact(const uint8_t* data, size_t length);
+
+  // One notification of the events characteristic. Schema events are kept
+  // to scale the quantized values of later chunks; other events are
+  // ignored. Returns false for a malformed payload.
+  bool pushEvent(const uint8_t* data, size_t length);
+
+  // Declaration of a probe, or nullptr before its schema event.
+  const LiveHostSchema* schema(uint8_t num) const {
+    return schemas[num].declared ? &schemas[num] : nullptr;
+  }
+
+  // Delivers a frame still waiting for its last chunk, as incomplete.
+  void flush();
+
+  void reset();
+
+  const LiveHostStats& stats() const {
+    return counters;
+  }
+
+private:
+  void beginFrame(
+      uint32_t sampleId,
+      uint64_t timestampMs,
+      bool replayed,
+      bool changesOnly);
+  void deliver();
+  void track(uint32_t sampleId);
+
+  FrameHandler frameHandler;
+  GapHandler gapHandler;
+  LiveHostStats counters;
+
+  // Frame being assembled. The vectors keep their capacity across frames,
+  // so steady-state decoding does not allocate.
+  bool pending = false;
+  uint32_t pendingId = 0;
+  uint64_t pendingTimestampMs = 0;
+  uint16_t nextSeq = 0;
+  bool pendingComplete = true;
+  bool pendingReplayed = false;
+  bool pendingChangesOnly = false;
+  std::vector<uint8_t> nums;
+  std::vector<double> values;
+
+  bool haveLastId = false;
+  uint32_t lastId = 0;
+
+  LiveHostSchema schemas[256];
+};
+
+/* --------------------------------------------------------------------------
+   Broadcast records
+   -------------------------------------------------------------------------- */
+
+// Manufacturer-specific advertising data of the broadcast mode.
+struct LiveHostBroadcast {
+  uint16_t companyId;
+  uint32_t sampleId;
+  size_t count;
+  uint8_t nums[8];
+  double values[8];
+};
+
+// data starts with the 16-bit company identifier.
+bool liveHostDecodeBroadcast(
+    const uint8_t* data,
+    size_t length,
+    LiveHostBroadcast& out);
+
+/* --------------------------------------------------------------------------
+   Columnar store
+   -------------------------------------------------------------------------- */
+
+// Frames as one column per probe number. A probe missing from a frame is
+// stored as NaN, or as its previous value in a change-only frame, so all
+// columns have rows() entries.
+class LiveHostColumns {
+public:
+  void append(const LiveHostFrame& frame);
+  void clear();
+
+  size_t rows() const {
+    return sampleIdColumn.size();
+  }
+
+  const std::vector<uint32_t>& sampleIds() const {
+    return sampleIdColumn;
+  }
+
+  const std::vector<uint64_t>& timestamps() const {
+    return timestampColumn;
+  }
+
+  // Column of a probe, or nullptr if that probe was never seen.
+  const std::vector<double>* column(uint8_t num) const;
+
+  // Probe numbers in order of first appearance.
+  const std::vector<uint8_t>& probes() const {
+    return probeOrder;
+  }
+
+private:
+  std::vector<uint32_t> sampleIdColumn;
+  std::vector<uint64_t> timestampColumn;
+  std::vector<std::vector<double>> columns;
+  std::vector<uint8_t> probeOrder;
+  int16_t columnOf[256] = {};
+  bool mapped = false;
+};
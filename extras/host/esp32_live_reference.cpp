@@ -0,0 +1,176 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_reference.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void liveReferenceDecimal(char* buffer, size_t size, double value, int digits) {
+  snprintf(buffer, size, "%.*f", digits, value);
+
+  char* point = strchr(buffer, '.');
+  if (point == nullptr) {
+    return;
+  }
+
+  char* end = buffer + strlen(buffer) - 1;
+  while (end > point && *end == '0') {
+    *end-- = '\0';
+  }
+  if (end == point) {
+    *end = '\0';
+  }
+}
+
+void liveReferenceHeader(
+    std::string& out,
+    const char* timestamp,
+    const char* rate,
+    const char* temp,
+    const char* sampleId,
+    const char* seq,
+    bool last,
+    const char* tagKey,
+    const char* tagValue) {
+
+  out += "{\"ver\":\"";
+  out += LIVE_REFERENCE_VERSION;
+  out += "\",\"timestamp\":";
+  out += timestamp;
+  out += ",\"rate\":";
+  out += rate;
+  if (temp != nullptr) {
+    out += ",\"temp\":";
+    out += temp;
+  }
+  out += ",\"sample_id\":";
+  out += sampleId;
+  if (tagKey != nullptr) {
+    out += ",\"";
+    out += tagKey;
+    if (tagValue != nullptr) {
+      out += "\":\"";
+      out += tagValue;
+      out += '"';
+    } else {
+      out += "\":true";
+    }
+  }
+  out += ",\"seq\":";
+  out += seq;
+  out += last ? ",\"last\":true" : ",\"last\":false";
+  out += ",\"pins\":[";
+}
+
+void liveReferenceProbe(
+    std::string& out,
+    unsigned num,
+    LiveReferenceKind kind,
+    const char* config,
+    const char* direction,
+    const char* src,
+    const char* value,
+    const char* voltage) {
+
+  char numText[8];
+  snprintf(numText, sizeof(numText), "%u", num);
+
+  out += "{\"num\":";
+  out += numText;
+
+  if (kind == LIVE_REFERENCE_VIRTUAL_FLOAT ||
+      kind == LIVE_REFERENCE_VIRTUAL_INT) {
+    out += ",\"config\":\"VIRTUAL\",\"direction\":\"";
+    out += direction;
+    out += "\",\"src\":\"virtual\",\"value\":";
+    out += value;
+    out += ",\"voltage\":\"-\"}";
+    return;
+  }
+
+  out += ",\"config\":\"";
+  out += config;
+  out += "\",\"direction\":\"";
+  out += direction;
+  out += "\",\"src\":\"";
+  out += src;
+  out += "\",\"value\":";
+  out += value;
+  out += kind == LIVE_REFERENCE_ANALOG ? ",\"analog\":" : ",\"digital\":";
+  out += value;
+  out += ",\"voltage\":";
+  out += voltage;
+  out += '}';
+}
+
+void liveReferenceQuantized(std::string& out, unsigned num, const char* code) {
+  char numText[8];
+  snprintf(numText, sizeof(numText), "%u", num);
+
+  out += "{\"num\":";
+  out += numText;
+  out += ",\"q\":";
+  out += code;
+  out += '}';
+}
+
+size_t liveReferenceHeaderWidth(
+    bool temp,
+    const char* tagKey,
+    const char* tagValue) {
+
+  std::string text;
+  liveReferenceHeader(
+      text,
+      LIVE_REFERENCE_WORST_TIMESTAMP,
+      LIVE_REFERENCE_WORST_RATE,
+      temp ? LIVE_REFERENCE_WORST_TEMPERATURE : nullptr,
+      LIVE_REFERENCE_WORST_UINT32,
+      "65535",
+      false,
+      tagKey,
+      tagValue);
+  text += "]}";
+  return text.size();
+}
+
+uint16_t liveReferenceProbeWidth(
+    unsigned num,
+    LiveReferenceKind kind,
+    const char* config,
+    const char* direction,
+    const char* src) {
+
+  std::string text;
+
+  switch (kind) {
+    case LIVE_REFERENCE_VIRTUAL_FLOAT:
+      liveReferenceProbe(text, num, kind, config, direction, src,
+                         LIVE_REFERENCE_WORST_VIRTUAL_FLOAT, nullptr);
+      break;
+    case LIVE_REFERENCE_VIRTUAL_INT:
+      liveReferenceProbe(text, num, kind, config, direction, src,
+                         LIVE_REFERENCE_WORST_INT32, nullptr);
+      break;
+    case LIVE_REFERENCE_ANALOG:
+      liveReferenceProbe(text, num, kind, config, direction, src,
+                         "4095", LIVE_REFERENCE_WORST_VOLTAGE);
+      break;
+    case LIVE_REFERENCE_DIGITAL:
+      liveReferenceProbe(text, num, kind, config, direction, src,
+                         "1", "3.3");
+      break;
+  }
+
+  return static_cast<uint16_t>(text.size() > UINT16_MAX ? UINT16_MAX
+                                                         : text.size());
+}
+
+uint16_t liveReferenceQuantizedWidth(unsigned num) {
+  std::string text;
+  liveReferenceQuantized(text, num, LIVE_REFERENCE_WORST_CODE);
+  return static_cast<uint16_t>(text.size());
+}
@@ -0,0 +1,94 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Reference text of the notify protocol: the bytes sendFrame() produces for
+// one chunk, field by field and in the same order. Used by the device farm
+// to generate realistic chunks and by live_conform to check chunks captured
+// from a board.
+//
+// Values are passed as text, so the same functions render real values and
+// the worst cases the device uses to measure widths for its chunk plan.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+static const char* const LIVE_REFERENCE_VERSION = "1.7.2";
+
+// Worst-case encodings, as in currentChunkPlan(). The rate is the default
+// ESP32_LIVE_RATE_MAX.
+static const char* const LIVE_REFERENCE_WORST_VIRTUAL_FLOAT =
+    "-1.234567891e38";
+static const char* const LIVE_REFERENCE_WORST_VOLTAGE = "3.299999952";
+static const char* const LIVE_REFERENCE_WORST_TEMPERATURE = "-123.123456789";
+static const char* const LIVE_REFERENCE_WORST_TIMESTAMP = "9999999999999";
+static const char* const LIVE_REFERENCE_WORST_RATE = "60000";
+static const char* const LIVE_REFERENCE_WORST_INT32 = "-2147483648";
+static const char* const LIVE_REFERENCE_WORST_UINT32 = "4294967295";
+static const char* const LIVE_REFERENCE_WORST_CODE = "65535";
+
+enum LiveReferenceKind : uint8_t {
+  LIVE_REFERENCE_VIRTUAL_FLOAT,
+  LIVE_REFERENCE_VIRTUAL_INT,
+  LIVE_REFERENCE_ANALOG,
+  LIVE_REFERENCE_DIGITAL
+};
+
+// Appends the chunk header up to and including the opening bracket of the
+// probe array. temp is nullptr when the chip temperature is not sent.
+// tagKey marks a partial frame as liveSendProbeValues() does ("changes",
+// "ulp", "blackbox"): it is set to the string tagValue, or to true when
+// tagValue is nullptr.
+void liveReferenceHeader(
+    std::string& out,
+    const char* timestamp,
+    const char* rate,
+    const char* temp,
+    const char* sampleId,
+    const char* seq,
+    bool last,
+    const char* tagKey = nullptr,
+    const char* tagValue = nullptr);
+
+// Appends one probe object. config and direction are the strings given at
+// registration; for a virtual probe, direction is the variable name given to
+// ESP32_PROBE_VIRTUAL(). src is "hw", or "dac" on the DAC pins of the
+// classic ESP32. Virtual probes always send "VIRTUAL" and "virtual" and no
+// voltage, so config, src and voltage are ignored for them.
+void liveReferenceProbe(
+    std::string& out,
+    unsigned num,
+    LiveReferenceKind kind,
+    const char* config,
+    const char* direction,
+    const char* src,
+    const char* value,
+    const char* voltage);
+
+// Appends the object of a quantized probe: its number and fixed-point code.
+void liveReferenceQuantized(std::string& out, unsigned num, const char* code);
+
+// Worst-case widths, for liveBuildChunkPlan(). The header of a partial frame
+// includes its tag, as in liveSendProbeValues().
+size_t liveReferenceHeaderWidth(
+    bool temp,
+    const char* tagKey = nullptr,
+    const char* tagValue = nullptr);
+
+uint16_t liveReferenceProbeWidth(
+    unsigned num,
+    LiveReferenceKind kind,
+    const char* config,
+    const char* direction,
+    const char* src);
+
+uint16_t liveReferenceQuantizedWidth(unsigned num);
+
+// Shortest decimal text with at most digits decimals, as ArduinoJson prints
+// a value rounded to that many decimals.
+void liveReferenceDecimal(char* buffer, size_t size, double value, int digits);
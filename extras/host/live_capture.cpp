@@ -0,0 +1,189 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Converts a log of notify payloads, one JSON chunk per line, into a capture
+// file, and looks samples up in one. Event lines in the log are passed to
+// the decoder as events, so quantized probes are stored scaled.
+//
+//     live_capture convert session.log session.elc
+//     live_capture info session.elc
+//     live_capture info session.elc --id 120000
+//     live_capture info session.elc --time 3600000
+//
+
+#include "esp32_live_capture.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static bool decodeLog(const char* path, LiveHostDecoder& decoder) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "cannot open " << path << '\n';
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(line.data());
+    if (line.find("\"event\"") != std::string::npos) {
+      decoder.pushEvent(payload, line.size());
+    } else if (!line.empty()) {
+      decoder.pushChunk(payload, line.size());
+    }
+  }
+  decoder.flush();
+  return true;
+}
+
+static int convert(const char* logPath, const char* capturePath) {
+  // First pass: the probe set, which fixes the schema of the file.
+  bool seen[256] = {};
+  std::vector<uint8_t> nums;
+
+  LiveHostDecoder scan;
+  scan.onFrame([&](const LiveHostFrame& frame) {
+    for (size_t i = 0; i < frame.count; ++i) {
+      if (!seen[frame.nums[i]]) {
+        seen[frame.nums[i]] = true;
+        nums.push_back(frame.nums[i]);
+      }
+    }
+  });
+
+  if (!decodeLog(logPath, scan)) {
+    return 1;
+  }
+
+  if (nums.empty()) {
+    std::cerr << "no frames in " << logPath << '\n';
+    return 1;
+  }
+
+  LiveCaptureWriter writer;
+  if (!writer.open(capturePath, nums.data(), nums.size())) {
+    std::cerr << "cannot write " << capturePath << '\n';
+    return 1;
+  }
+
+  // Second pass: live frames in order. The index needs sample_id not to go
+  // backwards, so frames after a device restart are left out.
+  uint64_t written = 0;
+  uint64_t skipped = 0;
+  bool haveLast = false;
+  uint32_t lastId = 0;
+
+  LiveHostDecoder decoder;
+  decoder.onFrame([&](const LiveHostFrame& frame) {
+    if (frame.replayed || (haveLast && frame.sampleId <= lastId)) {
+      ++skipped;
+      return;
+    }
+
+    haveLast = true;
+    lastId = frame.sampleId;
+    if (writer.append(frame)) {
+      ++written;
+    }
+  });
+
+  decodeLog(logPath, decoder);
+
+  if (!writer.close()) {
+    std::cerr << "write error on " << capturePath << '\n';
+    return 1;
+  }
+
+  std::cerr << written << " frames, " << nums.size() << " probes";
+  if (skipped > 0) {
+    std::cerr << ", " << skipped << " replayed or out of order skipped";
+  }
+  std::cerr << '\n';
+  return 0;
+}
+
+static void printRow(
+    const LiveCaptureReader& reader,
+    const LiveCaptureBlock& block,
+    uint32_t row) {
+
+  std::cout << "sample_id " << block.sampleIds[row]
+            << ", timestamp " << block.timestamps[row];
+
+  for (size_t p = 0; p < reader.probeCount(); ++p) {
+    const double value = block.values[p * block.rows + row];
+    if (!std::isnan(value)) {
+      std::cout << ", p" << static_cast<int>(reader.probeNum(p))
+                << " " << value;
+    }
+  }
+  std::cout << '\n';
+}
+
+static int info(int argc, char** argv) {
+  LiveCaptureReader reader;
+  if (!reader.open(argv[2])) {
+    std::cerr << "not a capture file: " << argv[2] << '\n';
+    return 1;
+  }
+
+  std::cout << reader.rows() << " rows in " << reader.blockCount()
+            << " blocks, probes";
+  for (size_t p = 0; p < reader.probeCount(); ++p) {
+    std::cout << " p" << static_cast<int>(reader.probeNum(p));
+  }
+  std::cout << '\n';
+
+  if (argc < 5) {
+    return 0;
+  }
+
+  const std::string option = argv[3];
+  const unsigned long long key = std::stoull(argv[4]);
+
+  size_t blockIndex = 0;
+  uint32_t row = 0;
+  LiveCaptureBlock block;
+
+  if (option == "--id") {
+    if (!reader.locateId(static_cast<uint32_t>(key), blockIndex, row)) {
+      std::cout << "no sample at or after id " << key << '\n';
+      return 0;
+    }
+    reader.block(blockIndex, block);
+  } else if (option == "--time") {
+    blockIndex = reader.findBlockByTime(key);
+    if (!reader.block(blockIndex, block)) {
+      std::cout << "no sample at or after " << key << " ms\n";
+      return 0;
+    }
+    while (block.timestamps[row] < key) {
+      ++row;
+    }
+  } else {
+    std::cerr << "unknown option " << option << '\n';
+    return 1;
+  }
+
+  std::cout << "block " << blockIndex << ", row " << row << ": ";
+  printRow(reader, block, row);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  const std::string command = argc > 1 ? argv[1] : "";
+
+  if (command == "convert" && argc == 4) {
+    return convert(argv[2], argv[3]);
+  }
+  if (command == "info" && argc >= 3) {
+    return info(argc, argv);
+  }
+
+  std::cerr << "usage: live_capture convert in.log out.elc\n"
+            << "       live_capture info file.elc [--id N | --time MS]\n";
+  return 1;
+}
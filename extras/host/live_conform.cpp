@@ -0,0 +1,584 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Protocol conformance check for notify payloads captured from a board, one
+// chunk per line. Every chunk is rendered again by the reference encoder
+// (esp32_live_reference.h) from the values it carries and compared byte for
+// byte, and the chunk boundaries of every frame are compared with the chunk
+// plan for the probe set at the given limit.
+//
+//     live_conform session.log
+//     live_conform --limit 120 session.log
+//
+// Run it on captures from every build that must stay compatible, such as
+// the same sketch built against ArduinoJson 6 and 7, or with different
+// BLE_CHUNK_LIMIT values. The exit status is 1 when a chunk does not
+// conform.
+//
+
+#include "../../src/esp32_live_plan.h"
+#include "esp32_live_reference.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+/* --------------------------------------------------------------------------
+   Chunk parsing
+   -------------------------------------------------------------------------- */
+
+struct ChunkProbe {
+  std::string num;
+  std::string config;
+  std::string direction;
+  std::string src;
+  std::string value;
+  std::string voltage;
+
+  // Sent as {"num":N,"q":code}; value holds the code.
+  bool quantized = false;
+};
+
+struct Chunk {
+  std::string timestamp;
+  std::string rate;
+  std::string temp;
+  std::string sampleId;
+  std::string seq;
+  bool last = false;
+  bool hasTemp = false;
+
+  // Replayed and change-only chunks carry a tag after sample_id: true, or a
+  // string such as the reset reason of a black box upload.
+  bool tagged = false;
+  bool tagIsString = false;
+  std::string tagKey;
+  std::string tagValue;
+  std::vector<ChunkProbe> probes;
+};
+
+// Just enough JSON for flat objects and one array of flat objects. Values
+// are kept as their raw text, strings without the quotes.
+class Scanner {
+public:
+  Scanner(const char* begin, const char* end) : p(begin), end(end) {}
+
+  bool consume(char c) {
+    if (p < end && *p == c) {
+      ++p;
+      return true;
+    }
+    return false;
+  }
+
+  bool atEnd() const {
+    return p == end;
+  }
+
+  bool peek(char c) const {
+    return p < end && *p == c;
+  }
+
+  bool string(std::string& out) {
+    if (!consume('"')) {
+      return false;
+    }
+    const char* start = p;
+    while (p < end && *p != '"') {
+      if (*p == '\\') {
+        ++p;
+      }
+      ++p;
+    }
+    if (p >= end) {
+      return false;
+    }
+    out.assign(start, p);
+    ++p;
+    return true;
+  }
+
+  bool scalar(std::string& out) {
+    if (p < end && *p == '"') {
+      return string(out);
+    }
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']') {
+      ++p;
+    }
+    out.assign(start, p);
+    return !out.empty();
+  }
+
+private:
+  const char* p;
+  const char* end;
+};
+
+static bool parseProbe(Scanner& scanner, ChunkProbe& probe) {
+  if (!scanner.consume('{')) {
+    return false;
+  }
+
+  std::string key;
+  std::string value;
+  do {
+    if (!scanner.string(key) || !scanner.consume(':') ||
+        !scanner.scalar(value)) {
+      return false;
+    }
+    if (key == "num") {
+      probe.num = value;
+    } else if (key == "config") {
+      probe.config = value;
+    } else if (key == "direction") {
+      probe.direction = value;
+    } else if (key == "src") {
+      probe.src = value;
+    } else if (key == "value") {
+      probe.value = value;
+    } else if (key == "q") {
+      probe.value = value;
+      probe.quantized = true;
+    } else if (key == "voltage") {
+      probe.voltage = value;
+    }
+  } while (scanner.consume(','));
+
+  return scanner.consume('}');
+}
+
+static bool parseChunk(const std::string& line, Chunk& chunk) {
+  Scanner scanner(line.data(), line.data() + line.size());
+  if (!scanner.consume('{')) {
+    return false;
+  }
+
+  std::string key;
+  std::string value;
+  do {
+    if (!scanner.string(key) || !scanner.consume(':')) {
+      return false;
+    }
+
+    if (key == "pins") {
+      if (!scanner.consume('[')) {
+        return false;
+      }
+      if (!scanner.consume(']')) {
+        do {
+          chunk.probes.emplace_back();
+          if (!parseProbe(scanner, chunk.probes.back())) {
+            return false;
+          }
+        } while (scanner.consume(','));
+
+        if (!scanner.consume(']')) {
+          return false;
+        }
+      }
+      continue;
+    }
+
+    const bool quoted = scanner.peek('"');
+    if (!scanner.scalar(value)) {
+      return false;
+    }
+
+    if (key == "timestamp") {
+      chunk.timestamp = value;
+    } else if (key == "rate") {
+      chunk.rate = value;
+    } else if (key == "temp") {
+      chunk.temp = value;
+      chunk.hasTemp = true;
+    } else if (key == "sample_id") {
+      chunk.sampleId = value;
+    } else if (key == "seq") {
+      chunk.seq = value;
+    } else if (key == "last") {
+      chunk.last = value == "true";
+    } else if (key != "ver") {
+      chunk.tagged = true;
+      chunk.tagKey = key;
+      chunk.tagValue = value;
+      chunk.tagIsString = quoted;
+    }
+  } while (scanner.consume(','));
+
+  return scanner.consume('}') && scanner.atEnd();
+}
+
+/* --------------------------------------------------------------------------
+   Checks
+   -------------------------------------------------------------------------- */
+
+static bool isVirtual(const ChunkProbe& probe) {
+  return probe.config == "VIRTUAL";
+}
+
+static bool isInteger(const std::string& text) {
+  size_t i = text.size() > 1 && text[0] == '-' ? 1 : 0;
+  if (i == text.size() || (text[i] == '0' && text.size() > i + 1)) {
+    return false;
+  }
+  for (; i < text.size(); ++i) {
+    if (text[i] < '0' || text[i] > '9') {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool isFraction(const std::string& text) {
+  return text.find_first_of(".eE") != std::string::npos;
+}
+
+// Virtual float probes are rounded to three decimals on the device, and
+// integer probes never print a fraction. Values too large for a plain
+// decimal are printed with an exponent and accepted as they are. Quantized
+// codes are unsigned and at most 16 bits.
+static bool valueTextConforms(const ChunkProbe& probe) {
+  if (probe.quantized) {
+    return isInteger(probe.value) && probe.value[0] != '-' &&
+           atol(probe.value.c_str()) <= 65535;
+  }
+  if (!isVirtual(probe)) {
+    return isInteger(probe.value);
+  }
+  if (!isFraction(probe.value)) {
+    return isInteger(probe.value);
+  }
+  if (probe.value.find_first_of("eE") != std::string::npos) {
+    return fabs(atof(probe.value.c_str())) >= 1e7;
+  }
+
+  char expected[48];
+  liveReferenceDecimal(
+      expected, sizeof(expected), atof(probe.value.c_str()), 3);
+  return probe.value == expected;
+}
+
+// Hardware voltages are printed from a float: compared by value, at float
+// precision.
+static bool voltageConforms(const ChunkProbe& probe) {
+  if (isVirtual(probe) || probe.quantized) {
+    return true;
+  }
+
+  const double voltage = atof(probe.voltage.c_str());
+  const float level = static_cast<float>(atof(probe.value.c_str()));
+
+  const double expected = probe.config == "ANALOG"
+                              ? 3.3f * level / 4095.0f
+                              : (level != 0.0f ? 3.3f : 0.0f);
+
+  return fabs(voltage - expected) <= 1e-6 * (1.0 + fabs(expected));
+}
+
+static LiveReferenceKind kindOf(
+    const ChunkProbe& probe,
+    const std::map<std::string, bool>& fractional) {
+
+  if (isVirtual(probe)) {
+    const auto found = fractional.find(probe.num);
+    return found != fractional.end() && found->second
+               ? LIVE_REFERENCE_VIRTUAL_FLOAT
+               : LIVE_REFERENCE_VIRTUAL_INT;
+  }
+  return probe.config == "ANALOG" ? LIVE_REFERENCE_ANALOG
+                                  : LIVE_REFERENCE_DIGITAL;
+}
+
+// The chunk as the reference encoder writes it. Printer-dependent texts
+// (temperature, voltages) are taken from the chunk and checked separately.
+static std::string render(
+    const Chunk& chunk,
+    const std::map<std::string, bool>& fractional) {
+
+  std::string text;
+  liveReferenceHeader(
+      text,
+      chunk.timestamp.c_str(),
+      chunk.rate.c_str(),
+      chunk.hasTemp ? chunk.temp.c_str() : nullptr,
+      chunk.sampleId.c_str(),
+      chunk.seq.c_str(),
+      chunk.last,
+      chunk.tagged ? chunk.tagKey.c_str() : nullptr,
+      chunk.tagIsString ? chunk.tagValue.c_str() : nullptr);
+
+  for (size_t i = 0; i < chunk.probes.size(); ++i) {
+    const ChunkProbe& probe = chunk.probes[i];
+    if (i > 0) {
+      text += ',';
+    }
+    if (probe.quantized) {
+      liveReferenceQuantized(
+          text,
+          static_cast<unsigned>(atoi(probe.num.c_str())),
+          probe.value.c_str());
+      continue;
+    }
+    liveReferenceProbe(
+        text,
+        static_cast<unsigned>(atoi(probe.num.c_str())),
+        kindOf(probe, fractional),
+        probe.config.c_str(),
+        probe.direction.c_str(),
+        probe.src.c_str(),
+        probe.value.c_str(),
+        probe.voltage.c_str());
+  }
+
+  text += "]}";
+  return text;
+}
+
+struct Report {
+  uint64_t chunks = 0;
+  uint64_t tagged = 0;
+  uint64_t frames = 0;
+  uint64_t failures = 0;
+  std::map<std::string, uint64_t> byCheck;
+
+  void fail(size_t line, const std::string& check, const std::string& detail) {
+    ++failures;
+    if (byCheck[check]++ < 5) {
+      std::cout << "line " << line << ": " << check;
+      if (!detail.empty()) {
+        std::cout << ": " << detail;
+      }
+      std::cout << '\n';
+    }
+  }
+};
+
+static std::string difference(const std::string& expected,
+                              const std::string& actual) {
+  size_t at = 0;
+  while (at < expected.size() && at < actual.size() &&
+         expected[at] == actual[at]) {
+    ++at;
+  }
+
+  const size_t from = at > 20 ? at - 20 : 0;
+  return "byte " + std::to_string(at) +
+         ", expected ..." + expected.substr(from, 40) +
+         "... got ..." + actual.substr(from, 40) + "...";
+}
+
+/* --------------------------------------------------------------------------
+   Frames
+   -------------------------------------------------------------------------- */
+
+struct FrameLayout {
+  bool open = false;
+  std::string sampleId;
+  size_t nextSeq = 0;
+  size_t firstLine = 0;
+  bool hasTemp = false;
+  bool tagged = false;
+  bool tagIsString = false;
+  std::string tagKey;
+  std::string tagValue;
+  std::vector<uint16_t> starts;
+  std::vector<uint16_t> widths;
+};
+
+static void checkPlan(
+    const FrameLayout& frame,
+    size_t limit,
+    Report& report) {
+
+  LiveChunkPlan plan;
+  liveBuildChunkPlan(
+      plan,
+      liveReferenceHeaderWidth(
+          frame.hasTemp,
+          frame.tagged ? frame.tagKey.c_str() : nullptr,
+          frame.tagIsString ? frame.tagValue.c_str() : nullptr),
+      frame.widths.data(),
+      frame.widths.size(),
+      limit);
+
+  // A partial frame without values is one chunk with an empty array.
+  if (frame.widths.empty()) {
+    plan.starts.assign(2, 0);
+  }
+
+  std::vector<uint16_t> starts = frame.starts;
+  starts.push_back(static_cast<uint16_t>(frame.widths.size()));
+
+  if (starts != plan.starts) {
+    report.fail(
+        frame.firstLine,
+        "chunk boundaries differ from the plan",
+        "sample_id " + frame.sampleId + ", " +
+            std::to_string(frame.starts.size()) + " chunks sent, " +
+            std::to_string(plan.chunkCount()) + " planned");
+  }
+  ++report.frames;
+}
+
+int main(int argc, char** argv) {
+  size_t limit = 240;
+  const char* path = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if (argument == "--limit" && i + 1 < argc) {
+      limit = static_cast<size_t>(atoi(argv[++i]));
+    } else {
+      path = argv[i];
+    }
+  }
+
+  if (path == nullptr || limit == 0) {
+    std::cerr << "usage: live_conform [--limit BYTES] session.log\n";
+    return 1;
+  }
+
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "cannot open " << path << '\n';
+    return 1;
+  }
+
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+  }
+
+  Report report;
+
+  // First pass: virtual probes that ever print a fraction are floats. The
+  // worst-case width, and so the plan, depends on it.
+  std::map<std::string, bool> fractional;
+  for (const std::string& text : lines) {
+    Chunk chunk;
+    if (!text.empty() && parseChunk(text, chunk)) {
+      for (const ChunkProbe& probe : chunk.probes) {
+        if (isVirtual(probe)) {
+          fractional[probe.num] =
+              fractional[probe.num] || isFraction(probe.value);
+        }
+      }
+    }
+  }
+
+  FrameLayout frame;
+
+  for (size_t index = 0; index < lines.size(); ++index) {
+    const std::string& text = lines[index];
+    const size_t number = index + 1;
+    // Events, such as schema events, come from the events characteristic.
+    if (text.empty() || text.find("\"event\"") != std::string::npos) {
+      continue;
+    }
+
+    ++report.chunks;
+
+    Chunk chunk;
+    if (!parseChunk(text, chunk)) {
+      report.fail(number, "not a chunk", "");
+      frame.open = false;
+      continue;
+    }
+
+    if (chunk.tagged) {
+      ++report.tagged;
+    }
+
+    // The plan sends a probe too wide for an empty chunk alone; the plan
+    // check below confirms that it was.
+    if (text.size() > limit && chunk.probes.size() > 1) {
+      report.fail(number, "chunk longer than the limit",
+                  std::to_string(text.size()) + " bytes");
+    }
+
+    const std::string expected = render(chunk, fractional);
+    if (expected != text) {
+      report.fail(number, "bytes differ from the reference",
+                  difference(expected, text));
+    }
+
+    if (!isInteger(chunk.timestamp) || !isInteger(chunk.rate) ||
+        !isInteger(chunk.sampleId) || !isInteger(chunk.seq)) {
+      report.fail(number, "header field is not an integer", "");
+    }
+
+    for (const ChunkProbe& probe : chunk.probes) {
+      if (!isInteger(probe.num) || !valueTextConforms(probe)) {
+        report.fail(number, "value text", "probe " + probe.num +
+                                             " value " + probe.value);
+      }
+      if (!voltageConforms(probe)) {
+        report.fail(number, "voltage", "probe " + probe.num +
+                                           " voltage " + probe.voltage);
+      }
+    }
+
+    // Frame layout: only whole frames, received in order, are compared with
+    // the plan.
+    const size_t seq = static_cast<size_t>(atoi(chunk.seq.c_str()));
+
+    if (seq == 0) {
+      frame = FrameLayout();
+      frame.open = true;
+      frame.sampleId = chunk.sampleId;
+      frame.firstLine = number;
+      frame.hasTemp = chunk.hasTemp;
+      frame.tagged = chunk.tagged;
+      frame.tagIsString = chunk.tagIsString;
+      frame.tagKey = chunk.tagKey;
+      frame.tagValue = chunk.tagValue;
+    } else if (!frame.open ||
+               frame.sampleId != chunk.sampleId ||
+               frame.nextSeq != seq) {
+      frame.open = false;
+      continue;
+    }
+
+    frame.nextSeq = seq + 1;
+    frame.starts.push_back(static_cast<uint16_t>(frame.widths.size()));
+    for (const ChunkProbe& probe : chunk.probes) {
+      if (probe.quantized) {
+        frame.widths.push_back(liveReferenceQuantizedWidth(
+            static_cast<unsigned>(atoi(probe.num.c_str()))));
+        continue;
+      }
+      frame.widths.push_back(liveReferenceProbeWidth(
+          static_cast<unsigned>(atoi(probe.num.c_str())),
+          kindOf(probe, fractional),
+          probe.config.c_str(),
+          probe.direction.c_str(),
+          probe.src.c_str()));
+    }
+
+    if (chunk.last) {
+      checkPlan(frame, limit, report);
+      frame.open = false;
+    }
+  }
+
+  std::cout << report.chunks << " chunks (" << report.tagged
+            << " tagged), " << report.frames
+            << " frames checked against the plan at " << limit << " bytes\n";
+
+  for (const auto& entry : report.byCheck) {
+    std::cout << "  " << entry.second << " x " << entry.first << '\n';
+  }
+
+  std::cout << (report.failures == 0 ? "conforms" : "does not conform")
+            << '\n';
+  return report.failures == 0 ? 0 : 1;
+}
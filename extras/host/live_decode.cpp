@@ -0,0 +1,109 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Decodes a log of notify payloads, one JSON chunk per line, and prints the
+// reassembly statistics. Lines holding events, such as the schema events of
+// quantized probes, are passed to the decoder as events. With --csv, the frames are written as one column
+// per probe.
+//
+//     live_decode session.log
+//     live_decode --csv session.log > session.csv
+//
+
+#include "esp32_live_host.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static void printCsv(const LiveHostColumns& table) {
+  std::cout << "sample_id,timestamp";
+  for (uint8_t num : table.probes()) {
+    std::cout << ",p" << static_cast<int>(num);
+  }
+  std::cout << '\n';
+
+  for (size_t row = 0; row < table.rows(); ++row) {
+    std::cout << table.sampleIds()[row] << ',' << table.timestamps()[row];
+    for (uint8_t num : table.probes()) {
+      const double value = (*table.column(num))[row];
+      std::cout << ',';
+      if (!std::isnan(value)) {
+        std::cout << value;
+      }
+    }
+    std::cout << '\n';
+  }
+}
+
+int main(int argc, char** argv) {
+  bool csv = false;
+  const char* path = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if (argument == "--csv") {
+      csv = true;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  std::ifstream file;
+  if (path != nullptr) {
+    file.open(path);
+    if (!file) {
+      std::cerr << "cannot open " << path << '\n';
+      return 1;
+    }
+  }
+  std::istream& input = path != nullptr ? file : std::cin;
+
+  LiveHostDecoder decoder;
+  LiveHostColumns table;
+
+  decoder.onFrame([&](const LiveHostFrame& frame) {
+    if (csv && frame.complete && !frame.replayed) {
+      table.append(frame);
+    }
+  });
+
+  const auto started = std::chrono::steady_clock::now();
+
+  std::string line;
+  while (std::getline(input, line)) {
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(line.data());
+    if (line.find("\"event\"") != std::string::npos) {
+      decoder.pushEvent(payload, line.size());
+    } else if (!line.empty()) {
+      decoder.pushChunk(payload, line.size());
+    }
+  }
+  decoder.flush();
+
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - started).count();
+
+  if (csv) {
+    printCsv(table);
+  }
+
+  const LiveHostStats& stats = decoder.stats();
+  std::cerr << "chunks " << stats.chunks
+            << ", frames " << stats.frames
+            << " (" << stats.incompleteFrames << " incomplete)"
+            << ", malformed " << stats.malformedChunks
+            << ", gaps " << stats.gaps
+            << " (" << stats.missingSamples << " samples)"
+            << ", restarts " << stats.restarts
+            << ", unscaled " << stats.unscaledValues << '\n';
+  std::cerr << stats.values << " values in " << seconds << " s";
+  if (seconds > 0) {
+    std::cerr << ", " << stats.values / seconds / 1e6 << " M values/s";
+  }
+  std::cerr << '\n';
+  return 0;
+}
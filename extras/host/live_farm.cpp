@@ -0,0 +1,290 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Load test for the receiver: runs a farm of simulated devices on simulated
+// time and decodes their chunks on receiver threads through the loopback
+// transport. Each receiver has its own producer thread. Checks that every frame delivered intact is reassembled as
+// complete, and reports the decoding throughput.
+//
+//     live_farm --devices 500 --probes 12,40,150 --interval 20,50
+//     live_farm --devices 200 --loss 0.01 --burst 3 --receivers 4
+//
+// --probes and --interval take lists, assigned to the devices in turn.
+//
+
+#include "esp32_live_farm.h"
+#include "esp32_live_host.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+struct FarmOptions {
+  size_t devices = 100;
+  std::vector<uint32_t> probes{12};
+  std::vector<uint32_t> intervals{50};
+  uint16_t mtu = 247;
+  double lossRate = 0.0;
+  uint32_t burstLength = 1;
+  uint32_t seconds = 60;
+  size_t receivers = 2;
+};
+
+static std::vector<uint32_t> parseList(const std::string& text) {
+  std::vector<uint32_t> list;
+  std::stringstream stream(text);
+  std::string item;
+
+  while (std::getline(stream, item, ',')) {
+    list.push_back(static_cast<uint32_t>(std::stoul(item)));
+  }
+  return list;
+}
+
+static bool parseOptions(int argc, char** argv, FarmOptions& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string name = argv[i];
+    const std::string value = argv[i + 1];
+
+    if (name == "--devices") {
+      options.devices = std::stoul(value);
+    } else if (name == "--probes") {
+      options.probes = parseList(value);
+    } else if (name == "--interval") {
+      options.intervals = parseList(value);
+    } else if (name == "--mtu") {
+      options.mtu = static_cast<uint16_t>(std::stoul(value));
+    } else if (name == "--loss") {
+      options.lossRate = std::stod(value);
+    } else if (name == "--burst") {
+      options.burstLength = static_cast<uint32_t>(std::stoul(value));
+    } else if (name == "--seconds") {
+      options.seconds = static_cast<uint32_t>(std::stoul(value));
+    } else if (name == "--receivers") {
+      options.receivers = std::stoul(value);
+    } else {
+      return false;
+    }
+  }
+
+  return argc % 2 == 1 &&
+         options.devices > 0 &&
+         options.receivers > 0 &&
+         !options.probes.empty() &&
+         !options.intervals.empty();
+}
+
+// Probe numbers start at 100, like virtual probes on a board. The kinds
+// rotate so every chunk mixes the four encodings.
+static LiveFarmDeviceConfig deviceConfig(
+    const FarmOptions& options,
+    size_t device) {
+
+  static const LiveReferenceKind KINDS[] = {
+    LIVE_REFERENCE_VIRTUAL_FLOAT,
+    LIVE_REFERENCE_VIRTUAL_FLOAT,
+    LIVE_REFERENCE_VIRTUAL_INT,
+    LIVE_REFERENCE_ANALOG,
+    LIVE_REFERENCE_DIGITAL
+  };
+
+  LiveFarmDeviceConfig config;
+  const uint32_t count = options.probes[device % options.probes.size()];
+
+  for (uint32_t i = 0; i < count && i < 156; ++i) {
+    config.probes.push_back(LiveFarmProbe{
+        static_cast<uint8_t>(100 + i),
+        KINDS[i % (sizeof(KINDS) / sizeof(KINDS[0]))]});
+  }
+
+  config.intervalMs = options.intervals[device % options.intervals.size()];
+  config.mtu = options.mtu;
+  config.lossRate = options.lossRate;
+  config.burstLength = options.burstLength;
+  config.seed = static_cast<uint32_t>(device * 2654435761u + 1);
+  return config;
+}
+
+struct ReceiverResult {
+  LiveHostStats stats;
+  uint64_t completeFrames = 0;
+};
+
+static void runReceiver(
+    LiveFarmLoopback& loopback,
+    size_t receiver,
+    size_t devices,
+    ReceiverResult& result) {
+
+  const size_t receivers = loopback.receivers();
+  std::vector<LiveHostDecoder> decoders((devices - receiver + receivers - 1) /
+                                        receivers);
+
+  for (LiveHostDecoder& decoder : decoders) {
+    decoder.onFrame([&](const LiveHostFrame& frame) {
+      if (frame.complete) {
+        ++result.completeFrames;
+      }
+    });
+  }
+
+  std::vector<LiveFarmNotification> batch;
+  while (loopback.receive(receiver, batch, 256)) {
+    for (const LiveFarmNotification& notification : batch) {
+      decoders[notification.device / receivers].pushChunk(
+          reinterpret_cast<const uint8_t*>(notification.payload.data()),
+          notification.payload.size());
+    }
+  }
+
+  for (LiveHostDecoder& decoder : decoders) {
+    decoder.flush();
+
+    const LiveHostStats& stats = decoder.stats();
+    result.stats.chunks += stats.chunks;
+    result.stats.frames += stats.frames;
+    result.stats.incompleteFrames += stats.incompleteFrames;
+    result.stats.malformedChunks += stats.malformedChunks;
+    result.stats.values += stats.values;
+    result.stats.gaps += stats.gaps;
+    result.stats.missingSamples += stats.missingSamples;
+    result.stats.restarts += stats.restarts;
+  }
+}
+
+// Samples the devices served by one receiver, in simulated time order.
+static void runProducer(
+    std::vector<LiveFarmDevice>& farm,
+    LiveFarmLoopback& loopback,
+    size_t receiver,
+    uint64_t endMs) {
+
+  using Due = std::pair<uint64_t, uint32_t>;
+  std::priority_queue<Due, std::vector<Due>, std::greater<Due>> due;
+
+  for (size_t d = receiver; d < farm.size(); d += loopback.receivers()) {
+    due.push(Due{farm[d].nextSampleMs(), static_cast<uint32_t>(d)});
+  }
+
+  while (!due.empty() && due.top().first < endMs) {
+    const uint32_t d = due.top().second;
+    due.pop();
+
+    farm[d].sample([&](const char* data, size_t length) {
+      loopback.send(d, data, length);
+    });
+    due.push(Due{farm[d].nextSampleMs(), d});
+  }
+}
+
+int main(int argc, char** argv) {
+  FarmOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    std::cerr << "usage: live_farm [--devices N] [--probes N,...]"
+                 " [--interval MS,...] [--mtu N]\n"
+                 "                 [--loss RATE] [--burst N] [--seconds N]"
+                 " [--receivers N]\n";
+    return 1;
+  }
+
+  std::vector<LiveFarmDevice> farm(options.devices);
+  for (size_t d = 0; d < farm.size(); ++d) {
+    if (!farm[d].configure(deviceConfig(options, d))) {
+      std::cerr << "invalid configuration for device " << d << '\n';
+      return 1;
+    }
+  }
+
+  LiveFarmLoopback loopback(options.receivers, 4096);
+  std::vector<ReceiverResult> results(options.receivers);
+  std::vector<std::thread> threads;
+
+  const auto started = std::chrono::steady_clock::now();
+
+  for (size_t r = 0; r < options.receivers; ++r) {
+    threads.emplace_back(
+        runReceiver,
+        std::ref(loopback),
+        r,
+        options.devices,
+        std::ref(results[r]));
+  }
+
+  // One producer per receiver, so generating the load is never the limit.
+  const uint64_t endMs = static_cast<uint64_t>(options.seconds) * 1000;
+  std::vector<std::thread> producers;
+
+  for (size_t r = 0; r < options.receivers; ++r) {
+    producers.emplace_back(
+        runProducer,
+        std::ref(farm),
+        std::ref(loopback),
+        r,
+        endMs);
+  }
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+
+  loopback.close();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - started).count();
+
+  LiveFarmDeviceStats sent;
+  for (const LiveFarmDevice& device : farm) {
+    sent.frames += device.stats().frames;
+    sent.chunks += device.stats().chunks;
+    sent.droppedChunks += device.stats().droppedChunks;
+    sent.deliveredFrames += device.stats().deliveredFrames;
+  }
+
+  LiveHostStats received;
+  uint64_t completeFrames = 0;
+  for (const ReceiverResult& result : results) {
+    received.chunks += result.stats.chunks;
+    received.frames += result.stats.frames;
+    received.incompleteFrames += result.stats.incompleteFrames;
+    received.malformedChunks += result.stats.malformedChunks;
+    received.values += result.stats.values;
+    received.gaps += result.stats.gaps;
+    received.missingSamples += result.stats.missingSamples;
+    completeFrames += result.completeFrames;
+  }
+
+  std::cout << options.devices << " devices, " << options.seconds
+            << " s simulated, " << options.receivers << " receivers\n"
+            << "sent: frames " << sent.frames
+            << ", chunks " << sent.chunks
+            << " (" << sent.droppedChunks << " dropped)\n"
+            << "received: chunks " << received.chunks
+            << ", frames " << received.frames
+            << " (" << received.incompleteFrames << " incomplete)"
+            << ", malformed " << received.malformedChunks
+            << ", gaps " << received.gaps
+            << " (" << received.missingSamples << " samples)\n"
+            << received.chunks / seconds << " chunks/s, "
+            << received.values / seconds / 1e6 << " M values/s in "
+            << seconds << " s\n";
+
+  const bool consistent =
+      received.chunks == sent.chunks - sent.droppedChunks &&
+      received.malformedChunks == 0 &&
+      completeFrames == sent.deliveredFrames;
+
+  if (!consistent) {
+    std::cout << "MISMATCH: " << completeFrames << " complete frames for "
+              << sent.deliveredFrames << " delivered intact\n";
+    return 1;
+  }
+  return 0;
+}
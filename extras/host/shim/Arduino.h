@@ -0,0 +1,78 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Host stand-in for the part of the Arduino core that the device serializer
+// (src/esp32_live_json.cpp) uses: the String class, over std::string.
+// ArduinoJson is built with ARDUINOJSON_ENABLE_ARDUINO_STRING=1, so it
+// reads and writes this String as it does the real one.
+//
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+class String {
+public:
+  String(const char* text = "") : text_(text != nullptr ? text : "") {}
+
+  const char* c_str() const {
+    return text_.c_str();
+  }
+
+  unsigned int length() const {
+    return static_cast<unsigned int>(text_.size());
+  }
+
+  bool reserve(unsigned int size) {
+    text_.reserve(size);
+    return true;
+  }
+
+  bool concat(const char* text) {
+    text_ += text;
+    return true;
+  }
+
+  bool concat(char c) {
+    text_ += c;
+    return true;
+  }
+
+  String& operator+=(const char* text) {
+    text_ += text;
+    return *this;
+  }
+
+  String& operator+=(char c) {
+    text_ += c;
+    return *this;
+  }
+
+  bool operator==(const String& other) const {
+    return text_ == other.text_;
+  }
+
+  bool operator==(const char* text) const {
+    return text_ == text;
+  }
+
+  bool operator!=(const char* text) const {
+    return text_ != text;
+  }
+
+private:
+  std::string text_;
+};
+
+// Result type of String concatenation in the Arduino core. ArduinoJson
+// names it in its String adapter.
+class StringSumHelper : public String {
+public:
+  using String::String;
+};
@@ -0,0 +1,378 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Feeds LiveHostDecoder chunks rendered by the reference encoder
+// (esp32_live_reference.cpp): reassembly by sample_id, seq and last, lost
+// chunks, sample_id gaps and restarts, replayed uploads, values carried
+// forward by change-only frames and the scaling of quantized codes.
+// The exit status is 1 when a check fails.
+//
+//     make test_decoder && ./test_decoder
+//
+
+#include "esp32_live_host.h"
+#include "esp32_live_reference.h"
+
+#include "../../src/esp32_live_quant.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition)                                          \
+  do {                                                            \
+    if (!(condition)) {                                           \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+             #condition);                                         \
+      ++failures;                                                 \
+    }                                                             \
+  } while (0)
+
+static bool near(double actual, double expected) {
+  return fabs(actual - expected) <= 1e-9 * (1.0 + fabs(expected));
+}
+
+// One chunk of the notify characteristic, built field by field with the
+// reference encoder.
+class Chunk {
+public:
+  Chunk(
+      uint32_t sampleId,
+      unsigned seq,
+      bool last,
+      const char* tagKey = nullptr) {
+
+    char id[16];
+    char timestamp[24];
+    char sequence[8];
+    snprintf(id, sizeof(id), "%lu", static_cast<unsigned long>(sampleId));
+    snprintf(timestamp, sizeof(timestamp), "%lu",
+             static_cast<unsigned long>(sampleId) * 20UL);
+    snprintf(sequence, sizeof(sequence), "%u", seq);
+
+    liveReferenceHeader(
+        text, timestamp, "20", nullptr, id, sequence, last, tagKey);
+  }
+
+  Chunk& value(unsigned num, double value) {
+    char decimal[32];
+    liveReferenceDecimal(decimal, sizeof(decimal), value, 3);
+    separate();
+    liveReferenceProbe(
+        text, num, LIVE_REFERENCE_VIRTUAL_FLOAT, "VIRTUAL", "-", "virtual",
+        decimal, nullptr);
+    return *this;
+  }
+
+  Chunk& analog(unsigned num, unsigned raw, const char* voltage) {
+    char value[8];
+    snprintf(value, sizeof(value), "%u", raw);
+    separate();
+    liveReferenceProbe(
+        text, num, LIVE_REFERENCE_ANALOG, "ANALOG", "IN", "hw", value,
+        voltage);
+    return *this;
+  }
+
+  Chunk& code(unsigned num, uint32_t code) {
+    char value[12];
+    snprintf(value, sizeof(value), "%lu", static_cast<unsigned long>(code));
+    separate();
+    liveReferenceQuantized(text, num, value);
+    return *this;
+  }
+
+  bool push(LiveHostDecoder& decoder) {
+    const std::string chunk = text + "]}";
+    return decoder.pushChunk(
+        reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size());
+  }
+
+private:
+  void separate() {
+    if (text.back() != '[') {
+      text += ',';
+    }
+  }
+
+  std::string text;
+};
+
+// Copies of the delivered frames, which only live as long as the handler.
+struct Received {
+  uint32_t sampleId;
+  bool complete;
+  bool replayed;
+  bool changesOnly;
+  std::vector<uint8_t> nums;
+  std::vector<double> values;
+};
+
+static void record(LiveHostDecoder& decoder, std::vector<Received>& frames) {
+  decoder.onFrame([&frames](const LiveHostFrame& frame) {
+    Received copy;
+    copy.sampleId = frame.sampleId;
+    copy.complete = frame.complete;
+    copy.replayed = frame.replayed;
+    copy.changesOnly = frame.changesOnly;
+    copy.nums.assign(frame.nums, frame.nums + frame.count);
+    copy.values.assign(frame.values, frame.values + frame.count);
+    frames.push_back(copy);
+  });
+}
+
+static bool pushEvent(LiveHostDecoder& decoder, const std::string& event) {
+  return decoder.pushEvent(
+      reinterpret_cast<const uint8_t*>(event.data()), event.size());
+}
+
+// A frame split over three chunks is delivered once, on the chunk marked
+// last, with its probes in order.
+static void testReassembly() {
+  LiveHostDecoder decoder;
+  std::vector<Received> frames;
+  record(decoder, frames);
+
+  CHECK(Chunk(5, 0, false).value(1, 1.5).value(2, -2.25).push(decoder));
+  CHECK(Chunk(5, 1, false).analog(34, 2048, "1.65").push(decoder));
+  CHECK(frames.empty());
+  CHECK(Chunk(5, 2, true).value(3, 1e6).push(decoder));
+
+  CHECK(frames.size() == 1);
+  if (frames.size() == 1) {
+    const Received& frame = frames[0];
+    CHECK(frame.sampleId == 5 && frame.complete);
+    CHECK(!frame.replayed && !frame.changesOnly);
+    CHECK((frame.nums == std::vector<uint8_t>{1, 2, 34, 3}));
+    CHECK(frame.values.size() == 4 &&
+          near(frame.values[0], 1.5) &&
+          near(frame.values[1], -2.25) &&
+          near(frame.values[2], 2048.0) &&
+          near(frame.values[3], 1e6));
+  }
+
+  CHECK(Chunk(6, 0, true).value(1, 0.0).push(decoder));
+  CHECK(frames.size() == 2 && frames[1].sampleId == 6 && frames[1].complete);
+
+  // A frame without probes still carries its sample_id.
+  CHECK(Chunk(7, 0, true).push(decoder));
+  CHECK(frames.size() == 3 && frames[2].nums.empty() && frames[2].complete);
+
+  const LiveHostStats& stats = decoder.stats();
+  CHECK(stats.chunks == 5);
+  CHECK(stats.frames == 3);
+  CHECK(stats.values == 5);
+  CHECK(stats.incompleteFrames == 0);
+  CHECK(stats.malformedChunks == 0);
+}
+
+// A missing middle, first or last chunk marks the frame incomplete; the
+// values that did arrive are still delivered.
+static void testLostChunks() {
+  LiveHostDecoder decoder;
+  std::vector<Received> frames;
+  record(decoder, frames);
+
+  Chunk(10, 0, false).value(1, 1.0).push(decoder);
+  Chunk(10, 2, true).value(3, 3.0).push(decoder);
+  CHECK(frames.size() == 1 && !frames[0].complete);
+  CHECK(frames.size() == 1 && (frames[0].nums == std::vector<uint8_t>{1, 3}));
+
+  // The last chunk of 11 is lost: the first chunk of 12 ends it.
+  Chunk(11, 0, false).value(1, 1.0).push(decoder);
+  Chunk(12, 0, true).value(1, 2.0).push(decoder);
+  CHECK(frames.size() == 3);
+  CHECK(frames.size() == 3 && frames[1].sampleId == 11 && !frames[1].complete);
+  CHECK(frames.size() == 3 && frames[2].sampleId == 12 && frames[2].complete);
+
+  // The first chunk of 13 is lost.
+  Chunk(13, 1, true).value(2, 2.0).push(decoder);
+  CHECK(frames.size() == 4 && !frames[3].complete);
+
+  // flush() hands out a frame still waiting for its last chunk.
+  Chunk(14, 0, false).value(1, 4.0).push(decoder);
+  CHECK(frames.size() == 4);
+  decoder.flush();
+  CHECK(frames.size() == 5 && frames[4].sampleId == 14 && !frames[4].complete);
+
+  CHECK(decoder.stats().incompleteFrames == 4);
+  CHECK(decoder.stats().gaps == 0);
+
+  const char* truncated = "{\"ver\":\"1.7.2\",\"sample_id\":15,\"pins\":[{";
+  CHECK(!decoder.pushChunk(
+      reinterpret_cast<const uint8_t*>(truncated), strlen(truncated)));
+  CHECK(decoder.stats().malformedChunks == 1);
+}
+
+// Skipped identifiers are reported once per gap; replayed uploads carry old
+// identifiers and are left out; an identifier going back is a restart.
+static void testGaps() {
+  LiveHostDecoder decoder;
+  std::vector<Received> frames;
+  record(decoder, frames);
+
+  std::vector<uint32_t> gapFirst;
+  std::vector<uint32_t> gapCount;
+  decoder.onGap([&](uint32_t firstMissing, uint32_t count) {
+    gapFirst.push_back(firstMissing);
+    gapCount.push_back(count);
+  });
+
+  Chunk(100, 0, true).value(1, 1.0).push(decoder);
+  Chunk(101, 0, true).value(1, 1.0).push(decoder);
+  Chunk(104, 0, true).value(1, 1.0).push(decoder);
+
+  CHECK(gapFirst.size() == 1);
+  CHECK(gapFirst.size() == 1 && gapFirst[0] == 102 && gapCount[0] == 2);
+
+  Chunk(7, 0, true, "ulp").value(1, 1.0).push(decoder);
+  Chunk(8, 0, true, "blackbox").value(1, 1.0).push(decoder);
+  CHECK(frames.size() == 5 && frames[3].replayed && frames[4].replayed);
+
+  Chunk(105, 0, true).value(1, 1.0).push(decoder);
+  CHECK(gapFirst.size() == 1);
+  CHECK(decoder.stats().restarts == 0);
+
+  Chunk(0, 0, true).value(1, 1.0).push(decoder);
+  CHECK(decoder.stats().restarts == 1);
+  CHECK(gapFirst.size() == 1);
+
+  const LiveHostStats& stats = decoder.stats();
+  CHECK(stats.gaps == 1);
+  CHECK(stats.missingSamples == 2);
+  CHECK(stats.frames == 7);
+}
+
+// A change-only frame lists only the probes that changed; the columnar store
+// carries the others forward from the previous row. A regular frame does
+// not, so a missing probe there is NaN.
+static void testChangesOnly() {
+  LiveHostDecoder decoder;
+  std::vector<Received> frames;
+  record(decoder, frames);
+
+  LiveHostColumns columns;
+  decoder.onFrame([&](const LiveHostFrame& frame) {
+    columns.append(frame);
+  });
+
+  Chunk(20, 0, true).value(1, 1.0).value(2, 2.0).value(3, 3.0).push(decoder);
+  Chunk(21, 0, true, "changes").value(2, 5.0).push(decoder);
+  Chunk(22, 0, true, "changes").push(decoder);
+  Chunk(23, 0, true, "changes").value(1, -1.0).value(3, 9.0).push(decoder);
+  Chunk(24, 0, true).value(1, 0.5).push(decoder);
+
+  CHECK(columns.rows() == 5);
+  const std::vector<double>* one = columns.column(1);
+  const std::vector<double>* two = columns.column(2);
+  const std::vector<double>* three = columns.column(3);
+  CHECK(one != nullptr && two != nullptr && three != nullptr);
+  if (one == nullptr || two == nullptr || three == nullptr) {
+    return;
+  }
+
+  const double expectedOne[] = {1.0, 1.0, 1.0, -1.0, 0.5};
+  const double expectedTwo[] = {2.0, 5.0, 5.0, 5.0, NAN};
+  const double expectedThree[] = {3.0, 3.0, 3.0, 9.0, NAN};
+
+  for (size_t row = 0; row < 5; ++row) {
+    CHECK(near((*one)[row], expectedOne[row]));
+    CHECK(isnan(expectedTwo[row]) ? isnan((*two)[row])
+                                  : near((*two)[row], expectedTwo[row]));
+    CHECK(isnan(expectedThree[row]) ? isnan((*three)[row])
+                                    : near((*three)[row], expectedThree[row]));
+  }
+
+  CHECK(decoder.stats().gaps == 0);
+
+  // The change-only flag reaches the frame handler as well.
+  LiveHostDecoder flagged;
+  std::vector<Received> flaggedFrames;
+  record(flagged, flaggedFrames);
+  Chunk(30, 0, true, "changes").value(2, 1.0).push(flagged);
+  CHECK(flaggedFrames.size() == 1 && flaggedFrames[0].changesOnly &&
+        !flaggedFrames[0].replayed);
+}
+
+// Codes are scaled with the range of the probe's schema event. A code that
+// arrives before the schema is delivered as NaN and counted.
+static void testQuantized() {
+  LiveHostDecoder decoder;
+  std::vector<Received> frames;
+  record(decoder, frames);
+
+  Chunk(40, 0, true).code(9, 100).push(decoder);
+  CHECK(frames.size() == 1 && isnan(frames[0].values[0]));
+  CHECK(decoder.stats().unscaledValues == 1);
+
+  CHECK(pushEvent(
+      decoder,
+      "{\"ver\":\"1.7.2\",\"event\":\"schema\",\"num\":9,\"units\":\"degC\","
+      "\"min\":-40,\"max\":125,\"bits\":12,\"scale\":0.04029304}"));
+
+  const LiveHostSchema* schema = decoder.schema(9);
+  CHECK(schema != nullptr);
+  CHECK(schema != nullptr && schema->bits == 12 && schema->units == "degC");
+
+  const float temperatures[] = {-40.0f, 21.37f, 124.99f, 125.0f, 300.0f};
+  const uint32_t codes[] = {
+      liveQuantize(temperatures[0], -40.0f, 125.0f, 12),
+      liveQuantize(temperatures[1], -40.0f, 125.0f, 12),
+      liveQuantize(temperatures[2], -40.0f, 125.0f, 12),
+      liveQuantize(temperatures[3], -40.0f, 125.0f, 12),
+      liveQuantize(temperatures[4], -40.0f, 125.0f, 12)};
+
+  Chunk chunk(41, 0, true);
+  for (uint32_t code : codes) {
+    chunk.code(9, code);
+  }
+  chunk.value(1, 2.5);
+  chunk.push(decoder);
+
+  CHECK(frames.size() == 2);
+  if (frames.size() == 2) {
+    const std::vector<double>& values = frames[1].values;
+    const double halfStep = liveQuantScale(-40.0, 125.0, 12) / 2;
+
+    CHECK(values.size() == 6);
+    CHECK(near(values[0], -40.0));
+    CHECK(fabs(values[1] - 21.37) <= halfStep);
+    CHECK(fabs(values[2] - 124.99) <= halfStep);
+    CHECK(near(values[3], 125.0));
+    CHECK(near(values[4], 125.0));
+    CHECK(near(values[1], liveDequantize(codes[1], -40.0, 125.0, 12)));
+    CHECK(near(values[5], 2.5));
+  }
+  CHECK(decoder.stats().unscaledValues == 1);
+
+  // Other events leave the schemas alone; a malformed schema is rejected.
+  CHECK(pushEvent(
+      decoder,
+      "{\"ver\":\"1.7.2\",\"event\":\"alarm\",\"id\":0,\"state\":\"raised\"}"));
+  CHECK(!pushEvent(
+      decoder,
+      "{\"ver\":\"1.7.2\",\"event\":\"schema\",\"num\":9,\"units\":\"\","
+      "\"min\":5,\"max\":5,\"bits\":8}"));
+  CHECK(decoder.schema(9) != nullptr && decoder.schema(9)->bits == 12);
+}
+
+int main() {
+  testReassembly();
+  testLostChunks();
+  testGaps();
+  testChangesOnly();
+  testQuantized();
+
+  if (failures != 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("host decoder: all checks passed\n");
+  return 0;
+}
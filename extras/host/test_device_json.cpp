@@ -0,0 +1,308 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Renders the golden frames (golden/, see test_golden.cpp) with the device
+// serializer, src/esp32_live_json.cpp, built on the host against
+// ArduinoJson with the String shim in shim/. The probe entries, values and
+// header fields are those of the golden cases. Chunks are laid out as
+// sendFrame() and liveSendProbeValues() lay them out, from the device's own
+// worst-case widths, and compared with the golden files. The worst-case
+// widths are also compared with those of the reference encoder. The exit
+// status is 1 when a check fails.
+//
+//     make test_device_json6 ARDUINOJSON6=<ArduinoJson 6>/src
+//     make test_device_json7 ARDUINOJSON7=<ArduinoJson 7>/src
+//     ./test_device_json6 && ./test_device_json7
+//
+
+#include "../../src/esp32_live_json.h"
+#include "../../src/esp32_live_plan.h"
+#include "esp32_live_golden.h"
+#include "esp32_live_reference.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition)                                          \
+  do {                                                            \
+    if (!(condition)) {                                           \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+             #condition);                                         \
+      ++failures;                                                 \
+    }                                                             \
+  } while (0)
+
+// The golden cases are laid out for the classic ESP32, whose DAC pins are
+// 25 and 26.
+bool isDacPin(uint8_t n) {
+  return n == 25 || n == 26;
+}
+
+/* --------------------------------------------------------------------------
+   Probe entries
+   -------------------------------------------------------------------------- */
+
+// The entry esp32_live_register_pin(), ESP32_PROBE_VIRTUAL(),
+// ESP32_PROBE_GETTER() or esp32_live_probe_schema() leaves for a golden
+// probe. Quantized probes span 0 to 65535 in 16 bits, so each code is sent
+// for the value equal to it.
+static ProbeEntry makeProbe(const GoldenProbe& probe) {
+  ProbeEntry entry = ProbeEntry();
+  entry.num = static_cast<uint8_t>(probe.num);
+  entry.ctxGetter.type = LIVE_VALUE_FLOAT;
+
+  switch (probe.kind) {
+    case LIVE_REFERENCE_VIRTUAL_FLOAT:
+    case LIVE_REFERENCE_VIRTUAL_INT:
+      entry.cfg = "VIRTUAL";
+      entry.dir = probe.direction;
+      entry.kind = LIVE_PROBE_VIRTUAL;
+      break;
+    case LIVE_REFERENCE_ANALOG:
+      entry.cfg = probe.config;
+      entry.dir = probe.direction;
+      entry.kind = strcmp(probe.direction, "OUT") == 0 && isDacPin(entry.num)
+                       ? LIVE_PROBE_DAC_OUT
+                       : LIVE_PROBE_ANALOG;
+      break;
+    case LIVE_REFERENCE_DIGITAL:
+      entry.cfg = probe.config;
+      entry.dir = probe.direction;
+      entry.kind = LIVE_PROBE_DIGITAL;
+      break;
+  }
+
+  if (probe.kind == LIVE_REFERENCE_VIRTUAL_INT) {
+    entry.hasCtxGetter = true;
+    entry.ctxGetter.type = LIVE_VALUE_INT32;
+  }
+
+  if (probe.quantized) {
+    entry.hasSchema = true;
+    entry.quantBits = 16;
+    entry.quantMin = 0.0f;
+    entry.quantMax = 65535.0f;
+  }
+  return entry;
+}
+
+static LiveValue captured(const GoldenProbe& probe, size_t pick) {
+  LiveValue value;
+  value.i = 0;
+
+  if (probe.quantized) {
+    value.f = static_cast<float>(liveGoldenCode(pick));
+    return value;
+  }
+
+  switch (probe.kind) {
+    case LIVE_REFERENCE_VIRTUAL_FLOAT:
+      value.f = liveGoldenFloat(pick);
+      break;
+    case LIVE_REFERENCE_VIRTUAL_INT:
+      value.i = liveGoldenInt(pick);
+      break;
+    case LIVE_REFERENCE_ANALOG:
+      value.i = static_cast<int32_t>(liveGoldenAnalog(pick));
+      break;
+    case LIVE_REFERENCE_DIGITAL:
+      value.i = static_cast<int32_t>(liveGoldenDigital(pick));
+      break;
+  }
+  return value;
+}
+
+static uint16_t referenceWidth(const GoldenProbe& probe) {
+  if (probe.quantized) {
+    return liveReferenceQuantizedWidth(probe.num);
+  }
+  return liveReferenceProbeWidth(
+      probe.num, probe.kind, probe.config, probe.direction, probe.src);
+}
+
+/* --------------------------------------------------------------------------
+   Rendering
+   -------------------------------------------------------------------------- */
+
+// Every frame of a case, chunk by chunk. Full frames go through sendFrame()
+// with the values in probe order; partial and tagged frames through
+// liveSendProbeValues() with an index list.
+static void render(const GoldenCase& golden, std::vector<std::string>& out) {
+  out.clear();
+  const std::vector<GoldenProbe>& probes = *golden.probes;
+
+  std::vector<ProbeEntry> entries;
+  for (const GoldenProbe& probe : probes) {
+    entries.push_back(makeProbe(probe));
+    CHECK(liveJsonWorstProbeWidth(entries.back()) == referenceWidth(probe));
+  }
+
+  const size_t headerWidth = liveJsonWorstHeaderWidth(golden.temp);
+  CHECK(headerWidth == liveReferenceHeaderWidth(golden.temp));
+
+  const bool partial = !golden.subsets.empty() || golden.tagKey != nullptr;
+
+  for (size_t frame = 0; frame < golden.frames; ++frame) {
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+    JsonDocument headerDocument;
+#else
+    StaticJsonDocument<256> headerDocument;
+#endif
+
+    liveJsonAddHeader(
+        headerDocument.to<JsonObject>(),
+        liveGoldenTimestamp(frame),
+        LIVE_GOLDEN_RATE_MS,
+        golden.temp ? &LIVE_GOLDEN_TEMPERATURE : nullptr);
+    headerDocument["sample_id"] = liveGoldenSampleId(frame);
+
+    size_t width = headerWidth;
+    if (golden.tagKey != nullptr) {
+      width += liveJsonAddTag(
+          headerDocument.as<JsonObject>(), golden.tagKey, golden.tagValue);
+      CHECK(width == liveReferenceHeaderWidth(
+                         golden.temp, golden.tagKey, golden.tagValue));
+    }
+
+    const std::vector<size_t> present = liveGoldenPresent(golden, frame);
+    std::vector<uint16_t> indices;
+    std::vector<LiveValue> values;
+    std::vector<uint16_t> widths;
+
+    for (size_t position : present) {
+      indices.push_back(static_cast<uint16_t>(position));
+      values.push_back(captured(
+          probes[position], liveGoldenPick(frame, position)));
+      widths.push_back(liveJsonWorstProbeWidth(entries[position]));
+    }
+
+    LiveChunkPlan plan;
+    liveBuildChunkPlan(
+        plan, width, widths.data(), widths.size(), golden.limit);
+    if (present.empty()) {
+      plan.starts.assign(2, 0);
+    }
+
+    const JsonObjectConst header = headerDocument.as<JsonObjectConst>();
+
+    for (size_t chunk = 0; chunk < plan.chunkCount(); ++chunk) {
+      char buffer[LIVE_JSON_CHUNK_BYTES];
+      const size_t length = liveJsonEncodeChunk(
+          header,
+          entries.data(),
+          partial ? indices.data() : nullptr,
+          values.data(),
+          plan.starts[chunk],
+          plan.starts[chunk + 1],
+          static_cast<uint16_t>(chunk),
+          chunk + 1 == plan.chunkCount(),
+          buffer,
+          sizeof(buffer));
+      out.emplace_back(buffer, length);
+    }
+  }
+}
+
+/* --------------------------------------------------------------------------
+   Checks
+   -------------------------------------------------------------------------- */
+
+static bool followsKey(const std::string& text, size_t at, const char* key) {
+  const size_t length = strlen(key);
+  return at >= length && text.compare(at - length, length, key) == 0;
+}
+
+// Voltages of analog probes and the chip temperature are printed from a
+// float, and ArduinoJson 6 and 7 print floats with different digits: they
+// are compared by value at float precision, as live_conform does. Every
+// other byte must match.
+static bool sameChunk(const std::string& golden, const std::string& device) {
+  size_t g = 0;
+  size_t d = 0;
+
+  while (g < golden.size() && d < device.size()) {
+    if (golden[g++] != device[d++]) {
+      return false;
+    }
+    if (!followsKey(golden, g, "\"voltage\":") &&
+        !followsKey(golden, g, "\"temp\":")) {
+      continue;
+    }
+
+    const size_t goldenEnd = golden.find_first_of(",}]", g);
+    const size_t deviceEnd = device.find_first_of(",}]", d);
+    if (goldenEnd == std::string::npos || deviceEnd == std::string::npos) {
+      return false;
+    }
+
+    const std::string expected = golden.substr(g, goldenEnd - g);
+    const std::string actual = device.substr(d, deviceEnd - d);
+    if (expected != actual) {
+      if (expected[0] == '"' || actual[0] == '"') {
+        return false;
+      }
+      const double want = atof(expected.c_str());
+      if (fabs(atof(actual.c_str()) - want) > 1e-6 * (1.0 + fabs(want))) {
+        return false;
+      }
+    }
+    g = goldenEnd;
+    d = deviceEnd;
+  }
+  return g == golden.size() && d == device.size();
+}
+
+static void checkCase(const GoldenCase& golden, const std::string& directory) {
+  std::vector<std::string> chunks;
+  render(golden, chunks);
+
+  const std::string path = directory + "/" + golden.name + ".log";
+
+  std::vector<std::string> expected;
+  if (!liveGoldenRead(path, expected)) {
+    printf("%s: cannot read %s\n", golden.name, path.c_str());
+    ++failures;
+    return;
+  }
+
+  if (expected.size() != chunks.size()) {
+    printf("%s: %zu chunks, golden file has %zu\n",
+           golden.name, chunks.size(), expected.size());
+    ++failures;
+  }
+
+  for (size_t i = 0; i < chunks.size() && i < expected.size(); ++i) {
+    if (!sameChunk(expected[i], chunks[i])) {
+      printf("%s: chunk %zu differs\n  golden: %s\n  device: %s\n",
+             golden.name, i + 1, expected[i].c_str(), chunks[i].c_str());
+      ++failures;
+      break;
+    }
+  }
+
+  printf("  %-16s %3zu chunks\n", golden.name, chunks.size());
+}
+
+int main(int argc, char** argv) {
+  const std::string directory = argc > 1 ? argv[1] : "golden";
+
+  for (const GoldenCase& golden : liveGoldenCases()) {
+    checkCase(golden, directory);
+  }
+
+  if (failures != 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("device serializer, ArduinoJson %d: all checks passed\n",
+         ARDUINOJSON_VERSION_MAJOR);
+  return 0;
+}
@@ -0,0 +1,270 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Golden frames of the notify protocol. Representative probe sets are laid
+// out by the chunk plan (src/esp32_live_plan.cpp) at several chunk limits,
+// rendered by the reference encoder and compared byte for byte with the
+// files in golden/, one chunk per line. Each case also has an encode-time
+// budget for the reference encoder. The exit status is 1 when a check
+// fails.
+//
+//     make test_golden && ./test_golden
+//     ./test_golden --update        rewrites golden/ after a reviewed change
+//
+// The golden files are live_conform input as well, so a capture from a
+// board can be compared with them field by field.
+//
+
+#include "../../src/esp32_live_plan.h"
+#include "esp32_live_golden.h"
+#include "esp32_live_reference.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition)                                          \
+  do {                                                            \
+    if (!(condition)) {                                           \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+             #condition);                                         \
+      ++failures;                                                 \
+    }                                                             \
+  } while (0)
+
+// Reference encoder time per chunk, averaged over many frames. Generous:
+// it catches an accidental quadratic step, not scheduler noise.
+static const double ENCODE_BUDGET_US_PER_CHUNK = 50.0;
+static const int ENCODE_ROUNDS = 2000;
+
+/* --------------------------------------------------------------------------
+   Rendering
+   -------------------------------------------------------------------------- */
+
+static void appendProbe(
+    std::string& out,
+    const GoldenProbe& probe,
+    size_t frame,
+    size_t position) {
+
+  const size_t pick = liveGoldenPick(frame, position);
+  char value[32];
+  char voltage[32] = "0";
+
+  if (probe.quantized) {
+    snprintf(value, sizeof(value), "%u", liveGoldenCode(pick));
+    liveReferenceQuantized(out, probe.num, value);
+    return;
+  }
+
+  switch (probe.kind) {
+    case LIVE_REFERENCE_VIRTUAL_FLOAT:
+      liveReferenceDecimal(value, sizeof(value), liveGoldenFloat(pick), 3);
+      break;
+    case LIVE_REFERENCE_VIRTUAL_INT:
+      snprintf(value, sizeof(value), "%ld",
+               static_cast<long>(liveGoldenInt(pick)));
+      break;
+    case LIVE_REFERENCE_ANALOG: {
+      const unsigned raw = liveGoldenAnalog(pick);
+      snprintf(value, sizeof(value), "%u", raw);
+      liveReferenceDecimal(
+          voltage, sizeof(voltage), 3.3f * raw / 4095.0f, 9);
+      break;
+    }
+    case LIVE_REFERENCE_DIGITAL:
+      snprintf(value, sizeof(value), "%u", liveGoldenDigital(pick));
+      if (liveGoldenDigital(pick) != 0) {
+        strcpy(voltage, "3.3");
+      }
+      break;
+  }
+
+  liveReferenceProbe(
+      out,
+      probe.num,
+      probe.kind,
+      probe.config,
+      probe.direction,
+      probe.src,
+      value,
+      voltage);
+}
+
+static uint16_t worstWidth(const GoldenProbe& probe) {
+  if (probe.quantized) {
+    return liveReferenceQuantizedWidth(probe.num);
+  }
+  return liveReferenceProbeWidth(
+      probe.num, probe.kind, probe.config, probe.direction, probe.src);
+}
+
+struct RenderedChunk {
+  std::string text;
+  size_t probes;
+};
+
+// Every frame of a case, chunk by chunk, as sendFrame() or
+// liveSendProbeValues() lays it out.
+static void render(const GoldenCase& golden, std::vector<RenderedChunk>& out) {
+  out.clear();
+  const std::vector<GoldenProbe>& probes = *golden.probes;
+
+  const size_t headerWidth =
+      liveReferenceHeaderWidth(golden.temp, golden.tagKey, golden.tagValue);
+
+  for (size_t frame = 0; frame < golden.frames; ++frame) {
+    const std::vector<size_t> present = liveGoldenPresent(golden, frame);
+
+    std::vector<uint16_t> widths;
+    for (size_t position : present) {
+      widths.push_back(worstWidth(probes[position]));
+    }
+
+    LiveChunkPlan plan;
+    liveBuildChunkPlan(
+        plan, headerWidth, widths.data(), widths.size(), golden.limit);
+    if (present.empty()) {
+      plan.starts.assign(2, 0);
+    }
+
+    char timestamp[24];
+    char sampleId[16];
+    snprintf(timestamp, sizeof(timestamp), "%llu",
+             static_cast<unsigned long long>(liveGoldenTimestamp(frame)));
+    snprintf(sampleId, sizeof(sampleId), "%lu",
+             static_cast<unsigned long>(liveGoldenSampleId(frame)));
+
+    for (size_t chunk = 0; chunk < plan.chunkCount(); ++chunk) {
+      char seq[8];
+      snprintf(seq, sizeof(seq), "%u", static_cast<unsigned>(chunk));
+
+      RenderedChunk rendered;
+      liveReferenceHeader(
+          rendered.text,
+          timestamp,
+          "50",
+          golden.temp ? "41.5" : nullptr,
+          sampleId,
+          seq,
+          chunk + 1 == plan.chunkCount(),
+          golden.tagKey,
+          golden.tagValue);
+
+      for (size_t i = plan.starts[chunk]; i < plan.starts[chunk + 1]; ++i) {
+        if (i != plan.starts[chunk]) {
+          rendered.text += ',';
+        }
+        appendProbe(rendered.text, probes[present[i]], frame, present[i]);
+      }
+      rendered.text += "]}";
+      rendered.probes = plan.starts[chunk + 1] - plan.starts[chunk];
+      out.push_back(rendered);
+    }
+  }
+}
+
+/* --------------------------------------------------------------------------
+   Checks
+   -------------------------------------------------------------------------- */
+
+static bool writeLines(
+    const std::string& path,
+    const std::vector<RenderedChunk>& chunks) {
+
+  std::ofstream file(path);
+  for (const RenderedChunk& chunk : chunks) {
+    file << chunk.text << '\n';
+  }
+  return static_cast<bool>(file);
+}
+
+static void checkCase(
+    const GoldenCase& golden,
+    const std::string& directory,
+    bool update) {
+
+  std::vector<RenderedChunk> chunks;
+  render(golden, chunks);
+
+  const std::string path = directory + "/" + golden.name + ".log";
+
+  if (update) {
+    CHECK(writeLines(path, chunks));
+  } else {
+    std::vector<std::string> expected;
+    if (!liveGoldenRead(path, expected)) {
+      printf("%s: cannot read %s\n", golden.name, path.c_str());
+      ++failures;
+      return;
+    }
+
+    if (expected.size() != chunks.size()) {
+      printf("%s: %zu chunks, golden file has %zu\n",
+             golden.name, chunks.size(), expected.size());
+      ++failures;
+    }
+
+    for (size_t i = 0; i < chunks.size() && i < expected.size(); ++i) {
+      if (chunks[i].text != expected[i]) {
+        printf("%s: chunk %zu differs\n  golden: %s\n  now:    %s\n",
+               golden.name, i + 1, expected[i].c_str(),
+               chunks[i].text.c_str());
+        ++failures;
+        break;
+      }
+    }
+  }
+
+  // Only a probe too wide for an empty chunk may exceed the limit, and it
+  // is then sent alone.
+  for (const RenderedChunk& chunk : chunks) {
+    CHECK(chunk.text.size() <= golden.limit || chunk.probes == 1);
+  }
+
+  const auto started = std::chrono::steady_clock::now();
+  size_t rendered = 0;
+  for (int round = 0; round < ENCODE_ROUNDS; ++round) {
+    render(golden, chunks);
+    rendered += chunks.size();
+  }
+  const double elapsedUs = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - started).count();
+  const double perChunkUs = elapsedUs / rendered;
+
+  printf("  %-16s %3zu chunks  %6.2f us per chunk\n",
+         golden.name, chunks.size(), perChunkUs);
+  CHECK(perChunkUs <= ENCODE_BUDGET_US_PER_CHUNK);
+}
+
+int main(int argc, char** argv) {
+  bool update = false;
+  std::string directory = "golden";
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--update") == 0) {
+      update = true;
+    } else {
+      directory = argv[i];
+    }
+  }
+
+  for (const GoldenCase& golden : liveGoldenCases()) {
+    checkCase(golden, directory, update);
+  }
+
+  if (failures != 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf(update ? "golden frames: written\n"
+                : "golden frames: all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,560 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Runs LiveHistory (src/esp32_live_history.cpp) on generated snapshots with
+// sample_id and time gaps, and compares it with a brute-force scan of the
+// same snapshots: wrap-around of every level, the min/max/mean and sample
+// count of each summary record and of summarize() over random ranges, the
+// binary searches, timeOfId() for identifiers in gaps or already dropped
+// from level 0, and selectLevel() against the requested number of points.
+// The exit status is 1 when a check fails.
+//
+//     make test_history && ./test_history
+//
+
+#include "../../src/esp32_live_history.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition)                                          \
+  do {                                                            \
+    if (!(condition)) {                                           \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+             #condition);                                         \
+      ++failures;                                                 \
+    }                                                             \
+  } while (0)
+
+static const size_t PROBES = 2;
+
+// Means are summed in float on the device; the values below are small
+// integers, so only the divisions round.
+static bool near(double actual, double expected) {
+  return fabs(actual - expected) <= 1e-4 * (1.0 + fabs(expected));
+}
+
+struct Sample {
+  uint32_t id;
+  uint64_t ms;
+  float values[PROBES];
+};
+
+// Every 250th snapshot skips 7 identifiers and 500 ms, as after a dropped
+// capture or a pause.
+static std::vector<Sample> makeSamples(size_t count) {
+  std::vector<Sample> samples;
+  uint32_t id = 1;
+  uint64_t ms = 1000;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0 && i % 250 == 0) {
+      id += 7;
+      ms += 500;
+    }
+
+    Sample sample;
+    sample.id = id;
+    sample.ms = ms;
+    sample.values[0] = static_cast<float>((id * 37) % 101);
+    sample.values[1] = static_cast<float>(50 - static_cast<int>((id * 11) % 23));
+    samples.push_back(sample);
+
+    ++id;
+    ms += 10;
+  }
+  return samples;
+}
+
+// Minimal deterministic generator, so a failure reproduces.
+static uint32_t randomState = 12345;
+
+static uint32_t nextRandom(uint32_t bound) {
+  randomState = randomState * 1103515245u + 12345u;
+  return (randomState >> 8) % bound;
+}
+
+struct Expected {
+  uint32_t samples;
+  float min[PROBES];
+  float max[PROBES];
+  double mean[PROBES];
+};
+
+// Brute force over the snapshots for which select returns true.
+template <typename Select>
+static Expected scan(const std::vector<Sample>& samples, Select select) {
+  Expected expected;
+  expected.samples = 0;
+  double sum[PROBES] = {};
+
+  for (const Sample& sample : samples) {
+    if (!select(sample)) {
+      continue;
+    }
+    for (size_t i = 0; i < PROBES; ++i) {
+      const float value = sample.values[i];
+      if (expected.samples == 0 || value < expected.min[i]) {
+        expected.min[i] = value;
+      }
+      if (expected.samples == 0 || value > expected.max[i]) {
+        expected.max[i] = value;
+      }
+      sum[i] += value;
+    }
+    ++expected.samples;
+  }
+
+  for (size_t i = 0; i < PROBES; ++i) {
+    expected.mean[i] =
+        expected.samples != 0 ? sum[i] / expected.samples : 0.0;
+  }
+  return expected;
+}
+
+static Expected scanTime(
+    const std::vector<Sample>& samples,
+    uint64_t fromMs,
+    uint64_t toMs) {
+
+  return scan(samples, [&](const Sample& sample) {
+    return sample.ms >= fromMs && sample.ms <= toMs;
+  });
+}
+
+static size_t levelSpan(const LiveHistory& history, size_t level) {
+  size_t span = 1;
+  for (size_t i = 0; i < level; ++i) {
+    span *= history.factor();
+  }
+  return span;
+}
+
+// Records pushed to level so far: level 0 gets every snapshot and every
+// level above one record per factor records of the level below.
+static size_t pushed(const LiveHistory& history, size_t level, size_t appended) {
+  return appended / levelSpan(history, level);
+}
+
+static void checkLevels(
+    const LiveHistory& history,
+    const std::vector<Sample>& all,
+    size_t appended) {
+
+  const std::vector<Sample> samples(all.begin(), all.begin() + appended);
+
+  for (size_t level = 0; level < history.levels(); ++level) {
+    const size_t total = pushed(history, level, appended);
+    const size_t kept =
+        total < history.capacity(level) ? total : history.capacity(level);
+    const size_t span = levelSpan(history, level);
+
+    CHECK(history.size(level) == kept);
+
+    LiveHistoryRecord previous;
+    for (size_t index = 0; index < history.size(level); ++index) {
+      LiveHistoryRecord record;
+      CHECK(history.record(level, index, record));
+
+      // Position index holds the record pushed as number
+      // total - kept + index, made of span consecutive snapshots.
+      const size_t first = (total - kept + index) * span;
+      CHECK(record.firstId == samples[first].id);
+      CHECK(record.lastId == samples[first + span - 1].id);
+      CHECK(record.startMs == samples[first].ms);
+      CHECK(record.endMs == samples[first + span - 1].ms);
+      CHECK(record.samples == span);
+
+      if (index > 0) {
+        CHECK(previous.lastId < record.firstId);
+        CHECK(previous.endMs < record.startMs);
+      }
+      previous = record;
+
+      const Expected expected = scan(samples, [&](const Sample& sample) {
+        return sample.id >= record.firstId && sample.id <= record.lastId;
+      });
+      CHECK(expected.samples == record.samples);
+      for (size_t i = 0; i < PROBES; ++i) {
+        CHECK(record.min[i] == expected.min[i]);
+        CHECK(record.max[i] == expected.max[i]);
+        CHECK(near(record.mean[i], expected.mean[i]));
+      }
+    }
+
+    LiveHistoryRecord outside;
+    CHECK(!history.record(level, history.size(level), outside));
+  }
+}
+
+// Every level wraps several times; the newest records and their summaries
+// are checked at points spread over the run.
+static void testWrapAround(
+    size_t levels,
+    size_t factor,
+    std::vector<uint64_t>& memory,
+    LiveHistory& history,
+    const std::vector<Sample>& samples) {
+
+  CHECK(history.begin(
+      memory.data(), memory.size() * sizeof(uint64_t), PROBES, levels, factor));
+  CHECK(history.ready());
+  CHECK(history.levels() == levels);
+
+  for (size_t appended = 0; appended < samples.size(); ++appended) {
+    const Sample& sample = samples[appended];
+    history.append(sample.id, sample.ms, sample.values);
+
+    if ((appended + 1) % 97 == 0) {
+      checkLevels(history, samples, appended + 1);
+    }
+  }
+  checkLevels(history, samples, samples.size());
+
+  for (size_t level = 0; level < levels; ++level) {
+    CHECK(pushed(history, level, samples.size()) >
+          2 * history.capacity(level));
+  }
+}
+
+static void testSetup() {
+  std::vector<uint64_t> memory(64);
+  LiveHistory history;
+
+  CHECK(!history.begin(nullptr, 512, PROBES));
+  CHECK(!history.begin(memory.data(), 512, 0));
+  CHECK(!history.begin(memory.data(), 512, PROBES, 0));
+  CHECK(!history.begin(memory.data(), 512, PROBES, LiveHistory::MAX_LEVELS + 1));
+  CHECK(!history.begin(memory.data(), 512, PROBES, 4, 1));
+  // Too small for two records on every level.
+  CHECK(!history.begin(memory.data(), 200, PROBES, 4, 8));
+  CHECK(!history.ready());
+  CHECK(history.size(0) == 0);
+
+  history.append(1, 0, nullptr);
+  CHECK(history.size(0) == 0);
+}
+
+// lowerBoundTime() and lowerBoundId() against a linear scan, for times and
+// identifiers on records, between them and outside the history.
+static void testLowerBounds(const LiveHistory& history) {
+  for (size_t level = 0; level < history.levels(); ++level) {
+    const size_t count = history.size(level);
+    LiveHistoryRecord oldest;
+    LiveHistoryRecord newest;
+    history.record(level, 0, oldest);
+    history.record(level, count - 1, newest);
+
+    for (uint64_t ms = oldest.startMs - 20; ms <= newest.endMs + 20; ms += 3) {
+      size_t expected = count;
+      for (size_t index = 0; index < count; ++index) {
+        LiveHistoryRecord record;
+        history.record(level, index, record);
+        if (record.endMs >= ms) {
+          expected = index;
+          break;
+        }
+      }
+      CHECK(history.lowerBoundTime(level, ms) == expected);
+    }
+
+    for (uint32_t id = oldest.firstId - 2; id <= newest.lastId + 2; ++id) {
+      size_t expected = count;
+      for (size_t index = 0; index < count; ++index) {
+        LiveHistoryRecord record;
+        history.record(level, index, record);
+        if (record.lastId >= id) {
+          expected = index;
+          break;
+        }
+      }
+      CHECK(history.lowerBoundId(level, id) == expected);
+    }
+  }
+}
+
+// Finest level whose oldest record starts at or before timestampMs.
+static size_t finestHolding(const LiveHistory& history, uint64_t timestampMs) {
+  for (size_t level = 0; level < history.levels(); ++level) {
+    LiveHistoryRecord oldest;
+    if (history.record(level, 0, oldest) && oldest.startMs <= timestampMs) {
+      return level;
+    }
+  }
+  return history.levels();
+}
+
+static void checkSummary(
+    const LiveHistory& history,
+    const std::vector<Sample>& samples,
+    uint64_t fromMs,
+    uint64_t toMs,
+    uint64_t expectedFromMs,
+    uint64_t expectedToMs) {
+
+  float min[PROBES];
+  float max[PROBES];
+  float mean[PROBES];
+
+  const Expected expected = scanTime(samples, expectedFromMs, expectedToMs);
+  const uint32_t count = history.summarize(fromMs, toMs, min, max, mean);
+
+  CHECK(count == expected.samples);
+  if (count != expected.samples) {
+    printf("  summarize(%llu, %llu): %u samples, expected %u\n",
+           static_cast<unsigned long long>(fromMs),
+           static_cast<unsigned long long>(toMs),
+           count,
+           expected.samples);
+    return;
+  }
+
+  for (size_t i = 0; i < PROBES && count != 0; ++i) {
+    CHECK(min[i] == expected.min[i]);
+    CHECK(max[i] == expected.max[i]);
+    CHECK(near(mean[i], expected.mean[i]));
+  }
+}
+
+// summarize() over random ranges. Inside level 0 every snapshot is still
+// kept, so the result is exact for any bounds. Further back, a range whose
+// start falls inside a record of the finest level still holding it covers
+// that record whole.
+static void testSummarize(
+    const LiveHistory& history,
+    const std::vector<Sample>& samples) {
+
+  LiveHistoryRecord newestRaw;
+  LiveHistoryRecord oldestRaw;
+  history.record(0, history.size(0) - 1, newestRaw);
+  history.record(0, 0, oldestRaw);
+
+  const size_t top = history.levels() - 1;
+  LiveHistoryRecord oldestTop;
+  history.record(top, 0, oldestTop);
+  const uint32_t span =
+      static_cast<uint32_t>(newestRaw.endMs - oldestTop.startMs);
+
+  for (int round = 0; round < 2000; ++round) {
+    // Exact: any bounds from the oldest raw snapshot on.
+    const uint32_t rawSpan =
+        static_cast<uint32_t>(newestRaw.endMs + 50 - oldestRaw.startMs);
+    uint64_t fromMs = oldestRaw.startMs + nextRandom(rawSpan);
+    uint64_t toMs = fromMs + nextRandom(rawSpan);
+    checkSummary(history, samples, fromMs, toMs, fromMs, toMs);
+
+    // Older: the start is widened to its record on the finest level that
+    // still holds it; the end is the end of a record on that level or lies
+    // after the newest snapshot.
+    fromMs = oldestTop.startMs + nextRandom(span);
+    const size_t level = finestHolding(history, fromMs);
+    if (level == 0 || level == history.levels()) {
+      continue;
+    }
+
+    size_t index = history.lowerBoundTime(level, fromMs);
+    LiveHistoryRecord edge;
+    if (!history.record(level, index, edge)) {
+      continue;
+    }
+    const uint64_t expectedFromMs =
+        edge.startMs < fromMs ? edge.startMs : fromMs;
+
+    LiveHistoryRecord end;
+    if (nextRandom(4) == 0) {
+      toMs = newestRaw.endMs + nextRandom(1000);
+    } else {
+      index += nextRandom(static_cast<uint32_t>(history.size(level) - index));
+      history.record(level, index, end);
+      toMs = end.endMs;
+    }
+    checkSummary(history, samples, fromMs, toMs, expectedFromMs, toMs);
+  }
+
+  float min[PROBES];
+  float max[PROBES];
+  float mean[PROBES];
+  CHECK(history.summarize(newestRaw.endMs + 1, UINT64_MAX, min, max, mean) ==
+        0);
+  CHECK(history.summarize(2000, 1000, min, max, mean) == 0);
+
+  // Everything still kept, from the oldest summary on.
+  checkSummary(
+      history, samples, 0, UINT64_MAX, oldestTop.startMs, newestRaw.endMs);
+}
+
+// Identifiers on a record resolve to its start or end, identifiers in a gap
+// to the record after it (start) or before it (end), and identifiers
+// already dropped from level 0 to the summary record holding them.
+static void testTimeOfId(
+    const LiveHistory& history,
+    const std::vector<Sample>& samples) {
+
+  LiveHistoryRecord oldestRaw;
+  LiveHistoryRecord newestRaw;
+  history.record(0, 0, oldestRaw);
+  history.record(0, history.size(0) - 1, newestRaw);
+
+  for (const Sample& sample : samples) {
+    if (sample.id >= oldestRaw.firstId) {
+      CHECK(history.timeOfId(sample.id, false) == sample.ms);
+      CHECK(history.timeOfId(sample.id, true) == sample.ms);
+    }
+  }
+
+  // Gaps between consecutive snapshots, inside level 0 or older.
+  for (size_t i = 1; i < samples.size(); ++i) {
+    const Sample& before = samples[i - 1];
+    const Sample& after = samples[i];
+    if (after.id == before.id + 1) {
+      continue;
+    }
+
+    const uint32_t missing = before.id + 3;
+    size_t level = 0;
+    LiveHistoryRecord oldest;
+    while (level < history.levels() &&
+           history.record(level, 0, oldest) &&
+           oldest.firstId > missing) {
+      ++level;
+    }
+    if (level == history.levels()) {
+      continue;
+    }
+
+    const size_t index = history.lowerBoundId(level, missing);
+    LiveHistoryRecord found;
+    if (!history.record(level, index, found)) {
+      continue;
+    }
+
+    CHECK(history.timeOfId(missing, false) == found.startMs);
+    if (level == 0) {
+      CHECK(found.startMs == after.ms);
+      CHECK(history.timeOfId(missing, true) == before.ms);
+    } else if (found.firstId > missing && index > 0) {
+      LiveHistoryRecord previous;
+      history.record(level, index - 1, previous);
+      CHECK(history.timeOfId(missing, true) == previous.endMs);
+    } else {
+      CHECK(history.timeOfId(missing, true) == found.endMs);
+    }
+  }
+
+  // Dropped from level 0: resolved by the finest summary holding them.
+  size_t dropped = 0;
+  for (const Sample& sample : samples) {
+    if (sample.id >= oldestRaw.firstId) {
+      break;
+    }
+
+    for (size_t level = 1; level < history.levels(); ++level) {
+      LiveHistoryRecord oldest;
+      history.record(level, 0, oldest);
+      if (oldest.firstId > sample.id) {
+        continue;
+      }
+
+      LiveHistoryRecord found;
+      history.record(level, history.lowerBoundId(level, sample.id), found);
+      CHECK(found.firstId <= sample.id && sample.id <= found.lastId);
+      CHECK(history.timeOfId(sample.id, false) == found.startMs);
+      CHECK(history.timeOfId(sample.id, true) == found.endMs);
+      ++dropped;
+      break;
+    }
+  }
+  CHECK(dropped > 0);
+
+  LiveHistoryRecord oldestTop;
+  history.record(history.levels() - 1, 0, oldestTop);
+  CHECK(history.timeOfId(oldestTop.firstId - 1, false) == oldestTop.startMs);
+  CHECK(history.timeOfId(oldestTop.firstId - 1, true) == 0);
+  CHECK(history.timeOfId(newestRaw.lastId + 1, false) == UINT64_MAX);
+  CHECK(history.timeOfId(newestRaw.lastId + 1, true) == UINT64_MAX);
+}
+
+// The chosen level covers the start of the range with at most the requested
+// number of records; every finer level either starts later or would return
+// more. Only the coarsest level may exceed the request.
+static void testSelectLevel(const LiveHistory& history) {
+  const size_t top = history.levels() - 1;
+  LiveHistoryRecord oldestTop;
+  LiveHistoryRecord newestRaw;
+  history.record(top, 0, oldestTop);
+  history.record(0, history.size(0) - 1, newestRaw);
+  const uint32_t span =
+      static_cast<uint32_t>(newestRaw.endMs - oldestTop.startMs);
+
+  for (int round = 0; round < 2000; ++round) {
+    const uint64_t fromMs = oldestTop.startMs + nextRandom(span);
+    const uint64_t toMs = fromMs + nextRandom(span);
+    const size_t points = 1 + nextRandom(40);
+    const size_t level = history.selectLevel(fromMs, toMs, points);
+
+    CHECK(level <= top);
+
+    size_t inRange = 0;
+    for (size_t index = 0; index < history.size(level); ++index) {
+      LiveHistoryRecord record;
+      history.record(level, index, record);
+      if (record.endMs >= fromMs && record.startMs <= toMs) {
+        ++inRange;
+      }
+    }
+    CHECK(history.countInRange(level, fromMs, toMs) == inRange);
+
+    if (level < top) {
+      CHECK(inRange <= points);
+      LiveHistoryRecord oldest;
+      history.record(level, 0, oldest);
+      CHECK(oldest.startMs <= fromMs);
+    }
+
+    for (size_t finer = 0; finer < level; ++finer) {
+      LiveHistoryRecord oldest;
+      history.record(finer, 0, oldest);
+      CHECK(oldest.startMs > fromMs ||
+            history.countInRange(finer, fromMs, toMs) > points);
+    }
+  }
+
+  // A request reaching back beyond the history starts at its oldest data.
+  CHECK(history.selectLevel(0, newestRaw.endMs, 1000) == top);
+  CHECK(history.selectLevel(newestRaw.endMs - 50, newestRaw.endMs, 10) == 0);
+  CHECK(history.countInRange(0, 10, 5) == 0);
+}
+
+static void runConfiguration(size_t levels, size_t factor, size_t words) {
+  const std::vector<Sample> samples = makeSamples(3000);
+  std::vector<uint64_t> memory(words);
+  LiveHistory history;
+
+  testWrapAround(levels, factor, memory, history, samples);
+  testLowerBounds(history);
+  testSummarize(history, samples);
+  testTimeOfId(history, samples);
+  testSelectLevel(history);
+}
+
+int main() {
+  testSetup();
+
+  // Level 0 holds 23 snapshots, levels 1 and 2 ten summaries each.
+  runConfiguration(3, 4, 216);
+  // Level 0 holds 14 snapshots, levels 1 to 3 six summaries each.
+  runConfiguration(4, 3, 180);
+
+  if (failures != 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("history: all checks passed\n");
+  return 0;
+}
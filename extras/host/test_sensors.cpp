@@ -0,0 +1,291 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Runs the sensor scheduler (src/esp32_live_sensors.cpp) against
+// LiveSimulatedBus: burst merging, transactions per batch, decoding and
+// scaling, bus errors, re-registration and the due time of every batch.
+// The exit status is 1 when a check fails.
+//
+//     make test_sensors && ./test_sensors
+//
+
+#include "../../src/esp32_live_sensors.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                          \
+  do {                                                            \
+    if (!(condition)) {                                           \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+             #condition);                                         \
+      ++failures;                                                 \
+    }                                                             \
+  } while (0)
+
+static bool near(float actual, float expected) {
+  return fabsf(actual - expected) <= 1e-5f * (1.0f + fabsf(expected));
+}
+
+static LiveSensorRead makeRead(
+    LiveSensorBus& bus,
+    uint8_t address,
+    uint8_t reg,
+    LiveSensorDecode decode,
+    uint32_t periodMs) {
+
+  LiveSensorRead read;
+  read.bus = &bus;
+  read.address = address;
+  read.reg = reg;
+  read.length = static_cast<uint8_t>(liveSensorDecodeWidth(decode));
+  read.decode = decode;
+  read.scale = 1.0f;
+  read.offset = 0.0f;
+  read.decoder = nullptr;
+  read.decoderContext = nullptr;
+  read.periodMs = periodMs;
+  return read;
+}
+
+// Two accelerometer axes two registers apart: one burst, one transaction
+// per period, both values decoded and scaled from it.
+static void testBurstMerging() {
+  LiveSimulatedBus bus;
+  const uint8_t axes[] = {0x40, 0x00, 0xC0, 0x00};
+  bus.setRegisters(0x68, 0x3B, axes, sizeof(axes));
+
+  LiveSensorScheduler scheduler;
+  LiveSensorRead x = makeRead(bus, 0x68, 0x3B, LIVE_DECODE_S16_BE, 10);
+  LiveSensorRead y = makeRead(bus, 0x68, 0x3D, LIVE_DECODE_S16_BE, 10);
+  x.scale = 1 / 16384.0f;
+  y.scale = 1 / 16384.0f;
+  y.offset = 0.5f;
+
+  LiveSensorSlot* slotX = scheduler.add(211, x);
+  LiveSensorSlot* slotY = scheduler.add(212, y);
+  CHECK(slotX != nullptr && slotY != nullptr);
+  CHECK(scheduler.batchCount() == 1);
+
+  scheduler.poll(0);
+  CHECK(bus.transactions() == 1);
+  CHECK(slotX->valid && near(slotX->value, 1.0f));
+  CHECK(slotY->valid && near(slotY->value, -1.0f + 0.5f));
+
+  for (uint32_t nowMs = 1; nowMs < 100; ++nowMs) {
+    scheduler.poll(nowMs);
+  }
+  CHECK(bus.transactions() == 10);
+}
+
+// Reads further apart than ESP32_LIVE_SENSOR_MAX_GAP, on another device or
+// beyond the burst limit stay separate.
+static void testMergeLimits() {
+  LiveSimulatedBus bus;
+  LiveSensorScheduler scheduler;
+
+  scheduler.add(100, makeRead(bus, 0x10, 0x00, LIVE_DECODE_U8, 10));
+  scheduler.add(101, makeRead(
+      bus, 0x10, 1 + ESP32_LIVE_SENSOR_MAX_GAP, LIVE_DECODE_U8, 10));
+  CHECK(scheduler.batchCount() == 1);
+
+  scheduler.add(102, makeRead(
+      bus, 0x10, 2 + 2 * ESP32_LIVE_SENSOR_MAX_GAP + 1, LIVE_DECODE_U8, 10));
+  CHECK(scheduler.batchCount() == 2);
+
+  scheduler.add(103, makeRead(bus, 0x11, 0x00, LIVE_DECODE_U8, 10));
+  CHECK(scheduler.batchCount() == 3);
+
+  LiveSensorScheduler wide;
+  wide.add(100, makeRead(bus, 0x20, 0x00, LIVE_DECODE_U32_BE, 10));
+  wide.add(101, makeRead(
+      bus, 0x20, ESP32_LIVE_SENSOR_MAX_BURST - 2, LIVE_DECODE_U32_BE, 10));
+  CHECK(wide.batchCount() == 2);
+}
+
+// Neighbouring registers with different periods are not merged, so the
+// slow register keeps its own rate.
+static void testPeriods() {
+  LiveSimulatedBus fast;
+  LiveSimulatedBus slow;
+  LiveSimulatedBus shared;
+  LiveSensorScheduler scheduler;
+
+  scheduler.add(100, makeRead(shared, 0x76, 0xFA, LIVE_DECODE_U16_BE, 10));
+  scheduler.add(101, makeRead(shared, 0x76, 0xFC, LIVE_DECODE_U16_BE, 100));
+  CHECK(scheduler.batchCount() == 2);
+
+  LiveSensorScheduler separate;
+  separate.add(100, makeRead(fast, 0x76, 0xFA, LIVE_DECODE_U16_BE, 10));
+  separate.add(101, makeRead(slow, 0x76, 0xFC, LIVE_DECODE_U16_BE, 100));
+
+  for (uint32_t nowMs = 0; nowMs < 1000; ++nowMs) {
+    scheduler.poll(nowMs);
+    separate.poll(nowMs);
+  }
+  CHECK(fast.transactions() == 100);
+  CHECK(slow.transactions() == 10);
+  CHECK(shared.transactions() == 110);
+}
+
+// poll() runs a batch once its period has elapsed and returns the time to
+// the next due batch.
+static void testTiming() {
+  LiveSimulatedBus bus;
+  LiveSensorScheduler scheduler;
+
+  CHECK(scheduler.poll(0) == 1000);
+
+  scheduler.add(100, makeRead(bus, 0x10, 0x00, LIVE_DECODE_U8, 25));
+  scheduler.add(101, makeRead(bus, 0x20, 0x00, LIVE_DECODE_U8, 40));
+
+  CHECK(scheduler.poll(0) == 25);
+  CHECK(bus.transactions() == 2);
+
+  CHECK(scheduler.poll(10) == 15);
+  CHECK(bus.transactions() == 2);
+
+  CHECK(scheduler.poll(25) == 15);
+  CHECK(bus.transactions() == 3);
+
+  CHECK(scheduler.poll(40) == 10);
+  CHECK(bus.transactions() == 4);
+
+  // A late poll runs every overdue batch once.
+  scheduler.poll(500);
+  CHECK(bus.transactions() == 6);
+}
+
+// A failing device invalidates only its own slots and counts the error;
+// the values come back once it recovers.
+static void testBusErrors() {
+  LiveSimulatedBus bus;
+  bus.setRegister(0x10, 0x00, 7);
+  bus.setRegister(0x20, 0x00, 9);
+
+  LiveSensorScheduler scheduler;
+  LiveSensorSlot* good =
+      scheduler.add(100, makeRead(bus, 0x10, 0x00, LIVE_DECODE_U8, 1));
+  LiveSensorSlot* bad =
+      scheduler.add(101, makeRead(bus, 0x20, 0x00, LIVE_DECODE_U8, 1));
+
+  bus.setFailing(0x20, true);
+  scheduler.poll(0);
+  scheduler.poll(1);
+  CHECK(good->valid && near(good->value, 7.0f) && good->errors == 0);
+  CHECK(!bad->valid && bad->errors == 2);
+
+  bus.setFailing(0x20, false);
+  scheduler.poll(2);
+  CHECK(bad->valid && near(bad->value, 9.0f) && bad->errors == 2);
+
+  LiveSensorScheduler missing;
+  LiveSensorSlot* absent =
+      missing.add(102, makeRead(bus, 0x30, 0x00, LIVE_DECODE_U8, 1));
+  missing.poll(0);
+  CHECK(!absent->valid && absent->errors == 1);
+}
+
+static void testDecoding() {
+  const uint8_t bytes[] = {0xFF, 0xFE, 0x01, 0x02};
+  CHECK(near(liveSensorDecode(LIVE_DECODE_U8, bytes), 255.0f));
+  CHECK(near(liveSensorDecode(LIVE_DECODE_S8, bytes), -1.0f));
+  CHECK(near(liveSensorDecode(LIVE_DECODE_S16_BE, bytes), -2.0f));
+  CHECK(near(liveSensorDecode(LIVE_DECODE_U16_LE, bytes), 65279.0f));
+  CHECK(near(liveSensorDecode(LIVE_DECODE_U24_BE, bytes), 16776705.0f));
+  CHECK(near(liveSensorDecode(LIVE_DECODE_U32_LE, bytes),
+             static_cast<float>(0x0201FEFFu)));
+
+  const float expected = 3.25f;
+  uint8_t floatBytes[4];
+  memcpy(floatBytes, &expected, sizeof(floatBytes));
+  CHECK(liveSensorDecode(LIVE_DECODE_FLOAT_LE, floatBytes) == expected);
+  CHECK(isnan(liveSensorDecode(LIVE_DECODE_CUSTOM, bytes)));
+}
+
+static float sumBytes(const uint8_t* data, size_t length, void* context) {
+  float sum = *static_cast<const float*>(context);
+  for (size_t i = 0; i < length; ++i) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+static void testCustomDecoder() {
+  LiveSimulatedBus bus;
+  const uint8_t block[] = {1, 2, 3, 4, 5, 6};
+  bus.setRegisters(0x50, 0x10, block, sizeof(block));
+
+  float base = 100.0f;
+  LiveSensorRead read = makeRead(bus, 0x50, 0x10, LIVE_DECODE_CUSTOM, 5);
+  read.length = sizeof(block);
+  read.decoder = sumBytes;
+  read.decoderContext = &base;
+
+  LiveSensorScheduler scheduler;
+  LiveSensorSlot* slot = scheduler.add(120, read);
+  scheduler.poll(0);
+  CHECK(slot != nullptr && slot->valid && near(slot->value, 121.0f));
+
+  read.decoder = nullptr;
+  CHECK(scheduler.add(121, read) == nullptr);
+}
+
+// Adding an id again reuses its slot: the old read is no longer polled.
+static void testReregistration() {
+  LiveSimulatedBus oldBus;
+  LiveSimulatedBus newBus;
+  newBus.setRegister(0x10, 0x05, 42);
+
+  LiveSensorScheduler scheduler;
+  LiveSensorSlot* first =
+      scheduler.add(150, makeRead(oldBus, 0x10, 0x00, LIVE_DECODE_U8, 1));
+  LiveSensorSlot* second =
+      scheduler.add(150, makeRead(newBus, 0x10, 0x05, LIVE_DECODE_U8, 1));
+
+  CHECK(first == second);
+  CHECK(scheduler.size() == 1);
+  CHECK(scheduler.batchCount() == 1);
+
+  scheduler.poll(0);
+  CHECK(oldBus.transactions() == 0);
+  CHECK(newBus.transactions() == 1);
+  CHECK(second->valid && near(second->value, 42.0f));
+}
+
+static void testCapacity() {
+  LiveSimulatedBus bus;
+  LiveSensorScheduler scheduler;
+
+  for (uint16_t id = 0; id < ESP32_LIVE_MAX_SENSOR_PROBES; ++id) {
+    CHECK(scheduler.add(id, makeRead(
+        bus, 0x10, static_cast<uint8_t>(id), LIVE_DECODE_U8, 10)) != nullptr);
+  }
+  CHECK(scheduler.add(999, makeRead(bus, 0x10, 0, LIVE_DECODE_U8, 10)) ==
+        nullptr);
+  CHECK(scheduler.add(0, makeRead(bus, 0x10, 0, LIVE_DECODE_U8, 20)) !=
+        nullptr);
+}
+
+int main() {
+  testBurstMerging();
+  testMergeLimits();
+  testPeriods();
+  testTiming();
+  testBusErrors();
+  testDecoding();
+  testCustomDecoder();
+  testReregistration();
+  testCapacity();
+
+  if (failures != 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("sensor scheduler: all checks passed\n");
+  return 0;
+}
@@ -4,10 +4,15 @@
 //
 
 #include "esp32_live.h"
+#include "esp32_live_internal.h"
+#include "esp32_live_compact.h"
+#include "esp32_live_delta.h"
+#include "esp32_live_quant.h"
 
 #include <ctype.h>
 #include <math.h>
 #include <stdlib.h>
+#include <esp_heap_caps.h>
 #include <esp_timer.h>
 
 /* --------------------------------------------------------------------------
@@ -23,6 +28,16 @@ static const char* LIVE_NOTIFY_UUID =
 static const char* LIVE_WRITE_UUID =
     "0000DEB2-0000-1000-8000-00805F9B34FB";
 
+// Asynchronous events such as watched variable writes. Kept separate from
+// the snapshot stream so older apps never see an unknown frame.
+static const char* LIVE_EVENTS_UUID =
+    "0000DEB3-0000-1000-8000-00805F9B34FB";
+
+// Latest captured snapshot in the compact binary encoding, for clients that
+// poll instead of subscribing.
+static const char* LIVE_SNAPSHOT_UUID =
+    "0000DEB4-0000-1000-8000-00805F9B34FB";
+
 /* --------------------------------------------------------------------------
    Conservative automatic pin lists
    -------------------------------------------------------------------------- */
@@ -73,12 +88,59 @@ const size_t SAFE_PIN_COUNT = 0;
 static volatile uint32_t samplingIntervalMs = 50;
 static volatile bool deviceConnected = false;
 static bool liveInitialized = false;
-static uint32_t nextSampleId = 0;
+static bool probeListClosed = false;
+static std::atomic<uint32_t> nextSampleId{0};
+static std::atomic<int64_t> clockOffsetMs{0};
 
 std::vector<ProbeEntry> pins;
 
+static std::vector<LiveProbeGroup*> probeGroups;
+
+// Single-producer, single-consumer ring of captured snapshots. The producer
+// is the background task or the loop task calling esp32_live_sample_point();
+// captureBusy makes sure only one of them captures at a time.
+//
+// Each frame is one block holding this header followed by its values. The
+// blocks are padded to a cache line, so a frame being captured and one being
+// serialized never share a line when the ring lives in PSRAM. Only the
+// indices below stay in internal RAM.
+struct CaptureFrame {
+  uint32_t sampleId;
+  uint64_t timestampMs;
+  LiveValue* values;
+};
+
+static_assert(
+    (ESP32_LIVE_CAPTURE_DEPTH & (ESP32_LIVE_CAPTURE_DEPTH - 1)) == 0,
+    "ESP32_LIVE_CAPTURE_DEPTH must be a power of two");
+
+static uint8_t* captureBlock = nullptr;
+static size_t captureStride = 0;
+static size_t captureProbeCount = 0;
+static std::atomic<uint32_t> captureHead{0};
+static std::atomic<uint32_t> captureTail{0};
+static std::atomic<bool> captureBusy{false};
+
+// Chunk plan for the streamed probe set. probeLayoutGeneration changes
+// whenever a probe's metadata changes; negotiatedMtu is reported by the
+// stack. Both are compared with the plan before each frame is sent. The
+// worst-case widths it was built from are kept for partial frames.
+static LiveChunkPlan chunkPlan;
+static std::vector<uint16_t> chunkWidths;
+static size_t chunkHeaderWidth = 0;
+static volatile uint32_t probeLayoutGeneration = 1;
+static volatile uint16_t negotiatedMtu = ESP32_LIVE_PREFERRED_MTU;
+static volatile bool mtuExchanged = false;
+
+static volatile bool samplePointMode = false;
+static int64_t lastSamplePointUs = 0;
+
 static BLECharacteristic* notifyCharacteristic = nullptr;
 static BLECharacteristic* writeCharacteristic = nullptr;
+static BLE2902* notifyDescriptor = nullptr;
+static BLECharacteristic* eventsCharacteristic = nullptr;
+static BLE2902* eventsDescriptor = nullptr;
+static BLECharacteristic* snapshotCharacteristic = nullptr;
 
 static TaskHandle_t liveTaskHandle = nullptr;
 
@@ -124,6 +186,74 @@ bool isDacPin(uint8_t n) {
 #endif
 }
 
+// Also invalidates the chunk plan, because every metadata change can change
+// the encoded width of the probe.
+static void classifyProbe(ProbeEntry& pin) {
+  ++probeLayoutGeneration;
+
+  if (pin.cfg == "VIRTUAL") {
+    pin.kind = LIVE_PROBE_VIRTUAL;
+  } else if (pin.cfg != "ANALOG") {
+    pin.kind = LIVE_PROBE_DIGITAL;
+  } else if (pin.dir == "OUT" && isDacPin(pin.num)) {
+    pin.kind = LIVE_PROBE_DAC_OUT;
+  } else {
+    pin.kind = LIVE_PROBE_ANALOG;
+  }
+}
+
+static ProbeEntry makeProbeEntry(
+    uint8_t n,
+    const String& cfg,
+    const String& dir) {
+
+  ProbeEntry entry;
+  entry.num = n;
+  entry.cfg = cfg;
+  entry.dir = dir;
+  entry.getter = nullptr;
+  entry.cur = 0.0f;
+  entry.hasCur = false;
+  entry.ptr = nullptr;
+  entry.hasPtr = false;
+  entry.ctxGetter.fn.asFloat = nullptr;
+  entry.ctxGetter.context = nullptr;
+  entry.ctxGetter.type = LIVE_VALUE_FLOAT;
+  entry.hasCtxGetter = false;
+  entry.group = nullptr;
+  entry.held.i = 0;
+  entry.deadband = 0.0f;
+  entry.hasSchema = false;
+  entry.quantBits = 0;
+  entry.quantMin = 0.0f;
+  entry.quantMax = 0.0f;
+  classifyProbe(entry);
+  return entry;
+}
+
+uint64_t liveNowMs() {
+  return static_cast<uint64_t>(
+      esp_timer_get_time() / 1000LL +
+      clockOffsetMs.load(std::memory_order_relaxed));
+}
+
+void liveSetClockOffsetMs(int64_t offsetMs) {
+  clockOffsetMs.store(offsetMs, std::memory_order_relaxed);
+}
+
+uint32_t liveReserveSampleIds(uint32_t count) {
+  return nextSampleId.fetch_add(count, std::memory_order_relaxed);
+}
+
+int liveFindProbeIndex(uint8_t num) {
+  for (size_t i = 0; i < pins.size(); ++i) {
+    if (pins[i].num == num) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
 ProbeEntry* findPin(uint8_t n) {
   for (auto& pin : pins) {
     if (pin.num == n) {
@@ -137,6 +267,35 @@ ProbeEntry* findPin(uint8_t n) {
    Probe registration
    -------------------------------------------------------------------------- */
 
+// The capture ring, the history store and the chunk plan are laid out for
+// the probes registered when esp32_live_begin() runs. A probe added later
+// would never be captured, so it is rejected. Re-registering a probe is
+// rejected too: the background task reads the getters and the cfg and dir
+// strings of every probe without a lock while it captures and encodes.
+bool liveRejectLateProbe(uint8_t n) {
+  if (!probeListClosed) {
+    return false;
+  }
+
+  log_e("probe %u registered after esp32_live_begin() is ignored", n);
+  (void)n;
+  return true;
+}
+
+// The deadband and the quantization of a probe are read by the background
+// task while it sends frames and schema events, so they are fixed with the
+// probe list.
+static bool rejectLateDeclaration(const char* name, uint8_t n) {
+  if (!probeListClosed) {
+    return false;
+  }
+
+  log_e("%s(%u) after esp32_live_begin() is ignored", name, n);
+  (void)name;
+  (void)n;
+  return true;
+}
+
 void esp32_live_register_pin(
     uint8_t n,
     String cfg,
@@ -157,6 +316,10 @@ void esp32_live_register_pin(
     return;
   }
 
+  if (liveRejectLateProbe(n)) {
+    return;
+  }
+
   if (ProbeEntry* pin = findPin(n)) {
     if (cfg.length() > 0) {
       pin->cfg = cfg;
@@ -165,19 +328,13 @@ void esp32_live_register_pin(
       pin->dir = dir;
     }
     pin->getter = getter;
+    classifyProbe(*pin);
     return;
   }
 
-  pins.push_back({
-    n,
-    cfg,
-    dir,
-    getter,
-    0.0f,
-    false,
-    nullptr,
-    false
-  });
+  ProbeEntry entry = makeProbeEntry(n, cfg, dir);
+  entry.getter = getter;
+  pins.push_back(entry);
 }
 
 void esp32_live_probe_impl(
@@ -195,6 +352,10 @@ void esp32_live_probe_impl(
   name = limitString(name, 32);
   const uint8_t id = static_cast<uint8_t>(n);
 
+  if (liveRejectLateProbe(id)) {
+    return;
+  }
+
   if (ProbeEntry* pin = findPin(id)) {
     pin->cfg = "VIRTUAL";
     pin->dir = name;
@@ -202,36 +363,120 @@ void esp32_live_probe_impl(
     pin->ptr = pvar;
     pin->hasPtr = true;
     pin->hasCur = false;
+    pin->hasCtxGetter = false;
+    classifyProbe(*pin);
+    return;
+  }
+
+  ProbeEntry entry = makeProbeEntry(id, String("VIRTUAL"), name);
+  entry.ptr = pvar;
+  entry.hasPtr = true;
+  pins.push_back(entry);
+}
+
+static void registerGetterProbe(
+    uint16_t n,
+    const char* probeName,
+    const ProbeGetter& getter) {
+
+  if (n < 100 || n > 255 || getter.fn.asFloat == nullptr) {
+    return;
+  }
+
+  String name =
+      probeName == nullptr ? String("getter") : String(probeName);
+
+  name = limitString(name, 32);
+  const uint8_t id = static_cast<uint8_t>(n);
+
+  if (liveRejectLateProbe(id)) {
+    return;
+  }
+
+  if (ProbeEntry* pin = findPin(id)) {
+    pin->cfg = "VIRTUAL";
+    pin->dir = name;
+    pin->getter = nullptr;
+    pin->ptr = nullptr;
+    pin->hasPtr = false;
+    pin->hasCur = false;
+    pin->ctxGetter = getter;
+    pin->hasCtxGetter = true;
+    classifyProbe(*pin);
+    return;
+  }
+
+  ProbeEntry entry = makeProbeEntry(id, String("VIRTUAL"), name);
+  entry.ctxGetter = getter;
+  entry.hasCtxGetter = true;
+  pins.push_back(entry);
+}
+
+void esp32_live_probe_getter(
+    uint16_t n,
+    const char* name,
+    float (*getter)(void* context),
+    void* context) {
+
+  ProbeGetter probeGetter;
+  probeGetter.fn.asFloat = getter;
+  probeGetter.context = context;
+  probeGetter.type = LIVE_VALUE_FLOAT;
+  registerGetterProbe(n, name, probeGetter);
+}
+
+void esp32_live_probe_getter(
+    uint16_t n,
+    const char* name,
+    int32_t (*getter)(void* context),
+    void* context) {
+
+  ProbeGetter probeGetter;
+  probeGetter.fn.asInt32 = getter;
+  probeGetter.context = context;
+  probeGetter.type = LIVE_VALUE_INT32;
+  registerGetterProbe(n, name, probeGetter);
+}
+
+void esp32_live_probe_getter(
+    uint16_t n,
+    const char* name,
+    bool (*getter)(void* context),
+    void* context) {
+
+  ProbeGetter probeGetter;
+  probeGetter.fn.asBool = getter;
+  probeGetter.context = context;
+  probeGetter.type = LIVE_VALUE_BOOL;
+  registerGetterProbe(n, name, probeGetter);
+}
+
+void esp32_live_probe_group(uint16_t n, LiveProbeGroup& group) {
+  if (n < 100 || n > 255 || liveRejectLateProbe(static_cast<uint8_t>(n))) {
     return;
   }
 
-  pins.push_back({
-    id,
-    String("VIRTUAL"),
-    name,
-    nullptr,
-    0.0f,
-    false,
-    pvar,
-    true
-  });
+  ProbeEntry* pin = findPin(static_cast<uint8_t>(n));
+  if (pin == nullptr || pin->cfg != "VIRTUAL") {
+    return;
+  }
+
+  pin->group = &group;
+
+  for (LiveProbeGroup* known : probeGroups) {
+    if (known == &group) {
+      return;
+    }
+  }
+  probeGroups.push_back(&group);
 }
 
 void registerSafePins() {
   for (size_t i = 0; i < SAFE_PIN_COUNT; ++i) {
     const uint8_t n = SAFE_PINS[i];
 
-    if (findPin(n) == nullptr) {
-      pins.push_back({
-        n,
-        String("-"),
-        String("-"),
-        nullptr,
-        0.0f,
-        false,
-        nullptr,
-        false
-      });
+    if (findPin(n) == nullptr && !liveRejectLateProbe(n)) {
+      pins.push_back(makeProbeEntry(n, String("-"), String("-")));
     }
   }
 }
@@ -240,18 +485,30 @@ void registerSafePins() {
    JSON generation
    -------------------------------------------------------------------------- */
 
-void jsonAddProbe(JsonObject object, const ProbeEntry& pin) {
-  const bool isVirtual = pin.cfg == "VIRTUAL";
+static int32_t callIntegerGetter(const ProbeGetter& getter) {
+  if (getter.type == LIVE_VALUE_BOOL) {
+    return getter.fn.asBool(getter.context) ? 1 : 0;
+  }
+  return getter.fn.asInt32(getter.context);
+}
 
-  object["num"] = pin.num;
-  object["config"] = isVirtual ? "VIRTUAL" : pin.cfg;
-  object["direction"] = pin.dir;
-  object["src"] =
-      isVirtual ? "virtual" : (isDacPin(pin.num) ? "dac" : "hw");
+// Reads one probe. Hardware GPIO reads happen here, so the captured value is
+// exactly what will be serialized.
+static LiveValue captureProbe(const ProbeEntry& pin) {
+  LiveValue captured;
+
+  if (liveIsVirtualProbe(pin) &&
+      pin.hasCtxGetter &&
+      pin.ctxGetter.type != LIVE_VALUE_FLOAT) {
+    captured.i = callIntegerGetter(pin.ctxGetter);
+    return captured;
+  }
 
   float injected = NAN;
 
-  if (pin.getter != nullptr) {
+  if (pin.hasCtxGetter) {
+    injected = pin.ctxGetter.fn.asFloat(pin.ctxGetter.context);
+  } else if (pin.getter != nullptr) {
     injected = pin.getter();
   } else if (pin.hasPtr && pin.ptr != nullptr) {
     injected = *(pin.ptr);
@@ -259,34 +516,18 @@ void jsonAddProbe(JsonObject object, const ProbeEntry& pin) {
     injected = pin.cur;
   }
 
-  if (isVirtual) {
-    const float value = isnan(injected) ? 0.0f : injected;
-
-    char buffer[20];
-    snprintf(buffer, sizeof(buffer), "%.3f", value);
-
-    object["value"] = atof(buffer);
-    object["voltage"] = "-";
-    return;
+  if (liveIsVirtualProbe(pin)) {
+    captured.f = injected;
+    return captured;
   }
 
-  const bool analog = pin.cfg == "ANALOG";
-  const bool output = pin.dir == "OUT";
-  const bool dacPin = analog && output && isDacPin(pin.num);
-
-  if (!analog) {
-    int digitalValue;
-
+  if (pin.kind == LIVE_PROBE_DIGITAL) {
     if (!isnan(injected)) {
-      digitalValue = injected != 0.0f ? 1 : 0;
+      captured.i = injected != 0.0f ? 1 : 0;
     } else {
-      digitalValue = digitalRead(pin.num) ? 1 : 0;
+      captured.i = digitalRead(pin.num) ? 1 : 0;
     }
-
-    object["value"] = digitalValue;
-    object["digital"] = digitalValue;
-    object["voltage"] = digitalValue ? 3.3f : 0.0f;
-    return;
+    return captured;
   }
 
   int analogValue;
@@ -294,33 +535,242 @@ void jsonAddProbe(JsonObject object, const ProbeEntry& pin) {
   if (!isnan(injected)) {
     analogValue = static_cast<int>(injected);
 
-    if (dacPin && analogValue >= 0 && analogValue <= 255) {
+    if (pin.kind == LIVE_PROBE_DAC_OUT &&
+        analogValue >= 0 &&
+        analogValue <= 255) {
       analogValue *= 16;
     }
   } else {
     analogValue = analogRead(pin.num);
   }
 
-  analogValue = constrain(analogValue, 0, 4095);
+  captured.i = constrain(analogValue, 0, 4095);
+  return captured;
+}
 
-  object["value"] = analogValue;
-  object["analog"] = analogValue;
-  object["voltage"] = 3.3f * analogValue / 4095.0f;
+void jsonAddProbe(JsonObject object, const ProbeEntry& pin) {
+  jsonAddProbeValue(object, pin, captureProbe(pin));
 }
 
-void jsonAddHeader(JsonObject document) {
-  document["ver"] = ESP32_LIVE_VERSION;
-  document["timestamp"] =
-      static_cast<uint64_t>(esp_timer_get_time()) / 1000ULL;
-  document["rate"] = samplingIntervalMs;
-
-#if ESP32_LIVE_INCLUDE_CHIP_TEMP
-  #if defined(CONFIG_IDF_TARGET_ESP32) || SOC_TEMP_SENSOR_SUPPORTED
-    document["temp"] = temperatureRead();
-  #endif
+/* --------------------------------------------------------------------------
+   Acquisition
+   -------------------------------------------------------------------------- */
+
+// Seqlock read of all members of one group. The group is accepted only when
+// its sequence number is even and unchanged across the member reads. When
+// every attempt overlaps a write, the previous consistent values are kept
+// so a torn update is never transmitted.
+static void captureGroup(
+    LiveProbeGroup& group,
+    LiveValue* values,
+    size_t count,
+    bool mayYield) {
+
+  for (uint32_t attempt = 0; attempt < ESP32_LIVE_GROUP_RETRIES; ++attempt) {
+    const uint32_t before =
+        group.sequence.load(std::memory_order_acquire);
+
+    if ((before & 1U) == 0) {
+      for (size_t i = 0; i < count; ++i) {
+        if (pins[i].group == &group) {
+          values[i] = captureProbe(pins[i]);
+        }
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if (group.sequence.load(std::memory_order_relaxed) == before) {
+        for (size_t i = 0; i < count; ++i) {
+          if (pins[i].group == &group) {
+            pins[i].held = values[i];
+          }
+        }
+        return;
+      }
+    }
+
+    // The writer may be the preempted loop task on this core, so stop
+    // spinning after a few attempts and let it finish the update.
+    if (mayYield && attempt >= 3) {
+      vTaskDelay(1);
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    if (pins[i].group == &group) {
+      values[i] = pins[i].held;
+    }
+  }
+}
+
+static void captureProbes(
+    LiveValue* values,
+    size_t count,
+    bool mayYield) {
+
+  for (size_t i = 0; i < count; ++i) {
+    if (pins[i].group == nullptr) {
+      values[i] = captureProbe(pins[i]);
+    }
+  }
+
+  for (LiveProbeGroup* group : probeGroups) {
+    captureGroup(*group, values, count, mayYield);
+  }
+}
+
+/* ---- Memory placement ---- */
+
+void* liveAlloc(size_t bytes, LiveMemory memory) {
+  if (bytes == 0) {
+    return nullptr;
+  }
+
+  void* buffer = nullptr;
+
+  if (memory == LIVE_MEMORY_BULK && bytes >= ESP32_LIVE_PSRAM_MIN_BYTES) {
+    buffer = heap_caps_aligned_alloc(
+        ESP32_LIVE_CACHE_LINE, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+
+  if (buffer == nullptr) {
+    buffer = heap_caps_aligned_alloc(
+        ESP32_LIVE_CACHE_LINE,
+        bytes,
+        MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+
+  return buffer;
+}
+
+void liveFree(void* buffer) {
+  heap_caps_free(buffer);
+}
+
+static inline CaptureFrame& captureFrame(uint32_t position) {
+  return *reinterpret_cast<CaptureFrame*>(
+      captureBlock +
+      (position % ESP32_LIVE_CAPTURE_DEPTH) * captureStride);
+}
+
+// The probe list is closed before this runs, so the layout covers every
+// probe. If the ring cannot be allocated, capture stays disabled.
+static void allocateCaptureRing() {
+  const size_t frameBytes =
+      sizeof(CaptureFrame) + pins.size() * sizeof(LiveValue);
+  const size_t stride =
+      (frameBytes + ESP32_LIVE_CACHE_LINE - 1) &
+      ~static_cast<size_t>(ESP32_LIVE_CACHE_LINE - 1);
+
+  liveFree(captureBlock);
+  captureBlock = static_cast<uint8_t*>(
+      liveAlloc(stride * ESP32_LIVE_CAPTURE_DEPTH, LIVE_MEMORY_BULK));
+
+  if (captureBlock == nullptr || pins.empty()) {
+    captureProbeCount = 0;
+    return;
+  }
+
+  captureStride = stride;
+  captureProbeCount = pins.size();
+  memset(captureBlock, 0, stride * ESP32_LIVE_CAPTURE_DEPTH);
+
+  for (uint32_t i = 0; i < ESP32_LIVE_CAPTURE_DEPTH; ++i) {
+    CaptureFrame& frame = captureFrame(i);
+    frame.values = reinterpret_cast<LiveValue*>(
+        reinterpret_cast<uint8_t*>(&frame) + sizeof(CaptureFrame));
+  }
+}
+
+// Frames are captured while a client is connected, and also while
+// disconnected if the black box, alarm rules, history or broadcast need
+// them.
+static bool captureWanted() {
+  return (deviceConnected && notifyCharacteristic != nullptr) ||
+         liveBlackboxEnabled() ||
+         liveAlarmsEnabled() ||
+         liveHistoryEnabled() ||
+         liveBroadcastEnabled();
+}
+
+// Captures one snapshot into the ring. Returns true when a frame was stored.
+// Only the probe reads happen here; the black box, alarm rules and history
+// see the frame when the background task drains it, so a sample point in
+// loop() never waits for their locks.
+// The identifier advances on every attempt, including attempts made while
+// no client is connected or while the ring is full, so every missing
+// snapshot is visible as a sample_id gap.
+static bool captureSnapshot(bool mayYield) {
+  if (captureProbeCount == 0) {
+    return false;
+  }
+
+  bool expected = false;
+  if (!captureBusy.compare_exchange_strong(
+          expected, true, std::memory_order_acquire)) {
+    return false;
+  }
+
+  const uint32_t sampleId =
+      nextSampleId.fetch_add(1, std::memory_order_relaxed);
+  const uint64_t sampleTimestampMs = liveNowMs();
+
+  bool stored = false;
+  const uint32_t head = captureHead.load(std::memory_order_relaxed);
+  const uint32_t tail = captureTail.load(std::memory_order_acquire);
+
+  if (captureWanted() && head - tail < ESP32_LIVE_CAPTURE_DEPTH) {
+    CaptureFrame& frame = captureFrame(head);
+    frame.sampleId = sampleId;
+    frame.timestampMs = sampleTimestampMs;
+    captureProbes(frame.values, captureProbeCount, mayYield);
+
+    captureHead.store(head + 1, std::memory_order_release);
+    stored = true;
+    liveBootSampleStored();
+  } else if (captureWanted()) {
+    liveStatsCaptureDropped();
+  }
+
+  captureBusy.store(false, std::memory_order_release);
+  return stored;
+}
+
+#if ESP32_LIVE_INCLUDE_CHIP_TEMP && \
+    (defined(CONFIG_IDF_TARGET_ESP32) || SOC_TEMP_SENSOR_SUPPORTED)
+#define LIVE_SEND_CHIP_TEMP 1
+#else
+#define LIVE_SEND_CHIP_TEMP 0
+#endif
+
+// Chip temperature for the frame header, or null when it is not sent.
+static const float* chipTemperature(float& temperature) {
+#if LIVE_SEND_CHIP_TEMP
+  temperature = temperatureRead();
+  return &temperature;
+#else
+  (void)temperature;
+  return nullptr;
 #endif
 }
 
+static void addFrameHeader(
+    JsonObject header,
+    uint32_t sampleId,
+    uint64_t timestampMs) {
+
+  float temperature;
+  liveJsonAddHeader(
+      header, timestampMs, samplingIntervalMs, chipTemperature(temperature));
+  header["sample_id"] = sampleId;
+}
+
+void jsonAddHeader(JsonObject document) {
+  float temperature;
+  liveJsonAddHeader(
+      document, liveNowMs(), samplingIntervalMs, chipTemperature(temperature));
+}
+
 /* --------------------------------------------------------------------------
    BLE packet transmission
    -------------------------------------------------------------------------- */
@@ -329,71 +779,739 @@ bool esp32_live_is_connected() {
   return deviceConnected;
 }
 
-void sendSnapshot() {
-  if (pins.empty()) {
-    return;
+static size_t chunkLimit() {
+  const size_t mtuPayload =
+      negotiatedMtu > 3 ? static_cast<size_t>(negotiatedMtu) - 3 : 20;
+
+  return mtuPayload < BLE_CHUNK_LIMIT ? mtuPayload : BLE_CHUNK_LIMIT;
+}
+
+size_t liveChunkLimit() {
+  return chunkLimit();
+}
+
+// Rebuilds the chunk plan when the probe set or the MTU has changed since
+// it was computed. In steady state this is two comparisons.
+static const LiveChunkPlan& currentChunkPlan() {
+  const uint32_t generation = probeLayoutGeneration;
+  const size_t limit = chunkLimit();
+
+  if (chunkPlan.valid &&
+      chunkPlan.generation == generation &&
+      chunkPlan.limit == limit) {
+    return chunkPlan;
+  }
+
+  chunkWidths.resize(captureProbeCount);
+  for (size_t i = 0; i < captureProbeCount; ++i) {
+    chunkWidths[i] = liveJsonWorstProbeWidth(pins[i]);
   }
+  chunkHeaderWidth = liveJsonWorstHeaderWidth(LIVE_SEND_CHIP_TEMP != 0);
+
+  liveBuildChunkPlan(
+      chunkPlan,
+      chunkHeaderWidth,
+      chunkWidths.data(),
+      chunkWidths.size(),
+      limit);
+  chunkPlan.generation = generation;
+  return chunkPlan;
+}
 
-  // Advance the identifier on every scheduled acquisition cycle. If the BLE
-  // link is temporarily unavailable, the next received identifier will show
-  // how many complete snapshots were not delivered.
-  const uint32_t sampleId = nextSampleId++;
-  const uint64_t sampleTimestampMs =
-      static_cast<uint64_t>(esp_timer_get_time()) / 1000ULL;
+// One serialized chunk, waiting for its turn to be sent.
+struct EncodedChunk {
+  size_t length;
+  char data[LIVE_JSON_CHUNK_BYTES];
+};
 
-  if (!deviceConnected || notifyCharacteristic == nullptr) {
+#if ESP32_LIVE_PARALLEL_ENCODE
+static const size_t ENCODE_BATCH = ESP32_LIVE_ENCODE_BATCH;
+#else
+static const size_t ENCODE_BATCH = 1;
+#endif
+
+static EncodedChunk encodedChunks[ENCODE_BATCH];
+
+// Values [first, end) belong to the entries of pins listed in indices, or
+// to the entries at the same positions when indices is null.
+static void encodeProbes(
+    JsonObjectConst header,
+    const uint16_t* indices,
+    const LiveValue* values,
+    size_t first,
+    size_t end,
+    uint16_t sequence,
+    bool last,
+    EncodedChunk& out) {
+
+  out.length = liveJsonEncodeChunk(
+      header,
+      pins.data(),
+      indices,
+      values,
+      first,
+      end,
+      sequence,
+      last,
+      out.data,
+      sizeof(out.data));
+}
+
+static void encodeChunk(
+    JsonObjectConst header,
+    const CaptureFrame& frame,
+    const LiveChunkPlan& plan,
+    size_t chunk,
+    EncodedChunk& out) {
+
+  encodeProbes(
+      header,
+      nullptr,
+      frame.values,
+      plan.starts[chunk],
+      plan.starts[chunk + 1],
+      static_cast<uint16_t>(chunk),
+      chunk + 1 == plan.chunkCount(),
+      out);
+}
+
+#if ESP32_LIVE_PARALLEL_ENCODE
+
+// Chunks handed to the encoder task. Written by the background task before
+// it notifies the encoder, and not touched again until encodeDone is given.
+struct EncodeJob {
+  JsonObjectConst header;
+  const CaptureFrame* frame;
+  const LiveChunkPlan* plan;
+  size_t first;
+  size_t count;
+  EncodedChunk* out;
+};
+
+static EncodeJob encodeJob;
+static TaskHandle_t encodeTaskHandle = nullptr;
+static SemaphoreHandle_t encodeDone = nullptr;
+
+// Not pinned: with the background task busy on one core, the scheduler
+// runs it on the other.
+static void encodeTask(void*) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    for (size_t i = 0; i < encodeJob.count; ++i) {
+      encodeChunk(
+          encodeJob.header,
+          *encodeJob.frame,
+          *encodeJob.plan,
+          encodeJob.first + i,
+          encodeJob.out[i]);
+    }
+
+    xSemaphoreGive(encodeDone);
+  }
+}
+
+static bool startEncodeTask() {
+  if (encodeTaskHandle != nullptr) {
+    return true;
+  }
+
+  if (encodeDone == nullptr) {
+    encodeDone = xSemaphoreCreateBinary();
+    if (encodeDone == nullptr) {
+      return false;
+    }
+  }
+
+  xTaskCreate(
+      encodeTask,
+      "esp32_live_enc",
+      ESP32_LIVE_ENCODE_STACK,
+      nullptr,
+      1,
+      &encodeTaskHandle);
+
+  return encodeTaskHandle != nullptr;
+}
+
+#endif
+
+/* --------------------------------------------------------------------------
+   Change-only streaming
+   -------------------------------------------------------------------------- */
+
+static_assert(sizeof(LiveValue) == sizeof(uint32_t),
+              "LiveValue must be one 32-bit word");
+
+static volatile bool changesEnabled = false;
+static uint32_t changesKeyframeMs = 1000;
+
+// Last value sent for every probe, with the per-probe deadband and type
+// flattened into arrays for liveDeltaScan(). Rebuilt with the probe layout.
+static std::vector<uint32_t> changeReference;
+static std::vector<float> changeDeadband;
+static std::vector<uint32_t> changeIntegerMask;
+static std::vector<uint32_t> changeBitmap;
+static std::vector<uint16_t> changeIndices;
+static std::vector<LiveValue> changeValues;
+static uint32_t changeGeneration = 0;
+static bool changeReferenceValid = false;
+static uint64_t lastKeyframeMs = 0;
+
+void esp32_live_changes_enable(uint32_t keyframeMs) {
+  changesKeyframeMs = keyframeMs > 0 ? keyframeMs : 1;
+  changesEnabled = true;
+}
+
+bool esp32_live_deadband(uint8_t n, float deadband) {
+  if (rejectLateDeclaration("esp32_live_deadband", n)) {
+    return false;
+  }
+
+  ProbeEntry* pin = findPin(n);
+  if (pin == nullptr) {
+    return false;
+  }
+
+  pin->deadband = deadband > 0.0f ? deadband : 0.0f;
+  ++probeLayoutGeneration;
+  return true;
+}
+
+static void prepareChangeArrays() {
+  const size_t count = captureProbeCount;
+  const size_t words = liveDeltaWords(count);
+
+  changeReference.assign(count, 0);
+  changeDeadband.assign(count, 0.0f);
+  changeIntegerMask.assign(words, 0);
+  changeBitmap.assign(words, 0);
+  changeIndices.resize(count);
+  changeValues.resize(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    changeDeadband[i] = pins[i].deadband;
+    if (liveIsIntegerProbe(pins[i])) {
+      changeIntegerMask[i / 32] |= 1u << (i % 32);
+    }
+  }
+
+  changeGeneration = probeLayoutGeneration;
+  changeReferenceValid = false;
+}
+
+// Sends the probes of frame that changed beyond their deadband. Returns
+// false when the frame must go out whole instead: a keyframe is due, or
+// there is no reference to compare with yet.
+static bool sendChangedProbes(const CaptureFrame& frame) {
+  if (changeGeneration != probeLayoutGeneration) {
+    prepareChangeArrays();
+  }
+
+  const size_t count = captureProbeCount;
+  const uint32_t* values = reinterpret_cast<const uint32_t*>(frame.values);
+
+  if (!changeReferenceValid ||
+      frame.timestampMs - lastKeyframeMs >= changesKeyframeMs) {
+    memcpy(changeReference.data(), values, count * sizeof(uint32_t));
+    changeReferenceValid = true;
+    lastKeyframeMs = frame.timestampMs;
+    return false;
+  }
+
+  liveDeltaScan(
+      values,
+      changeReference.data(),
+      changeDeadband.data(),
+      changeIntegerMask.data(),
+      count,
+      changeBitmap.data(),
+      nullptr);
+
+  size_t changed = 0;
+  for (size_t word = 0; word < changeBitmap.size(); ++word) {
+    uint32_t bits = changeBitmap[word];
+    while (bits != 0) {
+      const size_t index = word * 32 + __builtin_ctz(bits);
+      changeIndices[changed] = static_cast<uint16_t>(index);
+      changeValues[changed] = frame.values[index];
+      ++changed;
+      bits &= bits - 1;
+    }
+  }
+
+  liveSendProbeValues(
+      frame.sampleId,
+      frame.timestampMs,
+      changeIndices.data(),
+      changeValues.data(),
+      changed,
+      "changes",
+      nullptr);
+  return true;
+}
+
+static void sendFrame(const CaptureFrame& frame) {
+  // Polling clients read the snapshot characteristic and never subscribe;
+  // skip serialization entirely for them. The next subscriber starts from
+  // a full frame.
+  if (!liveClientSubscribed()) {
+    changeReferenceValid = false;
+    return;
+  }
+
+  if (changesEnabled && sendChangedProbes(frame)) {
     return;
   }
 
-  uint16_t sequence = 0;
-  size_t index = 0;
+  const LiveChunkPlan& plan = currentChunkPlan();
+  const size_t chunks = plan.chunkCount();
 
-  while (index < pins.size()) {
 #if ARDUINOJSON_VERSION_MAJOR >= 7
-    JsonDocument document;
+  JsonDocument headerDocument;
 #else
-    StaticJsonDocument<512> document;
+  StaticJsonDocument<256> headerDocument;
 #endif
 
-    jsonAddHeader(document.to<JsonObject>());
-    document["sample_id"] = sampleId;
-    document["timestamp"] = sampleTimestampMs;
-    document["seq"] = sequence;
-    document["last"] = false;
+  addFrameHeader(
+      headerDocument.to<JsonObject>(), frame.sampleId, frame.timestampMs);
+
+  const JsonObjectConst header = headerDocument.as<JsonObjectConst>();
+
+  for (size_t first = 0; first < chunks; first += ENCODE_BATCH) {
+    const size_t count =
+        chunks - first < ENCODE_BATCH ? chunks - first : ENCODE_BATCH;
+    size_t delegated = 0;
+
+#if ESP32_LIVE_PARALLEL_ENCODE
+    // The encoder task takes the second half of the batch.
+    if (count > 1 && startEncodeTask()) {
+      delegated = count / 2;
+      encodeJob.header = header;
+      encodeJob.frame = &frame;
+      encodeJob.plan = &plan;
+      encodeJob.first = first + count - delegated;
+      encodeJob.count = delegated;
+      encodeJob.out = encodedChunks + count - delegated;
+      xTaskNotifyGive(encodeTaskHandle);
+    }
+#endif
 
-    JsonArray pinArray = document.createNestedArray("pins");
+    for (size_t i = 0; i < count - delegated; ++i) {
+      encodeChunk(header, frame, plan, first + i, encodedChunks[i]);
+    }
 
-    while (index < pins.size()) {
-      const size_t candidateIndex = index;
+#if ESP32_LIVE_PARALLEL_ENCODE
+    if (delegated > 0) {
+      xSemaphoreTake(encodeDone, portMAX_DELAY);
+    }
+#endif
 
-      jsonAddProbe(pinArray.createNestedObject(), pins[index]);
-      ++index;
+    for (size_t i = 0; i < count; ++i) {
+      // Alarm notifications are short; let them overtake the rest of a
+      // multi-chunk frame.
+      if (liveAlarmPending()) {
+        liveAlarmService();
+      }
 
-      if (measureJson(document) > BLE_CHUNK_LIMIT) {
-        if (pinArray.size() > 1) {
-          pinArray.remove(pinArray.size() - 1);
-          index = candidateIndex;
-        }
-        break;
+      if (encodedChunks[i].length == 0) {
+        return;
       }
+
+      notifyCharacteristic->setValue(
+          reinterpret_cast<uint8_t*>(encodedChunks[i].data),
+          encodedChunks[i].length);
+
+      notifyCharacteristic->notify();
     }
+  }
+}
 
-    document["last"] = index >= pins.size();
+uint8_t liveSubscriptions() {
+  uint8_t mask = 0;
 
-    char buffer[512];
-    const size_t length =
-        serializeJson(document, buffer, sizeof(buffer));
+  if (notifyDescriptor != nullptr && notifyDescriptor->getNotifications()) {
+    mask |= LIVE_SUBSCRIBED_STREAM;
+  }
+  if (eventsDescriptor != nullptr && eventsDescriptor->getNotifications()) {
+    mask |= LIVE_SUBSCRIBED_EVENTS;
+  }
+  return mask;
+}
 
-    if (length == 0) {
-      return;
+void liveRestoreSubscriptions(uint8_t mask) {
+  if (notifyDescriptor != nullptr) {
+    notifyDescriptor->setNotifications((mask & LIVE_SUBSCRIBED_STREAM) != 0);
+  }
+  if (eventsDescriptor != nullptr) {
+    eventsDescriptor->setNotifications((mask & LIVE_SUBSCRIBED_EVENTS) != 0);
+  }
+}
+
+uint16_t liveNegotiatedMtu() {
+  return negotiatedMtu;
+}
+
+// A stored MTU is only a better guess than ESP32_LIVE_PREFERRED_MTU; it
+// never overrides an exchange that already happened on this connection.
+void liveRestoreMtu(uint16_t mtu) {
+  if (!mtuExchanged && mtu >= 23) {
+    negotiatedMtu = mtu;
+  }
+}
+
+uint32_t liveSamplingIntervalMs() {
+  return samplingIntervalMs;
+}
+
+bool liveClientSubscribed() {
+  return deviceConnected &&
+         notifyCharacteristic != nullptr &&
+         notifyDescriptor != nullptr &&
+         notifyDescriptor->getNotifications();
+}
+
+bool liveSendEvent(JsonObject event) {
+  if (!deviceConnected ||
+      eventsCharacteristic == nullptr ||
+      eventsDescriptor == nullptr ||
+      !eventsDescriptor->getNotifications()) {
+    return false;
+  }
+
+  char buffer[512];
+  const size_t length = serializeJson(event, buffer, sizeof(buffer));
+
+  if (length == 0 || length > chunkLimit()) {
+    return false;
+  }
+
+  eventsCharacteristic->setValue(
+      reinterpret_cast<uint8_t*>(buffer),
+      length);
+
+  eventsCharacteristic->notify();
+  return true;
+}
+
+// Partial frames are planned like full ones, from the worst-case widths of
+// their probes and of a header carrying the tag.
+static LiveChunkPlan partialPlan;
+static std::vector<uint16_t> partialWidths;
+
+bool liveSendProbeValues(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const uint16_t* indices,
+    const LiveValue* values,
+    size_t count,
+    const char* tagKey,
+    const char* tagValue) {
+
+  if (!deviceConnected || notifyCharacteristic == nullptr) {
+    return false;
+  }
+
+  const LiveChunkPlan& plan = currentChunkPlan();
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument headerDocument;
+#else
+  StaticJsonDocument<256> headerDocument;
+#endif
+
+  addFrameHeader(headerDocument.to<JsonObject>(), sampleId, timestampMs);
+
+  size_t headerWidth = chunkHeaderWidth;
+
+  if (tagKey != nullptr) {
+    headerWidth +=
+        liveJsonAddTag(headerDocument.as<JsonObject>(), tagKey, tagValue);
+  }
+
+  partialWidths.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (indices[i] >= chunkWidths.size()) {
+      return false;
+    }
+    partialWidths[i] = chunkWidths[indices[i]];
+  }
+
+  liveBuildChunkPlan(
+      partialPlan,
+      headerWidth,
+      partialWidths.data(),
+      count,
+      plan.limit);
+
+  // A frame without values still goes out as one chunk with an empty
+  // probe array, so its sample_id reaches the app.
+  if (count == 0) {
+    partialPlan.starts.assign(2, 0);
+  }
+
+  const JsonObjectConst header = headerDocument.as<JsonObjectConst>();
+  const size_t chunks = partialPlan.chunkCount();
+  EncodedChunk encoded;
+
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    if (!deviceConnected) {
+      return false;
+    }
+
+    encodeProbes(
+        header,
+        indices,
+        values,
+        partialPlan.starts[chunk],
+        partialPlan.starts[chunk + 1],
+        static_cast<uint16_t>(chunk),
+        chunk + 1 == chunks,
+        encoded);
+
+    if (encoded.length == 0) {
+      return false;
     }
 
     notifyCharacteristic->setValue(
-        reinterpret_cast<uint8_t*>(buffer),
-        length);
+        reinterpret_cast<uint8_t*>(encoded.data),
+        encoded.length);
 
     notifyCharacteristic->notify();
-    ++sequence;
+  }
+
+  return true;
+}
+
+/* --------------------------------------------------------------------------
+   Quantization schema
+   -------------------------------------------------------------------------- */
+
+// Probe layout generation whose schema events were all sent. A disconnect
+// or a {"schema":true} request sets schemaRequested to start over. A
+// declaration that cannot be sent stops the pass, which resumes there on the
+// next cycle.
+static volatile bool schemaRequested = false;
+static uint32_t schemaSentGeneration = 0;
+static uint32_t schemaPassGeneration = 0;
+static size_t schemaNext = 0;
+
+bool esp32_live_quantize(
+    uint8_t n,
+    float minimum,
+    float maximum,
+    uint8_t bits,
+    const char* units) {
+
+  if (rejectLateDeclaration("esp32_live_quantize", n)) {
+    return false;
+  }
+
+  ProbeEntry* pin = findPin(n);
+  if (pin == nullptr ||
+      pin->kind == LIVE_PROBE_DIGITAL ||
+      bits > LIVE_QUANT_MAX_BITS ||
+      !(maximum > minimum)) {
+    return false;
+  }
+
+  pin->hasSchema = true;
+  pin->quantBits = bits;
+  pin->quantMin = minimum;
+  pin->quantMax = maximum;
+  pin->units = limitString(String(units != nullptr ? units : ""), 16);
+  ++probeLayoutGeneration;
+  return true;
+}
+
+static bool sendSchemaEvent(const ProbeEntry& pin) {
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument document;
+#else
+  StaticJsonDocument<256> document;
+#endif
+
+  JsonObject object = document.to<JsonObject>();
+  object["ver"] = ESP32_LIVE_VERSION;
+  object["event"] = "schema";
+  object["num"] = pin.num;
+  object["units"] = pin.units;
+  object["min"] = pin.quantMin;
+  object["max"] = pin.quantMax;
+  object["bits"] = pin.quantBits;
+  if (pin.quantBits > 0) {
+    object["scale"] =
+        liveQuantScale(pin.quantMin, pin.quantMax, pin.quantBits);
+  }
+
+  return liveSendEvent(object);
+}
+
+static void serviceSchema() {
+  if (schemaRequested) {
+    schemaRequested = false;
+    schemaSentGeneration = 0;
+    schemaPassGeneration = 0;
+  }
+
+  const uint32_t generation = probeLayoutGeneration;
+  if (schemaSentGeneration == generation) {
+    return;
+  }
+
+  if (schemaPassGeneration != generation) {
+    schemaPassGeneration = generation;
+    schemaNext = 0;
+  }
+
+  while (schemaNext < pins.size()) {
+    if (pins[schemaNext].hasSchema && !sendSchemaEvent(pins[schemaNext])) {
+      return;
+    }
+    ++schemaNext;
+  }
+
+  schemaSentGeneration = generation;
+}
+
+/* --------------------------------------------------------------------------
+   Snapshot read characteristic
+   -------------------------------------------------------------------------- */
+
+// Copies the newest frame in the capture ring. The producer writes the slot
+// after head, so the copy is consistent unless it captured almost a full
+// ring in the meantime; the copy is then retried.
+static bool copyLatestFrame(
+    uint32_t& sampleId,
+    uint64_t& timestampMs,
+    LiveCompactProbe* probes,
+    size_t& count) {
+
+  for (int attempt = 0; attempt < 3; ++attempt) {
+    const uint32_t head = captureHead.load(std::memory_order_acquire);
+    if (head == 0) {
+      return false;
+    }
+
+    const CaptureFrame& frame = captureFrame(head - 1);
+
+    sampleId = frame.sampleId;
+    timestampMs = frame.timestampMs;
+    count = captureProbeCount < LIVE_COMPACT_MAX_PROBES
+                ? captureProbeCount
+                : LIVE_COMPACT_MAX_PROBES;
+
+    for (size_t i = 0; i < count; ++i) {
+      probes[i].num = pins[i].num;
+      probes[i].type = liveIsIntegerProbe(pins[i])
+                           ? LIVE_COMPACT_INT32
+                           : LIVE_COMPACT_FLOAT;
+      probes[i].bits = static_cast<uint32_t>(frame.values[i].i);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (captureHead.load(std::memory_order_relaxed) - head <
+        ESP32_LIVE_CAPTURE_DEPTH - 1) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool liveCopyLatestFrame(
+    uint32_t& sampleId,
+    uint64_t& timestampMs,
+    LiveCompactProbe* probes,
+    size_t& count) {
+
+  return copyLatestFrame(sampleId, timestampMs, probes, count);
+}
+
+// Runs on the Bluetooth stack task for the first read request; long read
+// continuations are served from the value set here, so every part of a
+// long read belongs to the same snapshot. Probes are never read here: the
+// newest frame of the capture ring is served as it is, and an empty value
+// means nothing was captured yet.
+static void serveLatestSnapshot(BLECharacteristic* characteristic) {
+  static LiveCompactProbe probes[LIVE_COMPACT_MAX_PROBES];
+  static uint8_t buffer[LIVE_COMPACT_MAX_SIZE];
+
+  uint32_t sampleId = 0;
+  uint64_t timestampMs = 0;
+  size_t count = 0;
+
+  size_t length = 0;
+  if (copyLatestFrame(sampleId, timestampMs, probes, count)) {
+    length = liveCompactEncode(
+        buffer, sizeof(buffer), sampleId, timestampMs, probes, count);
+  }
+
+  characteristic->setValue(buffer, length);
+}
+
+class SnapshotReadCB : public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic* characteristic) override {
+    serveLatestSnapshot(characteristic);
+  }
+};
+
+// Records, evaluates, serializes and transmits every captured frame in
+// capture order.
+static void drainCaptures() {
+  uint32_t tail = captureTail.load(std::memory_order_relaxed);
+
+  while (tail != captureHead.load(std::memory_order_acquire)) {
+    const CaptureFrame& frame = captureFrame(tail);
+
+    liveBlackboxRecord(
+        frame.sampleId, frame.timestampMs, frame.values, captureProbeCount);
+    if (liveAlarmEvaluate(
+            frame.sampleId,
+            frame.timestampMs,
+            frame.values,
+            captureProbeCount)) {
+      liveAlarmService();
+    }
+    liveHistoryRecord(
+        frame.sampleId, frame.timestampMs, frame.values, captureProbeCount);
+
+    sendFrame(frame);
+    ++tail;
+    captureTail.store(tail, std::memory_order_release);
+  }
+}
+
+void sendSnapshot() {
+  if (pins.empty()) {
+    return;
+  }
+
+  captureSnapshot(true);
+  liveAlarmService();
+  drainCaptures();
+}
+
+void esp32_live_sample_point() {
+  if (!liveInitialized) {
+    return;
+  }
+
+  samplePointMode = true;
+
+  const int64_t nowUs = esp_timer_get_time();
+  const int64_t intervalUs =
+      static_cast<int64_t>(samplingIntervalMs) * 1000LL;
+
+  if (lastSamplePointUs != 0 && nowUs - lastSamplePointUs < intervalUs) {
+    return;
+  }
+  lastSamplePointUs = nowUs;
+
+  // Never yield here: the caller is the control loop, and any group it
+  // writes cannot be mid-update at its own sample point.
+  if (captureSnapshot(false) && liveTaskHandle != nullptr) {
+    xTaskNotifyGive(liveTaskHandle);
   }
 }
 
@@ -403,13 +1521,41 @@ void sendSnapshot() {
 
 void AdvCB::onConnect(BLEServer* server) {
   (void)server;
+  // The companion app requests ESP32_LIVE_PREFERRED_MTU right after
+  // connecting; onMtuChanged() corrects this if it negotiates less.
+  negotiatedMtu = ESP32_LIVE_PREFERRED_MTU;
+  mtuExchanged = false;
   deviceConnected = true;
 }
 
+#if defined(CONFIG_BLUEDROID_ENABLED)
+void AdvCB::onConnect(
+    BLEServer* server,
+    esp_ble_gatts_cb_param_t* param) {
+
+  (void)server;
+  liveStatsConnected(param);
+}
+
+void AdvCB::onMtuChanged(
+    BLEServer* server,
+    esp_ble_gatts_cb_param_t* param) {
+
+  (void)server;
+  negotiatedMtu = param->mtu.mtu;
+  mtuExchanged = true;
+  liveBondPreferencesChanged();
+}
+#endif
+
 void AdvCB::onDisconnect(BLEServer* server) {
   deviceConnected = false;
+  schemaRequested = true;
+  liveBondDisconnected();
+  liveStatsDisconnected();
   delay(100);
-  server->startAdvertising();
+  (void)server;
+  liveBroadcastAdvertise();
 }
 
 void setSamplingIntervalClamped(uint32_t ms) {
@@ -420,8 +1566,59 @@ void setSamplingIntervalClamped(uint32_t ms) {
     ms = ESP32_LIVE_RATE_MAX;
   }
   samplingIntervalMs = ms;
+  liveBondPreferencesChanged();
+}
+
+// Client Characteristic Configuration writes are remembered for bonded
+// peers.
+class SubscriptionCB : public BLEDescriptorCallbacks {
+  void onWrite(BLEDescriptor* descriptor) override {
+    (void)descriptor;
+    liveBondPreferencesChanged();
+  }
+};
+
+// Counts notifications the stack accepted or rejected. A disabled
+// subscription is not a link failure and is not counted.
+class NotifyStatusCB : public BLECharacteristicCallbacks {
+  void onStatus(
+      BLECharacteristic* characteristic,
+      Status status,
+      uint32_t code) override {
+
+    (void)characteristic;
+    (void)code;
+
+    if (status == SUCCESS_NOTIFY) {
+      liveStatsNotifyStatus(true);
+    } else if (status == ERROR_GATT) {
+      liveStatsNotifyStatus(false);
+    }
+  }
+};
+
+#if defined(CONFIG_BLUEDROID_ENABLED)
+static void liveGapEvent(
+    esp_gap_ble_cb_event_t event,
+    esp_ble_gap_cb_param_t* param) {
+
+  liveBondGapEvent(event, param);
+  liveStatsGapEvent(event, param);
+#if defined(CONFIG_BT_BLE_50_FEATURES_SUPPORTED)
+  liveBroadcastGapEvent(event, param);
+#endif
 }
 
+static void liveGattsEvent(
+    esp_gatts_cb_event_t event,
+    esp_gatt_if_t gattsIf,
+    esp_ble_gatts_cb_param_t* param) {
+
+  liveBondGattsInterface(gattsIf);
+  liveStatsGattsEvent(event, param);
+}
+#endif
+
 void CtrlCB::onWrite(BLECharacteristic* characteristic) {
   const auto raw = characteristic->getValue();
   const char* text = raw.c_str();
@@ -456,7 +1653,7 @@ void CtrlCB::onWrite(BLECharacteristic* characteristic) {
 #if ARDUINOJSON_VERSION_MAJOR >= 7
   JsonDocument document;
 #else
-  StaticJsonDocument<64> document;
+  StaticJsonDocument<256> document;
 #endif
 
   const DeserializationError error =
@@ -471,18 +1668,51 @@ void CtrlCB::onWrite(BLECharacteristic* characteristic) {
         static_cast<uint32_t>(document["rate"].as<int>()));
   }
 
+  JsonObject history = document["history"];
+  if (!history.isNull()) {
+    liveHistoryRequest(history);
+  }
+
+  if (document["schema"].as<bool>()) {
+    schemaRequested = true;
+  }
+
 }
 
 /* --------------------------------------------------------------------------
    Background task
    -------------------------------------------------------------------------- */
 
+// Lower-priority work done once per cycle after the snapshot is sent.
+static void serviceFeatures() {
+  liveWatchService();
+  liveBlackboxService();
+  liveUlpService();
+  liveBondService();
+  liveStatsService();
+  liveHistoryService();
+  liveBroadcastService();
+  liveBootService();
+  serviceSchema();
+}
+
 static void esp32LiveTask(void*) {
   TickType_t lastWakeTime = xTaskGetTickCount();
   uint32_t previousIntervalMs = samplingIntervalMs;
 
   while (true) {
+    if (samplePointMode) {
+      // Acquisition happens in loop(); wait for the next captured frame.
+      liveAlarmService();
+      drainCaptures();
+      serviceFeatures();
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(samplingIntervalMs) + 1);
+      lastWakeTime = xTaskGetTickCount();
+      continue;
+    }
+
     sendSnapshot();
+    serviceFeatures();
 
     const uint32_t currentIntervalMs = samplingIntervalMs;
 
@@ -509,35 +1739,35 @@ static void esp32LiveTask(void*) {
    Initialization
    -------------------------------------------------------------------------- */
 
-void esp32_live_begin(
-    uint32_t ms,
-    const char* deviceName) {
-
-  setSamplingIntervalClamped(ms);
-
-  if (liveInitialized) {
-    return;
-  }
-
-  const char* resolvedName =
-      (deviceName != nullptr && deviceName[0] != '\0')
-          ? deviceName
-          : "ESP32-device";
+// Device name kept for the bring-up, which may run after begin returned.
+static String liveDeviceName;
 
-  BLEDevice::init(resolvedName);
+// Bluetooth initialization, GATT table and advertising.
+static void startBluetooth() {
+  BLEDevice::init(liveDeviceName.c_str());
   BLEDevice::setMTU(ESP32_LIVE_PREFERRED_MTU);
+#if defined(CONFIG_BLUEDROID_ENABLED)
+  BLEDevice::setCustomGapHandler(liveGapEvent);
+  BLEDevice::setCustomGattsHandler(liveGattsEvent);
+#endif
+  liveBondBegin();
 
   BLEServer* server = BLEDevice::createServer();
   server->setCallbacks(new AdvCB());
 
   BLEService* service =
-      server->createService(LIVE_SERVICE_UUID);
+      server->createService(
+          BLEUUID(LIVE_SERVICE_UUID),
+          ESP32_LIVE_SERVICE_HANDLES);
 
   notifyCharacteristic = service->createCharacteristic(
       LIVE_NOTIFY_UUID,
       BLECharacteristic::PROPERTY_NOTIFY);
 
-  notifyCharacteristic->addDescriptor(new BLE2902());
+  notifyDescriptor = new BLE2902();
+  notifyDescriptor->setCallbacks(new SubscriptionCB());
+  notifyCharacteristic->addDescriptor(notifyDescriptor);
+  notifyCharacteristic->setCallbacks(new NotifyStatusCB());
 
   writeCharacteristic = service->createCharacteristic(
       LIVE_WRITE_UUID,
@@ -545,6 +1775,21 @@ void esp32_live_begin(
 
   writeCharacteristic->setCallbacks(new CtrlCB());
 
+  eventsCharacteristic = service->createCharacteristic(
+      LIVE_EVENTS_UUID,
+      BLECharacteristic::PROPERTY_NOTIFY);
+
+  eventsDescriptor = new BLE2902();
+  eventsDescriptor->setCallbacks(new SubscriptionCB());
+  eventsCharacteristic->addDescriptor(eventsDescriptor);
+  eventsCharacteristic->setCallbacks(new NotifyStatusCB());
+
+  snapshotCharacteristic = service->createCharacteristic(
+      LIVE_SNAPSHOT_UUID,
+      BLECharacteristic::PROPERTY_READ);
+
+  snapshotCharacteristic->setCallbacks(new SnapshotReadCB());
+
   service->start();
 
   BLEAdvertising* advertising =
@@ -552,19 +1797,76 @@ void esp32_live_begin(
 
   advertising->addServiceUUID(LIVE_SERVICE_UUID);
   advertising->setScanResponse(true);
+  liveBroadcastBegin(
+      advertising, LIVE_SERVICE_UUID, liveDeviceName.c_str());
 
-  BLEDevice::startAdvertising();
+  liveBroadcastAdvertise();
+  liveBootAdvertising();
+}
+
+static void bringUpTask(void*) {
+  startBluetooth();
+  vTaskDelete(nullptr);
+}
+
+static void beginLive(uint32_t ms, const char* deviceName, bool async) {
+  liveBootBegin(async);
+  setSamplingIntervalClamped(ms);
+
+  if (liveInitialized) {
+    return;
+  }
+
+  liveDeviceName =
+      (deviceName != nullptr && deviceName[0] != '\0')
+          ? deviceName
+          : "ESP32-device";
+
+  // The ring exists before Bluetooth, so an asynchronous start captures
+  // from the first sampling period on.
+  probeListClosed = true;
+  allocateCaptureRing();
+  liveHistoryBegin(captureProbeCount);
+
+  if (async) {
+    xTaskCreate(
+        bringUpTask,
+        "esp32_live_init",
+        ESP32_LIVE_INIT_STACK,
+        nullptr,
+        1,
+        nullptr);
+  } else {
+    startBluetooth();
+  }
 
   if (liveTaskHandle == nullptr) {
     xTaskCreate(
         esp32LiveTask,
         "esp32_live",
-        4096,
+        ESP32_LIVE_TASK_STACK,
         nullptr,
         1,
         &liveTaskHandle);
   }
 
+  esp32_live_sensors_start();
+
   liveInitialized = true;
+  liveBootReturned();
+}
+
+void esp32_live_begin(
+    uint32_t ms,
+    const char* deviceName) {
+
+  beginLive(ms, deviceName, false);
+}
+
+void esp32_live_begin_async(
+    uint32_t ms,
+    const char* deviceName) {
+
+  beginLive(ms, deviceName, true);
 }
 
@@ -20,40 +20,17 @@
 #include <BLEUtils.h>
 #include <BLEServer.h>
 #include <BLE2902.h>
+#include <esp_system.h>
 
-#include <vector>
-
-/* --------------------------------------------------------------------------
-   Version and configuration
-   -------------------------------------------------------------------------- */
-
-#define ESP32_LIVE_VERSION "1.7.2"
-
-// Include internal chip temperature in the JSON header when the selected
-// ESP32 target provides temperatureRead(). This is chip temperature, not
-// ambient room temperature.
-#ifndef ESP32_LIVE_INCLUDE_CHIP_TEMP
-#define ESP32_LIVE_INCLUDE_CHIP_TEMP 1
-#endif
-
-// Preferred JSON payload size for a BLE notification.
-// The companion app should request an MTU of 247 after connecting.
-#ifndef BLE_CHUNK_LIMIT
-#define BLE_CHUNK_LIMIT 240
-#endif
-
-#ifndef ESP32_LIVE_PREFERRED_MTU
-#define ESP32_LIVE_PREFERRED_MTU 247
-#endif
-
-
-#ifndef ESP32_LIVE_RATE_MIN
-#define ESP32_LIVE_RATE_MIN 20
-#endif
+#include "esp32_live_config.h"
+#include "esp32_live_plan.h"
+#include "esp32_live_probe.h"
+#include "esp32_live_sensors.h"
 
-#ifndef ESP32_LIVE_RATE_MAX
-#define ESP32_LIVE_RATE_MAX 60000
-#endif
+#include <atomic>
+#include <functional>
+#include <type_traits>
+#include <vector>
 
 /* --------------------------------------------------------------------------
    Target identification
@@ -84,18 +61,6 @@ extern const uint8_t SAFE_PINS[];
 extern const size_t SAFE_PIN_COUNT;
 
 bool isRealGpio(uint8_t n);
-bool isDacPin(uint8_t n);
-
-struct ProbeEntry {
-  uint8_t num;
-  String cfg;
-  String dir;
-  float (*getter)();
-  float cur;
-  bool hasCur;
-  const volatile float* ptr;
-  bool hasPtr;
-};
 
 extern std::vector<ProbeEntry> pins;
 
@@ -111,6 +76,10 @@ void esp32_live_register_pin(
    Public probe macros
    -------------------------------------------------------------------------- */
 
+// Register every probe before esp32_live_begin(). Later registrations,
+// including a new cfg, name or getter for an existing probe, are ignored
+// and an error is logged.
+
 // Monitor a float variable. Valid virtual IDs are 100 through 255.
 #define ESP32_PROBE_VIRTUAL(id, var) \
     esp32_live_probe_impl((id), &(var), #var)
@@ -120,11 +89,82 @@ void esp32_live_register_pin(
     esp32_live_register_pin( \
         static_cast<uint8_t>(pin), String(cfg), String(dir), nullptr)
 
+// Monitor the value returned by getter(context). The getter may return
+// float, int32_t or bool. Valid virtual IDs are 100 through 255.
+#define ESP32_PROBE_GETTER(id, name, getter, context) \
+    esp32_live_probe_getter((id), (name), (getter), (context))
+
+// Monitor a data member or a parameterless member function of an object:
+//     ESP32_PROBE_MEMBER(110 + i, "current", channels[i], &Channel::current);
+// One small trampoline is generated per member, not per object.
+#define ESP32_PROBE_MEMBER(id, name, object, member) \
+    esp32_live_probe_getter( \
+        (id), (name), \
+        &LiveMemberThunk<member>::call, \
+        const_cast<void*>(static_cast<const volatile void*>(&(object))))
+
+// Monitor a float variable that belongs to a probe group.
+#define ESP32_PROBE_VIRTUAL_IN_GROUP(id, var, group) \
+    do { \
+      esp32_live_probe_impl((id), &(var), #var); \
+      esp32_live_probe_group((id), (group)); \
+    } while (0)
+
 void esp32_live_probe_impl(
     uint16_t n,
     const volatile float* pvar,
     const char* varName);
 
+// Adds an already registered virtual probe to a group. Members of one group
+// are always sampled together from a single consistent update.
+void esp32_live_probe_group(uint16_t n, LiveProbeGroup& group);
+
+void esp32_live_probe_getter(
+    uint16_t n,
+    const char* name,
+    float (*getter)(void* context),
+    void* context = nullptr);
+
+void esp32_live_probe_getter(
+    uint16_t n,
+    const char* name,
+    int32_t (*getter)(void* context),
+    void* context = nullptr);
+
+void esp32_live_probe_getter(
+    uint16_t n,
+    const char* name,
+    bool (*getter)(void* context),
+    void* context = nullptr);
+
+// Maps a member type to the getter return type used by ESP32_PROBE_MEMBER.
+// Integers are sent as int32_t, floating-point values as float.
+template <typename T>
+struct LiveGetterResult {
+  using type = typename std::conditional<
+      std::is_same<T, bool>::value,
+      bool,
+      typename std::conditional<
+          std::is_integral<T>::value || std::is_enum<T>::value,
+          int32_t,
+          float>::type>::type;
+};
+
+template <auto Member>
+struct LiveMemberThunk;
+
+template <typename T, typename M, M T::*Member>
+struct LiveMemberThunk<Member> {
+  using Raw = typename std::remove_cv<typename std::remove_reference<
+      typename std::invoke_result<decltype(Member), T&>::type>::type>::type;
+  using Result = typename LiveGetterResult<Raw>::type;
+
+  static Result call(void* context) {
+    return static_cast<Result>(
+        std::invoke(Member, *static_cast<T*>(context)));
+  }
+};
+
 void registerSafePins();
 
 /* --------------------------------------------------------------------------
@@ -146,6 +186,14 @@ class AdvCB : public BLEServerCallbacks {
 public:
   void onConnect(BLEServer* server) override;
   void onDisconnect(BLEServer* server) override;
+#if defined(CONFIG_BLUEDROID_ENABLED)
+  void onConnect(
+      BLEServer* server,
+      esp_ble_gatts_cb_param_t* param) override;
+  void onMtuChanged(
+      BLEServer* server,
+      esp_ble_gatts_cb_param_t* param) override;
+#endif
 };
 
 class CtrlCB : public BLECharacteristicCallbacks {
@@ -167,3 +215,288 @@ void esp32_live_begin(
     uint32_t ms = 50,
     const char* deviceName = "ESP32-device");
 
+// Same as esp32_live_begin(), but returns without waiting for Bluetooth.
+// Sampling starts at once, so the history and black box see the rest of
+// setup(); Bluetooth is initialized and advertising starts in the
+// background a few hundred milliseconds later.
+void esp32_live_begin_async(
+    uint32_t ms = 50,
+    const char* deviceName = "ESP32-device");
+
+// Optional. Call once per loop() iteration at a fixed place, for example
+// right after the control output is computed:
+//     esp32_live_sample_point();
+//
+// The first snapshot point reached after each sampling interval captures all
+// probes into the capture ring from the loop task itself. The background
+// task then only serializes and transmits. Once this function has been
+// called, the background task no longer samples on its own.
+void esp32_live_sample_point();
+
+/* --------------------------------------------------------------------------
+   Deep-sleep sampling
+   -------------------------------------------------------------------------- */
+
+// Available on the original ESP32 and ESP32-S3 (ULP-FSM). On other targets
+// the selection functions return false and esp32_live_ulp_sleep() returns
+// without sleeping.
+//
+// Typical battery-node setup():
+//     esp32_live_ulp_probe_gpio(4);
+//     esp32_live_ulp_probe_adc(7, 3000);
+//     esp32_live_begin(50, "Node-07");
+//     esp32_live_ulp_upload(10000);
+//     esp32_live_ulp_sleep(1000, 15 * 60 * 1000);
+//
+// Call the selection functions before esp32_live_begin(): after a ULP wake
+// they also restore the previous session's clock and sample_id, so the
+// live stream continues where the sleeping record stopped.
+
+// Samples an RTC-capable GPIO level during deep sleep. The pin is also
+// registered as a DIGITAL IN probe for the awake periods.
+bool esp32_live_ulp_probe_gpio(uint8_t gpio);
+
+// Samples one ADC1 GPIO during deep sleep. A non-zero wakeAbove or wakeBelow
+// wakes the main CPU as soon as a raw 12-bit reading crosses it.
+bool esp32_live_ulp_probe_adc(
+    uint8_t gpio,
+    uint16_t wakeAbove = 0,
+    uint16_t wakeBelow = 0);
+
+// Records captured during the last sleep and not uploaded yet.
+size_t esp32_live_ulp_pending();
+
+// Waits up to timeoutMs for a subscribed client and uploads the pending
+// records as snapshot frames marked "ulp": true. The frames are sent by the
+// background task, so call it after esp32_live_begin(); it blocks until the
+// upload has finished. Returns true when nothing is left to upload.
+bool esp32_live_ulp_upload(uint32_t timeoutMs = 10000);
+
+// Starts the ULP program and enters deep sleep. The main CPU wakes when the
+// buffer is full, on an ADC threshold, or after maxSleepMs (0 = no timer).
+// Only returns if sleep could not be started.
+void esp32_live_ulp_sleep(uint32_t samplePeriodMs, uint32_t maxSleepMs = 0);
+
+/* --------------------------------------------------------------------------
+   Crash black box
+   -------------------------------------------------------------------------- */
+
+// Keeps the last ESP32_LIVE_BLACKBOX_DEPTH snapshots in RTC memory. Call
+// before esp32_live_begin():
+//     esp32_live_blackbox_enable();
+//     esp32_live_begin(50);
+//
+// When the previous run ended with a panic, watchdog, brownout, external or
+// software reset, its snapshots are uploaded oldest first after a client
+// subscribes, as frames marked "blackbox": "<reason>". Power-on and
+// deep-sleep wakes start with an empty record.
+void esp32_live_blackbox_enable();
+
+// True while a record from the previous run is waiting to be uploaded.
+bool esp32_live_blackbox_available();
+
+// Snapshots of the pending record not uploaded yet.
+size_t esp32_live_blackbox_records();
+
+// Reset reason that ended the run of the pending record.
+esp_reset_reason_t esp32_live_blackbox_reset_reason();
+
+/* --------------------------------------------------------------------------
+   Write watch
+   -------------------------------------------------------------------------- */
+
+// Available on the ESP32-S3 and ESP32-C3. On other targets esp32_live_watch()
+// returns false.
+//
+// Reports every CPU write to a virtual probe registered by pointer, up to
+// two at a time:
+//     ESP32_PROBE_VIRTUAL(120, setpoint);
+//     esp32_live_watch(120);
+//
+// Each write is sent on the events characteristic with the new value, its
+// timestamp, the core and the program counter of the writing instruction.
+// Intended for variables that change rarely; a variable written in a tight
+// loop fills the event queue and is paused until the queue drains.
+bool esp32_live_watch(uint16_t n);
+
+void esp32_live_unwatch(uint16_t n);
+
+/* --------------------------------------------------------------------------
+   Alarm rules
+   -------------------------------------------------------------------------- */
+
+enum LiveAlarmCondition : uint8_t {
+  LIVE_ALARM_ABOVE = 0,
+  LIVE_ALARM_BELOW
+};
+
+// Declares an alarm on a registered probe. Rules are evaluated on every
+// captured snapshot, also while no client is connected:
+//     ESP32_PROBE_VIRTUAL(101, temperature);
+//     esp32_live_alarm(101, LIVE_ALARM_ABOVE, 30.0f, 0.5f, 2000);
+//
+// The alarm is raised once the value stays beyond threshold for holdMs and
+// cleared when it returns past threshold by more than hysteresis. Each
+// transition is sent immediately on the events characteristic, ahead of any
+// snapshot chunks still waiting.
+//
+// Returns the alarm id, or -1 if the probe is not registered or all
+// ESP32_LIVE_MAX_ALARMS rules are used.
+int esp32_live_alarm(
+    uint16_t n,
+    LiveAlarmCondition condition,
+    float threshold,
+    float hysteresis = 0.0f,
+    uint32_t holdMs = 0);
+
+bool esp32_live_alarm_active(int id);
+
+/* --------------------------------------------------------------------------
+   Bonding
+   -------------------------------------------------------------------------- */
+
+// Optional. Call before esp32_live_begin():
+//     esp32_live_bonding_enable();
+//     esp32_live_begin(50);
+//
+// Phones pair once without a PIN ("Just Works") and are then recognized on
+// every reconnect. A bonded phone keeps the service layout cached and skips
+// discovery. Its subscriptions, sampling rate and negotiated MTU are stored
+// in NVS and restored as soon as the link is encrypted, so snapshots resume
+// without the app re-subscribing.
+void esp32_live_bonding_enable();
+
+// Removes the bonds of the phones recorded by this library and all stored
+// peer preferences. Bonds the sketch made for other services are kept.
+void esp32_live_bonding_clear();
+
+/* --------------------------------------------------------------------------
+   Link telemetry
+   -------------------------------------------------------------------------- */
+
+// Counters for the current connection, reset on every connect.
+struct LiveLinkStats {
+  int8_t rssi;                    // dBm, updated with every stats frame
+  uint32_t connIntervalUs;
+  uint16_t connLatency;
+  uint32_t supervisionTimeoutMs;
+  uint32_t notifyOk;              // notifications accepted by the stack
+  uint32_t notifyFailed;          // notifications the stack rejected
+  uint32_t congestionEvents;      // controller transmit buffers exhausted
+  bool congested;
+  uint16_t txBuffersFree;         // controller packets still available
+  uint32_t captureDrops;          // snapshots skipped, capture ring full
+};
+
+void esp32_live_link_stats(LiveLinkStats& stats);
+
+/* --------------------------------------------------------------------------
+   History
+   -------------------------------------------------------------------------- */
+
+// Optional. Keeps captured snapshots in RAM at several resolutions so the
+// app can plot the recent past after connecting. Call before
+// esp32_live_begin():
+//     esp32_live_history_enable(256 * 1024);
+//     esp32_live_begin(50);
+//
+// Level 0 keeps full-rate snapshots; each further level keeps min/max/mean
+// records summarizing `factor` records of the level below. The budget is
+// taken from PSRAM when available. Returns false for invalid arguments or
+// after esp32_live_begin().
+bool esp32_live_history_enable(
+    size_t budgetBytes,
+    size_t levels = 4,
+    size_t factor = 8);
+
+// True once the history memory was allocated by esp32_live_begin().
+bool esp32_live_history_ready();
+
+/* --------------------------------------------------------------------------
+   Broadcast
+   -------------------------------------------------------------------------- */
+
+// Optional. Call before esp32_live_begin():
+//     esp32_live_broadcast_enable(500);
+//     esp32_live_begin(50);
+//
+// The newest values are advertised in manufacturer-specific data, three
+// probes at a time, rotating every updateMs. Scanners read them without
+// connecting; phones still find and connect to the service. While a client
+// is connected the board does not advertise.
+void esp32_live_broadcast_enable(uint32_t updateMs = 1000);
+
+// Restricts the rotation to the given probes, in call order. Without any
+// call every captured probe is advertised. Returns false when
+// ESP32_LIVE_BROADCAST_MAX_PROBES probes were already added.
+bool esp32_live_broadcast_probe(uint16_t n);
+
+// Bluetooth 5 chips only (ESP32-S3, C3, C6, H2). Call before
+// esp32_live_begin():
+//     esp32_live_periodic_enable(200);
+//
+// Sends the newest snapshot in the compact encoding on a periodic
+// advertising train, updated every updateMs. Any number of listeners can
+// synchronize to the train; it keeps running while a client is connected.
+// Returns false when the Bluetooth stack is built without BLE 5 features.
+bool esp32_live_periodic_enable(uint32_t updateMs = 1000);
+
+/* --------------------------------------------------------------------------
+   Boot timing
+   -------------------------------------------------------------------------- */
+
+// Microseconds since boot; 0 when the step has not happened yet.
+struct LiveBootMetrics {
+  uint32_t beginUs;         // esp32_live_begin() called
+  uint32_t beginReturnUs;   // esp32_live_begin() returned to the sketch
+  uint32_t advertisingUs;   // advertising started
+  uint32_t firstSampleUs;   // first snapshot stored
+  bool async;               // started with esp32_live_begin_async()
+};
+
+void esp32_live_boot_metrics(LiveBootMetrics& metrics);
+
+/* --------------------------------------------------------------------------
+   Change-only streaming
+   -------------------------------------------------------------------------- */
+
+// Optional:
+//     esp32_live_deadband(101, 0.05f);
+//     esp32_live_changes_enable(1000);
+//
+// Each frame carries only the probes that moved by more than their deadband
+// since they were last sent, tagged "changes":true. A full frame is sent
+// every keyframeMs and to every new subscriber, so the app always has a
+// value for every probe. A frame without changes is sent with an empty
+// probe array.
+void esp32_live_changes_enable(uint32_t keyframeMs = 1000);
+
+// Smallest change of probe n that is sent; 0, the default, sends every
+// change. Integer probes compare whole counts. Must be called before
+// esp32_live_begin(). Returns false after it, or when no probe n is
+// registered.
+bool esp32_live_deadband(uint8_t n, float deadband);
+
+/* --------------------------------------------------------------------------
+   Quantization
+   -------------------------------------------------------------------------- */
+
+// Optional:
+//     esp32_live_quantize(101, 0.0f, 100.0f, 8, "%");
+//     esp32_live_quantize(34, 0.0f, 3.3f, 10, "V");
+//
+// Declares the units and range of probe n. With bits between 1 and 16 the
+// probe is sent as a fixed-point code, {"num":101,"q":128}, instead of the
+// full probe object; analog probes are quantized in volts. bits 0 only
+// declares the units and range, for plot scaling. Each declaration is sent
+// as a schema event on the events characteristic once per connection, and
+// again when the app writes {"schema":true}. Must be called before
+// esp32_live_begin(). Returns false after it, or when no probe n is
+// registered, the probe is a digital pin, bits is above 16 or maximum is
+// not above minimum.
+bool esp32_live_quantize(
+    uint8_t n,
+    float minimum,
+    float maximum,
+    uint8_t bits,
+    const char* units = "");
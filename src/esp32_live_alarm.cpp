@@ -0,0 +1,238 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Alarm rules evaluated on every captured snapshot. State changes are queued
+// when the background task drains a captured frame and sent as small
+// notifications on the events characteristic, ahead of snapshot chunks.
+//
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+#include <atomic>
+
+/* --------------------------------------------------------------------------
+   Rules
+   -------------------------------------------------------------------------- */
+
+struct AlarmRule {
+  uint16_t probeIndex;
+  LiveAlarmCondition condition;
+  float threshold;
+  float hysteresis;
+  uint32_t holdMs;
+
+  // Evaluation state, only touched by the background task.
+  bool active;
+  bool pending;
+  uint64_t pendingSinceMs;
+};
+
+struct AlarmEvent {
+  uint32_t sampleId;
+  uint64_t timestampMs;
+  LiveValue value;
+  uint8_t rule;
+  bool raised;
+};
+
+static AlarmRule alarmRules[ESP32_LIVE_MAX_ALARMS];
+static std::atomic<uint32_t> alarmRuleCount{0};
+
+// Single-producer ring: frames are evaluated only by the background task.
+static AlarmEvent alarmEvents[ESP32_LIVE_ALARM_EVENTS];
+static std::atomic<uint32_t> alarmHead{0};
+static std::atomic<uint32_t> alarmTail{0};
+static std::atomic<uint32_t> alarmDropped{0};
+
+static bool conditionMet(const AlarmRule& rule, float value) {
+  if (rule.condition == LIVE_ALARM_ABOVE) {
+    return value > rule.threshold;
+  }
+  return value < rule.threshold;
+}
+
+static bool clearMet(const AlarmRule& rule, float value) {
+  if (rule.condition == LIVE_ALARM_ABOVE) {
+    return value < rule.threshold - rule.hysteresis;
+  }
+  return value > rule.threshold + rule.hysteresis;
+}
+
+static void queueAlarm(
+    uint8_t rule,
+    bool raised,
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    LiveValue value) {
+
+  const uint32_t head = alarmHead.load(std::memory_order_relaxed);
+  const uint32_t tail = alarmTail.load(std::memory_order_acquire);
+
+  if (head - tail >= ESP32_LIVE_ALARM_EVENTS) {
+    alarmDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  AlarmEvent& event = alarmEvents[head % ESP32_LIVE_ALARM_EVENTS];
+  event.sampleId = sampleId;
+  event.timestampMs = timestampMs;
+  event.value = value;
+  event.rule = rule;
+  event.raised = raised;
+
+  alarmHead.store(head + 1, std::memory_order_release);
+}
+
+/* --------------------------------------------------------------------------
+   Acquisition hook
+   -------------------------------------------------------------------------- */
+
+bool liveAlarmsEnabled() {
+  return alarmRuleCount.load(std::memory_order_acquire) != 0;
+}
+
+bool liveAlarmEvaluate(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const LiveValue* values,
+    size_t count) {
+
+  const uint32_t rules = alarmRuleCount.load(std::memory_order_acquire);
+  bool queued = false;
+
+  for (uint32_t i = 0; i < rules; ++i) {
+    AlarmRule& rule = alarmRules[i];
+
+    if (rule.probeIndex >= count) {
+      continue;
+    }
+
+    const LiveValue captured = values[rule.probeIndex];
+    const float value = liveProbeNumber(pins[rule.probeIndex], captured);
+
+    if (!rule.active) {
+      if (!conditionMet(rule, value)) {
+        rule.pending = false;
+        continue;
+      }
+
+      if (!rule.pending) {
+        rule.pending = true;
+        rule.pendingSinceMs = timestampMs;
+      }
+
+      if (timestampMs - rule.pendingSinceMs < rule.holdMs) {
+        continue;
+      }
+
+      rule.active = true;
+      rule.pending = false;
+      queueAlarm(static_cast<uint8_t>(i), true, sampleId, timestampMs, captured);
+      queued = true;
+    } else if (clearMet(rule, value)) {
+      rule.active = false;
+      queueAlarm(static_cast<uint8_t>(i), false, sampleId, timestampMs, captured);
+      queued = true;
+    }
+  }
+
+  return queued;
+}
+
+/* --------------------------------------------------------------------------
+   Transmission
+   -------------------------------------------------------------------------- */
+
+bool liveAlarmPending() {
+  return alarmTail.load(std::memory_order_relaxed) !=
+         alarmHead.load(std::memory_order_acquire);
+}
+
+void liveAlarmService() {
+  uint32_t tail = alarmTail.load(std::memory_order_relaxed);
+
+  while (tail != alarmHead.load(std::memory_order_acquire)) {
+    const AlarmEvent& event = alarmEvents[tail % ESP32_LIVE_ALARM_EVENTS];
+    const AlarmRule& rule = alarmRules[event.rule];
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+    JsonDocument document;
+#else
+    StaticJsonDocument<384> document;
+#endif
+
+    JsonObject object = document.to<JsonObject>();
+    object["ver"] = ESP32_LIVE_VERSION;
+    object["event"] = "alarm";
+    object["id"] = event.rule;
+    object["state"] = event.raised ? "raised" : "cleared";
+    object["sample_id"] = event.sampleId;
+    object["timestamp"] = event.timestampMs;
+    object["threshold"] = rule.threshold;
+
+    const uint32_t dropped =
+        alarmDropped.exchange(0, std::memory_order_relaxed);
+    if (dropped != 0) {
+      object["dropped"] = dropped;
+    }
+
+    jsonAddProbeValue(
+        object.createNestedObject("pin"),
+        pins[rule.probeIndex],
+        event.value);
+
+    // Alarm transitions are live data; without a subscriber they are
+    // discarded. The rule state itself keeps being tracked.
+    liveSendEvent(object);
+
+    ++tail;
+    alarmTail.store(tail, std::memory_order_release);
+  }
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+int esp32_live_alarm(
+    uint16_t n,
+    LiveAlarmCondition condition,
+    float threshold,
+    float hysteresis,
+    uint32_t holdMs) {
+
+  if (n > 255 || hysteresis < 0.0f) {
+    return -1;
+  }
+
+  const int index = liveFindProbeIndex(static_cast<uint8_t>(n));
+  const uint32_t rules = alarmRuleCount.load(std::memory_order_relaxed);
+
+  if (index < 0 || rules >= ESP32_LIVE_MAX_ALARMS) {
+    return -1;
+  }
+
+  AlarmRule& rule = alarmRules[rules];
+  rule.probeIndex = static_cast<uint16_t>(index);
+  rule.condition = condition;
+  rule.threshold = threshold;
+  rule.hysteresis = hysteresis;
+  rule.holdMs = holdMs;
+  rule.active = false;
+  rule.pending = false;
+  rule.pendingSinceMs = 0;
+
+  alarmRuleCount.store(rules + 1, std::memory_order_release);
+  return static_cast<int>(rules);
+}
+
+bool esp32_live_alarm_active(int id) {
+  if (id < 0 ||
+      static_cast<uint32_t>(id) >=
+          alarmRuleCount.load(std::memory_order_acquire)) {
+    return false;
+  }
+  return alarmRules[id].active;
+}
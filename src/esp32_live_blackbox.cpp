@@ -0,0 +1,242 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Crash black box. The background task mirrors the last captured snapshots
+// into a ring in RTC memory that is not initialized at boot. After a panic,
+// watchdog, brownout or software reset, the ring still holds the data that
+// led up to the reset and is uploaded once a client subscribes.
+//
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+#include <esp_system.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+   RTC ring
+   -------------------------------------------------------------------------- */
+
+static const uint32_t BLACKBOX_MAGIC = 0x4C564242;  // "LVBB"
+static const uint32_t BLACKBOX_COMMIT = 0xB1ACB0C5;
+
+// A record is valid only when commit matches its sample_id. The commit word
+// is cleared first and written last, so a reset in the middle of an update
+// leaves that record invalid instead of torn.
+struct BlackboxRecord {
+  uint32_t commit;
+  uint32_t sampleId;
+  uint64_t timestampMs;
+  LiveValue values[ESP32_LIVE_BLACKBOX_PROBES];
+};
+
+struct BlackboxRing {
+  uint32_t magic;
+  uint16_t depth;
+  uint8_t probesPerRecord;
+  uint8_t probeCount;
+  uint32_t head;
+  uint8_t probeNums[ESP32_LIVE_BLACKBOX_PROBES];
+  BlackboxRecord records[ESP32_LIVE_BLACKBOX_DEPTH];
+};
+
+RTC_NOINIT_ATTR static BlackboxRing blackboxRing;
+
+// Record recovered at boot, kept in RAM until it has been uploaded.
+static BlackboxRing* recovered = nullptr;
+static esp_reset_reason_t recoveredReason = ESP_RST_UNKNOWN;
+static bool blackboxEnabled = false;
+
+static bool ringLayoutValid(const BlackboxRing& ring) {
+  return ring.magic == BLACKBOX_MAGIC &&
+         ring.depth == ESP32_LIVE_BLACKBOX_DEPTH &&
+         ring.probesPerRecord == ESP32_LIVE_BLACKBOX_PROBES &&
+         ring.probeCount <= ESP32_LIVE_BLACKBOX_PROBES;
+}
+
+static bool recordValid(const BlackboxRecord& record) {
+  return record.commit == (record.sampleId ^ BLACKBOX_COMMIT);
+}
+
+static size_t validRecords(const BlackboxRing& ring) {
+  size_t count = 0;
+  for (size_t i = 0; i < ESP32_LIVE_BLACKBOX_DEPTH; ++i) {
+    if (recordValid(ring.records[i])) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_EXT:
+      return "external";
+    case ESP_RST_SW:
+      return "software";
+    case ESP_RST_PANIC:
+      return "panic";
+    case ESP_RST_INT_WDT:
+      return "int_wdt";
+    case ESP_RST_TASK_WDT:
+      return "task_wdt";
+    case ESP_RST_WDT:
+      return "wdt";
+    case ESP_RST_BROWNOUT:
+      return "brownout";
+    default:
+      return "unknown";
+  }
+}
+
+/* --------------------------------------------------------------------------
+   Acquisition hook
+   -------------------------------------------------------------------------- */
+
+bool liveBlackboxEnabled() {
+  return blackboxEnabled;
+}
+
+void liveBlackboxRecord(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const LiveValue* values,
+    size_t count) {
+
+  if (!blackboxEnabled) {
+    return;
+  }
+
+  volatile BlackboxRing& ring = blackboxRing;
+
+  // The probe layout is fixed by the first frame after esp32_live_begin().
+  if (ring.probeCount == 0 && count > 0) {
+    const size_t stored =
+        count < ESP32_LIVE_BLACKBOX_PROBES ? count : ESP32_LIVE_BLACKBOX_PROBES;
+
+    for (size_t i = 0; i < stored; ++i) {
+      ring.probeNums[i] = pins[i].num;
+    }
+    ring.probeCount = static_cast<uint8_t>(stored);
+  }
+
+  const size_t stored = ring.probeCount;
+  volatile BlackboxRecord& record =
+      ring.records[ring.head % ESP32_LIVE_BLACKBOX_DEPTH];
+
+  record.commit = 0;
+  for (size_t i = 0; i < stored; ++i) {
+    record.values[i].i = values[i].i;
+  }
+  record.timestampMs = timestampMs;
+  record.sampleId = sampleId;
+  record.commit = sampleId ^ BLACKBOX_COMMIT;
+
+  ring.head = ring.head + 1;
+}
+
+/* --------------------------------------------------------------------------
+   Upload
+   -------------------------------------------------------------------------- */
+
+void liveBlackboxService() {
+  if (recovered == nullptr || !liveClientSubscribed()) {
+    return;
+  }
+
+  uint16_t indices[ESP32_LIVE_BLACKBOX_PROBES];
+  uint8_t sourceSlots[ESP32_LIVE_BLACKBOX_PROBES];
+  size_t mapped = 0;
+
+  // Probes are matched by number, so a record written by the same sketch is
+  // shown with its current metadata. Probes no longer registered are skipped.
+  for (size_t i = 0; i < recovered->probeCount; ++i) {
+    const int index = liveFindProbeIndex(recovered->probeNums[i]);
+    if (index >= 0) {
+      indices[mapped] = static_cast<uint16_t>(index);
+      sourceSlots[mapped] = static_cast<uint8_t>(i);
+      ++mapped;
+    }
+  }
+
+  const char* reason = resetReasonName(recoveredReason);
+  LiveValue values[ESP32_LIVE_BLACKBOX_PROBES];
+
+  // Oldest record first: head points at the slot written next.
+  for (size_t n = 0; n < ESP32_LIVE_BLACKBOX_DEPTH; ++n) {
+    BlackboxRecord& record =
+        recovered->records[(recovered->head + n) % ESP32_LIVE_BLACKBOX_DEPTH];
+
+    if (!recordValid(record)) {
+      continue;
+    }
+
+    for (size_t i = 0; i < mapped; ++i) {
+      values[i] = record.values[sourceSlots[i]];
+    }
+
+    const bool sent = liveSendProbeValues(
+        record.sampleId,
+        record.timestampMs,
+        indices,
+        values,
+        mapped,
+        "blackbox",
+        reason);
+
+    if (!sent) {
+      // Resume with this record on the next subscription.
+      return;
+    }
+
+    // A record is sent once: clearing its commit word skips it on a retry.
+    record.commit = 0;
+    delay(ESP32_LIVE_UPLOAD_PACING_MS);
+  }
+
+  delete recovered;
+  recovered = nullptr;
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+void esp32_live_blackbox_enable() {
+  if (blackboxEnabled) {
+    return;
+  }
+
+  const esp_reset_reason_t reason = esp_reset_reason();
+  const bool afterFailure =
+      reason != ESP_RST_POWERON &&
+      reason != ESP_RST_DEEPSLEEP &&
+      reason != ESP_RST_UNKNOWN;
+
+  if (afterFailure &&
+      ringLayoutValid(blackboxRing) &&
+      validRecords(blackboxRing) > 0) {
+    recovered = new BlackboxRing(blackboxRing);
+    recoveredReason = reason;
+  }
+
+  memset(&blackboxRing, 0, sizeof(blackboxRing));
+  blackboxRing.magic = BLACKBOX_MAGIC;
+  blackboxRing.depth = ESP32_LIVE_BLACKBOX_DEPTH;
+  blackboxRing.probesPerRecord = ESP32_LIVE_BLACKBOX_PROBES;
+
+  blackboxEnabled = true;
+}
+
+bool esp32_live_blackbox_available() {
+  return recovered != nullptr;
+}
+
+size_t esp32_live_blackbox_records() {
+  return recovered != nullptr ? validRecords(*recovered) : 0;
+}
+
+esp_reset_reason_t esp32_live_blackbox_reset_reason() {
+  return recovered != nullptr ? recoveredReason : ESP_RST_UNKNOWN;
+}
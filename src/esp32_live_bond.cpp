@@ -0,0 +1,268 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Optional bonding with per-peer preferences. A bonded phone keeps its GATT
+// cache, so it skips service discovery on reconnect. The library restores
+// that peer's subscriptions, sampling rate and last negotiated MTU as soon as
+// the link is encrypted. Snapshots can then flow before the app writes
+// anything.
+//
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+#if defined(CONFIG_BLUEDROID_ENABLED)
+
+#include <Preferences.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+
+/* --------------------------------------------------------------------------
+   Stored state
+   -------------------------------------------------------------------------- */
+
+static const char* BOND_NAMESPACE = "esp32live";
+
+// Identifies the attribute table of the ESP32 Live service. Phones reuse a
+// cached table for bonded devices, so bump this whenever a characteristic is
+// added, removed or reordered. A peer recorded with another layout receives
+// a Service Changed indication on its next encrypted connection, which makes
+// it discover the service again. Its bond is kept.
+static const uint32_t GATT_LAYOUT_VERSION = 3;
+
+static const uint8_t PEER_PREFERENCES_VERSION = 2;
+
+struct PeerPreferences {
+  uint8_t version;
+  uint8_t subscriptions;
+  uint16_t mtu;
+  uint32_t rateMs;
+  uint32_t layout;
+};
+
+static bool bondingEnabled = false;
+static volatile bool peerBonded = false;
+static volatile bool peerAuthenticated = false;
+static volatile bool preferencesDirty = false;
+static volatile esp_gatt_if_t serverInterface = ESP_GATT_IF_NONE;
+static esp_bd_addr_t peerAddress;
+
+// NVS keys are limited to 15 characters: "p" and the 12 hex digits of the
+// peer's identity address.
+static void peerKey(const esp_bd_addr_t address, char* key, size_t size) {
+  snprintf(
+      key,
+      size,
+      "p%02x%02x%02x%02x%02x%02x",
+      address[0],
+      address[1],
+      address[2],
+      address[3],
+      address[4],
+      address[5]);
+}
+
+static bool peerRecorded(
+    Preferences& preferences,
+    const esp_bd_addr_t address) {
+
+  char key[16];
+  peerKey(address, key, sizeof(key));
+  return preferences.isKey(key);
+}
+
+// Removes the bonds of the phones this library has stored preferences for.
+// Bonds made by the sketch for other services are left alone.
+static void removeRecordedBonds(Preferences& preferences) {
+  const int count = esp_ble_get_bond_device_num();
+  if (count <= 0) {
+    return;
+  }
+
+  std::vector<esp_ble_bond_dev_t> devices(count);
+  int listed = count;
+
+  if (esp_ble_get_bond_device_list(&listed, devices.data()) != ESP_OK) {
+    return;
+  }
+
+  for (int i = 0; i < listed; ++i) {
+    if (peerRecorded(preferences, devices[i].bd_addr)) {
+      esp_ble_remove_bond_device(devices[i].bd_addr);
+    }
+  }
+}
+
+// Restores the stored preferences of a returning peer. A peer that was
+// bonded with another attribute layout, or before it was recorded, is told
+// that the service changed instead.
+static void restorePeer(esp_bd_addr_t address) {
+  char key[16];
+  peerKey(address, key, sizeof(key));
+
+  PeerPreferences stored;
+  size_t length = 0;
+
+  Preferences preferences;
+  if (preferences.begin(BOND_NAMESPACE, true)) {
+    length = preferences.getBytes(key, &stored, sizeof(stored));
+    preferences.end();
+  }
+
+  if (length != sizeof(stored) ||
+      stored.version != PEER_PREFERENCES_VERSION ||
+      stored.layout != GATT_LAYOUT_VERSION) {
+    if (serverInterface != ESP_GATT_IF_NONE) {
+      esp_ble_gatts_send_service_change_indication(serverInterface, address);
+    }
+    return;
+  }
+
+  liveRestoreMtu(stored.mtu);
+  setSamplingIntervalClamped(stored.rateMs);
+  liveRestoreSubscriptions(stored.subscriptions);
+}
+
+static void savePeer() {
+  char key[16];
+  peerKey(peerAddress, key, sizeof(key));
+
+  PeerPreferences stored;
+  stored.version = PEER_PREFERENCES_VERSION;
+  stored.subscriptions = liveSubscriptions();
+  stored.mtu = liveNegotiatedMtu();
+  stored.rateMs = liveSamplingIntervalMs();
+  stored.layout = GATT_LAYOUT_VERSION;
+
+  Preferences preferences;
+  if (!preferences.begin(BOND_NAMESPACE, false)) {
+    return;
+  }
+
+  PeerPreferences previous;
+  const size_t length =
+      preferences.getBytes(key, &previous, sizeof(previous));
+
+  // Avoid flash wear when nothing actually changed.
+  if (length != sizeof(previous) ||
+      memcmp(&previous, &stored, sizeof(stored)) != 0) {
+    preferences.putBytes(key, &stored, sizeof(stored));
+  }
+
+  preferences.end();
+}
+
+/* --------------------------------------------------------------------------
+   Stack hooks
+   -------------------------------------------------------------------------- */
+
+void liveBondBegin() {
+  if (!bondingEnabled) {
+    return;
+  }
+
+  esp_ble_auth_req_t authentication = ESP_LE_AUTH_REQ_SC_BOND;
+  esp_ble_io_cap_t capability = ESP_IO_CAP_NONE;
+  uint8_t keySize = 16;
+  uint8_t keys = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
+
+  esp_ble_gap_set_security_param(
+      ESP_BLE_SM_AUTHEN_REQ_MODE, &authentication, sizeof(authentication));
+  esp_ble_gap_set_security_param(
+      ESP_BLE_SM_IOCAP_MODE, &capability, sizeof(capability));
+  esp_ble_gap_set_security_param(
+      ESP_BLE_SM_MAX_KEY_SIZE, &keySize, sizeof(keySize));
+  esp_ble_gap_set_security_param(
+      ESP_BLE_SM_SET_INIT_KEY, &keys, sizeof(keys));
+  esp_ble_gap_set_security_param(
+      ESP_BLE_SM_SET_RSP_KEY, &keys, sizeof(keys));
+
+  // Encryption is requested on every connection, which re-encrypts bonded
+  // links and pairs new phones.
+  BLEDevice::setEncryptionLevel(ESP_BLE_SEC_ENCRYPT);
+}
+
+// Runs on the Bluetooth stack task. The identity address is only known once
+// authentication completes, so this is where a returning peer is recognized.
+// Its preferences are read from NVS by the background task.
+void liveBondGapEvent(
+    esp_gap_ble_cb_event_t event,
+    esp_ble_gap_cb_param_t* param) {
+
+  if (!bondingEnabled || event != ESP_GAP_BLE_AUTH_CMPL_EVT) {
+    return;
+  }
+
+  const esp_ble_auth_cmpl_t& authentication = param->ble_security.auth_cmpl;
+  if (!authentication.success) {
+    return;
+  }
+
+  memcpy(peerAddress, authentication.bd_addr, sizeof(esp_bd_addr_t));
+  peerAuthenticated = true;
+}
+
+void liveBondGattsInterface(esp_gatt_if_t gattsIf) {
+  serverInterface = gattsIf;
+}
+
+void liveBondPreferencesChanged() {
+  preferencesDirty = true;
+}
+
+void liveBondDisconnected() {
+  peerAuthenticated = false;
+  peerBonded = false;
+}
+
+// NVS reads and writes happen on the background task, never in a stack
+// callback.
+void liveBondService() {
+  if (peerAuthenticated) {
+    peerAuthenticated = false;
+    restorePeer(peerAddress);
+    peerBonded = true;
+    preferencesDirty = true;
+  }
+
+  if (!preferencesDirty || !peerBonded) {
+    return;
+  }
+
+  preferencesDirty = false;
+  savePeer();
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+void esp32_live_bonding_enable() {
+  bondingEnabled = true;
+}
+
+void esp32_live_bonding_clear() {
+  Preferences preferences;
+  if (preferences.begin(BOND_NAMESPACE, false)) {
+    if (BLEDevice::getInitialized()) {
+      removeRecordedBonds(preferences);
+    }
+    preferences.clear();
+    preferences.end();
+  }
+
+  peerBonded = false;
+}
+
+#else
+
+void liveBondBegin() {}
+void liveBondPreferencesChanged() {}
+void liveBondDisconnected() {}
+void liveBondService() {}
+
+void esp32_live_bonding_enable() {}
+void esp32_live_bonding_clear() {}
+
+#endif
@@ -0,0 +1,99 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Boot timing. Records when esp32_live_begin() was called and returned,
+// when advertising started and when the first snapshot was stored, all as
+// time since boot. The values are sent once as a boot event to the first
+// client subscribed to events.
+//
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+#include <esp_timer.h>
+
+/* --------------------------------------------------------------------------
+   Timestamps
+   -------------------------------------------------------------------------- */
+
+// Each value is written once, by a single task, and read as a whole word.
+static volatile uint32_t beginUs = 0;
+static volatile uint32_t beginReturnUs = 0;
+static volatile uint32_t advertisingUs = 0;
+static volatile uint32_t firstSampleUs = 0;
+static volatile bool beginAsync = false;
+static bool bootReported = false;
+
+// Time since boot, never 0 so 0 can mean "not yet".
+static uint32_t sinceBootUs() {
+  const int64_t nowUs = esp_timer_get_time();
+  return nowUs > 0 ? static_cast<uint32_t>(nowUs) : 1;
+}
+
+/* --------------------------------------------------------------------------
+   Library hooks
+   -------------------------------------------------------------------------- */
+
+void liveBootBegin(bool async) {
+  if (beginUs == 0) {
+    beginUs = sinceBootUs();
+    beginAsync = async;
+  }
+}
+
+void liveBootReturned() {
+  if (beginReturnUs == 0) {
+    beginReturnUs = sinceBootUs();
+  }
+}
+
+void liveBootAdvertising() {
+  if (advertisingUs == 0) {
+    advertisingUs = sinceBootUs();
+  }
+}
+
+void liveBootSampleStored() {
+  if (firstSampleUs == 0) {
+    firstSampleUs = sinceBootUs();
+  }
+}
+
+void liveBootService() {
+  if (bootReported || advertisingUs == 0) {
+    return;
+  }
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument document;
+#else
+  StaticJsonDocument<256> document;
+#endif
+
+  LiveBootMetrics metrics;
+  esp32_live_boot_metrics(metrics);
+
+  JsonObject object = document.to<JsonObject>();
+  object["ver"] = ESP32_LIVE_VERSION;
+  object["event"] = "boot";
+  object["begin_us"] = metrics.beginUs;
+  object["begin_return_us"] = metrics.beginReturnUs;
+  object["advertising_us"] = metrics.advertisingUs;
+  object["first_sample_us"] = metrics.firstSampleUs;
+  object["async"] = metrics.async;
+
+  bootReported = liveSendEvent(object);
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+void esp32_live_boot_metrics(LiveBootMetrics& metrics) {
+  metrics.beginUs = beginUs;
+  metrics.beginReturnUs = beginReturnUs;
+  metrics.advertisingUs = advertisingUs;
+  metrics.firstSampleUs = firstSampleUs;
+  metrics.async = beginAsync;
+}
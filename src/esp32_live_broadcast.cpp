@@ -0,0 +1,669 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Connectionless broadcast. The newest captured values are placed in
+// manufacturer-specific advertising data, a few probes at a time, so any
+// number of scanners can follow a board without connecting. The service
+// UUID and name move to the scan response, where phones still find them.
+//
+// On chips with Bluetooth 5 (ESP32-S3, C3, C6, H2), a periodic advertising
+// train can carry whole compact snapshots instead. Listeners synchronize to
+// it once and then receive every update without scanning or connecting.
+//
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+#include "esp32_live_compact.h"
+
+#include <esp_timer.h>
+
+#if defined(CONFIG_BT_BLE_50_FEATURES_SUPPORTED)
+#include <esp_gap_ble_api.h>
+#endif
+
+/* --------------------------------------------------------------------------
+   State
+   -------------------------------------------------------------------------- */
+
+// Flags AD structure: LE General Discoverable, BR/EDR not supported.
+static const uint8_t BROADCAST_ADV_FLAGS = 0x06;
+
+// Longest name that fits in the scan response next to a 128-bit UUID.
+static const size_t BROADCAST_NAME_LENGTH = 11;
+
+static bool broadcastEnabled = false;
+static uint32_t broadcastUpdateMs = 1000;
+static BLEAdvertising* broadcastAdvertising = nullptr;
+
+// Probes placed in the rotation by esp32_live_broadcast_probe(). Empty means
+// every captured probe.
+static uint8_t broadcastNums[ESP32_LIVE_BROADCAST_MAX_PROBES];
+static size_t broadcastNumCount = 0;
+
+static size_t broadcastCursor = 0;
+static int64_t lastBroadcastUs = 0;
+
+// Only used by the background task, and kept off its stack.
+static LiveCompactProbe frameProbes[LIVE_COMPACT_MAX_PROBES];
+
+// Manufacturer data of a broadcast record: the company identifier, then the
+// record. Returns the number of bytes written.
+static size_t manufacturerData(
+    uint8_t* target,
+    const uint8_t* payload,
+    size_t length) {
+
+  target[0] = static_cast<uint8_t>(ESP32_LIVE_BROADCAST_COMPANY_ID & 0xff);
+  target[1] = static_cast<uint8_t>(ESP32_LIVE_BROADCAST_COMPANY_ID >> 8);
+  memcpy(target + 2, payload, length);
+  return 2 + length;
+}
+
+// Picks the next probes of the rotation from the copied frame. Returns the
+// number of probes placed at the start of selected.
+static size_t nextSubset(
+    size_t frameCount,
+    LiveCompactProbe* selected) {
+
+  const size_t rotation =
+      broadcastNumCount != 0 ? broadcastNumCount : frameCount;
+  size_t count = 0;
+
+  for (size_t step = 0;
+       step < rotation && count < LIVE_BROADCAST_MAX_PROBES;
+       ++step) {
+    const size_t position = (broadcastCursor + step) % rotation;
+    size_t index = position;
+
+    if (broadcastNumCount != 0) {
+      const int found = liveFindProbeIndex(broadcastNums[position]);
+      if (found < 0 || static_cast<size_t>(found) >= frameCount) {
+        continue;
+      }
+      index = static_cast<size_t>(found);
+    }
+
+    selected[count++] = frameProbes[index];
+  }
+
+  broadcastCursor = (broadcastCursor + LIVE_BROADCAST_MAX_PROBES) % rotation;
+  return count;
+}
+
+/* --------------------------------------------------------------------------
+   Extended advertising
+   -------------------------------------------------------------------------- */
+
+static bool periodicEnabled = false;
+static uint32_t periodicUpdateMs = 1000;
+
+#if defined(CONFIG_BT_BLE_50_FEATURES_SUPPORTED)
+
+// Length of the manufacturer data AD structure is one byte, so one
+// structure carries at most 254 bytes: the company identifier and a compact
+// snapshot of up to 39 probes.
+static const size_t PERIODIC_PAYLOAD_SIZE = 250;
+
+// A controller that has seen one extended advertising command rejects
+// legacy ones, so with the periodic train the connectable advertisement is
+// an extended set too. It keeps legacy PDUs, so every phone still sees it.
+static bool extendedAdvertising = false;
+
+// Setup runs one command at a time: each step is issued when the completion
+// event of the previous one reports success.
+enum ExtendedStep : uint8_t {
+  EXT_STEP_CONNECTABLE_PARAMS,
+  EXT_STEP_CONNECTABLE_DATA,
+  EXT_STEP_CONNECTABLE_SCAN_RESPONSE,
+  EXT_STEP_PERIODIC_SET_PARAMS,
+  EXT_STEP_PERIODIC_SET_DATA,
+  EXT_STEP_PERIODIC_PARAMS,
+  EXT_STEP_START,
+  EXT_STEP_PERIODIC_START,
+  EXT_STEP_DONE,
+  EXT_STEP_FAILED
+};
+
+static volatile uint8_t extendedStep = EXT_STEP_FAILED;
+
+static volatile bool periodicStarted = false;
+static volatile bool periodicUpdateBusy = false;
+static volatile bool connectableUpdateBusy = false;
+static int64_t lastPeriodicUs = 0;
+
+// AD structures of both sets, built by beginExtended().
+static uint8_t connectableData[31];
+static size_t connectableDataLength = 0;
+static uint8_t connectableScanResponse[31];
+static size_t connectableScanResponseLength = 0;
+static uint8_t periodicSetData[3 + 18];
+
+static uint16_t periodicInterval() {
+  // Units of 1.25 ms, between 7.5 ms and the 16-bit maximum.
+  uint32_t interval = periodicUpdateMs * 4 / 5;
+  if (interval < 6) {
+    interval = 6;
+  }
+  if (interval > 0xffff) {
+    interval = 0xffff;
+  }
+  return static_cast<uint16_t>(interval);
+}
+
+// 128-bit UUIDs are sent least significant byte first.
+static size_t addServiceUuid(uint8_t* target, const char* serviceUuid) {
+  BLEUUID uuid(serviceUuid);
+  target[0] = 17;
+  target[1] = 0x07;
+  memcpy(target + 2, uuid.getNative()->uuid.uuid128, 16);
+  return 18;
+}
+
+static size_t addName(uint8_t* target, const char* deviceName, size_t room) {
+  size_t length = strlen(deviceName);
+  uint8_t type = 0x09;
+
+  if (length + 2 > room) {
+    length = room - 2;
+    type = 0x08;
+  }
+
+  target[0] = static_cast<uint8_t>(length + 1);
+  target[1] = type;
+  memcpy(target + 2, deviceName, length);
+  return length + 2;
+}
+
+static size_t addFlags(uint8_t* target) {
+  target[0] = 2;
+  target[1] = 0x01;
+  target[2] = BROADCAST_ADV_FLAGS;
+  return 3;
+}
+
+static size_t addManufacturerData(
+    uint8_t* target,
+    const uint8_t* data,
+    size_t length) {
+
+  target[0] = static_cast<uint8_t>(length + 1);
+  target[1] = 0xff;
+  memcpy(target + 2, data, length);
+  return length + 2;
+}
+
+static esp_ble_gap_ext_adv_params_t setParams(bool connectable, uint8_t sid) {
+  esp_ble_gap_ext_adv_params_t params = {};
+  params.type = connectable
+                    ? ESP_BLE_GAP_SET_EXT_ADV_PROP_LEGACY_IND
+                    : ESP_BLE_GAP_SET_EXT_ADV_PROP_NONCONN_NONSCANNABLE_UNDIRECTED;
+  params.interval_min = connectable ? 0x0020 : 0x00a0;
+  params.interval_max = connectable ? 0x0040 : 0x00f0;
+  params.channel_map = ADV_CHNL_ALL;
+  params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+  params.peer_addr_type = BLE_ADDR_TYPE_PUBLIC;
+  params.filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+  params.tx_power = EXT_ADV_TX_PWR_NO_PREFERENCE;
+  params.primary_phy = ESP_BLE_GAP_PRI_PHY_1M;
+  params.max_skip = 0;
+  params.secondary_phy = ESP_BLE_GAP_PHY_1M;
+  params.sid = sid;
+  params.scan_req_notif = false;
+  return params;
+}
+
+static esp_err_t issueStep(uint8_t step) {
+  switch (step) {
+    case EXT_STEP_CONNECTABLE_PARAMS: {
+      const esp_ble_gap_ext_adv_params_t params =
+          setParams(true, ESP32_LIVE_ADVERTISING_INSTANCE);
+      return esp_ble_gap_ext_adv_set_params(
+          ESP32_LIVE_ADVERTISING_INSTANCE, &params);
+    }
+
+    case EXT_STEP_CONNECTABLE_DATA:
+      return esp_ble_gap_config_ext_adv_data_raw(
+          ESP32_LIVE_ADVERTISING_INSTANCE,
+          connectableDataLength,
+          connectableData);
+
+    case EXT_STEP_CONNECTABLE_SCAN_RESPONSE:
+      return esp_ble_gap_config_ext_scan_rsp_data_raw(
+          ESP32_LIVE_ADVERTISING_INSTANCE,
+          connectableScanResponseLength,
+          connectableScanResponse);
+
+    case EXT_STEP_PERIODIC_SET_PARAMS: {
+      const esp_ble_gap_ext_adv_params_t params =
+          setParams(false, ESP32_LIVE_PERIODIC_INSTANCE);
+      return esp_ble_gap_ext_adv_set_params(
+          ESP32_LIVE_PERIODIC_INSTANCE, &params);
+    }
+
+    // The train's own set only names the service, so scanners can tell
+    // ESP32 Live trains from others before synchronizing.
+    case EXT_STEP_PERIODIC_SET_DATA:
+      return esp_ble_gap_config_ext_adv_data_raw(
+          ESP32_LIVE_PERIODIC_INSTANCE,
+          sizeof(periodicSetData),
+          periodicSetData);
+
+    case EXT_STEP_PERIODIC_PARAMS: {
+      esp_ble_gap_periodic_adv_params_t params = {};
+      params.interval_min = periodicInterval();
+      params.interval_max = periodicInterval();
+      params.properties = 0;
+      return esp_ble_gap_periodic_adv_set_params(
+          ESP32_LIVE_PERIODIC_INSTANCE, &params);
+    }
+
+    case EXT_STEP_START: {
+      esp_ble_gap_ext_adv_t sets[2] = {};
+      sets[0].instance = ESP32_LIVE_ADVERTISING_INSTANCE;
+      sets[1].instance = ESP32_LIVE_PERIODIC_INSTANCE;
+      return esp_ble_gap_ext_adv_start(2, sets);
+    }
+
+    case EXT_STEP_PERIODIC_START:
+#if defined(CONFIG_BT_BLE_FEAT_PERIODIC_ADV_ENH)
+      return esp_ble_gap_periodic_adv_start(
+          ESP32_LIVE_PERIODIC_INSTANCE, false);
+#else
+      return esp_ble_gap_periodic_adv_start(ESP32_LIVE_PERIODIC_INSTANCE);
+#endif
+
+    default:
+      return ESP_FAIL;
+  }
+}
+
+static void runStep(uint8_t step) {
+  extendedStep = step;
+
+  if (step == EXT_STEP_DONE) {
+    periodicStarted = true;
+    return;
+  }
+
+  const esp_err_t result = issueStep(step);
+  if (result != ESP_OK) {
+    log_e("extended advertising step %u not queued: %d", step, result);
+    extendedStep = EXT_STEP_FAILED;
+  }
+}
+
+// Step whose completion event is event, or EXT_STEP_FAILED when the event
+// does not belong to the setup.
+static uint8_t completedStep(
+    esp_gap_ble_cb_event_t event,
+    const esp_ble_gap_cb_param_t* param,
+    int& status) {
+
+  switch (event) {
+    case ESP_GAP_BLE_EXT_ADV_SET_PARAMS_COMPLETE_EVT:
+      status = param->ext_adv_set_params.status;
+      return param->ext_adv_set_params.instance ==
+                     ESP32_LIVE_ADVERTISING_INSTANCE
+                 ? EXT_STEP_CONNECTABLE_PARAMS
+                 : EXT_STEP_PERIODIC_SET_PARAMS;
+
+    case ESP_GAP_BLE_EXT_ADV_DATA_SET_COMPLETE_EVT:
+      status = param->ext_adv_data_set.status;
+      return param->ext_adv_data_set.instance ==
+                     ESP32_LIVE_ADVERTISING_INSTANCE
+                 ? EXT_STEP_CONNECTABLE_DATA
+                 : EXT_STEP_PERIODIC_SET_DATA;
+
+    case ESP_GAP_BLE_EXT_SCAN_RSP_DATA_SET_COMPLETE_EVT:
+      status = param->scan_rsp_set.status;
+      return EXT_STEP_CONNECTABLE_SCAN_RESPONSE;
+
+    case ESP_GAP_BLE_PERIODIC_ADV_SET_PARAMS_COMPLETE_EVT:
+      status = param->peroid_adv_set_params.status;
+      return EXT_STEP_PERIODIC_PARAMS;
+
+    case ESP_GAP_BLE_EXT_ADV_START_COMPLETE_EVT:
+      status = param->ext_adv_start.status;
+      return EXT_STEP_START;
+
+    case ESP_GAP_BLE_PERIODIC_ADV_START_COMPLETE_EVT:
+      status = param->period_adv_start.status;
+      return EXT_STEP_PERIODIC_START;
+
+    default:
+      return EXT_STEP_FAILED;
+  }
+}
+
+static void beginExtended(const char* serviceUuid, const char* deviceName) {
+  extendedAdvertising = true;
+
+  // With the broadcast, the values take the advertising data and the
+  // service moves to the scan response, as with legacy advertising.
+  size_t length = addFlags(connectableData);
+  if (broadcastEnabled) {
+    // Until the first frame is captured, the record carries no probes.
+    uint8_t payload[LIVE_BROADCAST_MAX_SIZE];
+    uint8_t data[2 + LIVE_BROADCAST_MAX_SIZE];
+    const size_t dataLength = manufacturerData(
+        data,
+        payload,
+        liveBroadcastEncode(payload, sizeof(payload), 0, nullptr, 0));
+
+    length += addManufacturerData(connectableData + length, data, dataLength);
+    connectableDataLength = length;
+    connectableScanResponseLength =
+        addServiceUuid(connectableScanResponse, serviceUuid);
+    connectableScanResponseLength += addName(
+        connectableScanResponse + connectableScanResponseLength,
+        deviceName,
+        2 + BROADCAST_NAME_LENGTH);
+  } else {
+    length += addServiceUuid(connectableData + length, serviceUuid);
+    connectableDataLength = length;
+    connectableScanResponseLength = addName(
+        connectableScanResponse, deviceName, sizeof(connectableScanResponse));
+  }
+
+  addFlags(periodicSetData);
+  addServiceUuid(periodicSetData + 3, serviceUuid);
+
+  runStep(EXT_STEP_CONNECTABLE_PARAMS);
+}
+
+// Called after the setup and after every disconnect: a connection ends the
+// connectable set, the periodic train keeps running.
+static void restartConnectable() {
+  if (extendedStep != EXT_STEP_DONE) {
+    return;
+  }
+
+  esp_ble_gap_ext_adv_t set = {};
+  set.instance = ESP32_LIVE_ADVERTISING_INSTANCE;
+
+  const esp_err_t result = esp_ble_gap_ext_adv_start(1, &set);
+  if (result != ESP_OK) {
+    log_e("connectable advertising not restarted: %d", result);
+  }
+}
+
+// The broadcast record replaces the manufacturer data of the connectable
+// set; updates never queue up behind a slow controller.
+static void publishExtended(const uint8_t* data, size_t length) {
+  if (extendedStep != EXT_STEP_DONE || connectableUpdateBusy) {
+    return;
+  }
+
+  connectableDataLength = addFlags(connectableData);
+  connectableDataLength +=
+      addManufacturerData(connectableData + connectableDataLength, data, length);
+
+  connectableUpdateBusy = true;
+  if (esp_ble_gap_config_ext_adv_data_raw(
+          ESP32_LIVE_ADVERTISING_INSTANCE,
+          connectableDataLength,
+          connectableData) != ESP_OK) {
+    connectableUpdateBusy = false;
+  }
+}
+
+static void publishPeriodic() {
+  static uint8_t data[2 + 2 + PERIODIC_PAYLOAD_SIZE];
+  static LiveCompactProbe probes[LIVE_COMPACT_MAX_PROBES];
+
+  uint32_t sampleId = 0;
+  uint64_t timestampMs = 0;
+  size_t count = 0;
+
+  if (!liveCopyLatestFrame(sampleId, timestampMs, probes, count)) {
+    return;
+  }
+
+  const size_t length = liveCompactEncode(
+      data + 4,
+      PERIODIC_PAYLOAD_SIZE,
+      sampleId,
+      timestampMs,
+      probes,
+      count);
+
+  if (length == 0) {
+    return;
+  }
+
+  data[0] = static_cast<uint8_t>(length + 3);
+  data[1] = 0xff;
+  data[2] = static_cast<uint8_t>(ESP32_LIVE_BROADCAST_COMPANY_ID & 0xff);
+  data[3] = static_cast<uint8_t>(ESP32_LIVE_BROADCAST_COMPANY_ID >> 8);
+
+  // Cleared by ESP_GAP_BLE_PERIODIC_ADV_DATA_SET_COMPLETE_EVT, so updates
+  // never queue up behind a slow controller.
+  periodicUpdateBusy = true;
+
+#if defined(CONFIG_BT_BLE_FEAT_PERIODIC_ADV_ENH)
+  const esp_err_t result = esp_ble_gap_config_periodic_adv_data_raw(
+      ESP32_LIVE_PERIODIC_INSTANCE, 4 + length, data, false);
+#else
+  const esp_err_t result = esp_ble_gap_config_periodic_adv_data_raw(
+      ESP32_LIVE_PERIODIC_INSTANCE, 4 + length, data);
+#endif
+
+  if (result != ESP_OK) {
+    periodicUpdateBusy = false;
+  }
+}
+
+void liveBroadcastGapEvent(
+    esp_gap_ble_cb_event_t event,
+    esp_ble_gap_cb_param_t* param) {
+
+  if (event == ESP_GAP_BLE_PERIODIC_ADV_DATA_SET_COMPLETE_EVT) {
+    periodicUpdateBusy = false;
+    return;
+  }
+
+  if (event == ESP_GAP_BLE_EXT_ADV_DATA_SET_COMPLETE_EVT &&
+      extendedStep == EXT_STEP_DONE) {
+    connectableUpdateBusy = false;
+    return;
+  }
+
+  if (event == ESP_GAP_BLE_EXT_ADV_START_COMPLETE_EVT &&
+      extendedStep == EXT_STEP_DONE) {
+    if (param->ext_adv_start.status != ESP_BT_STATUS_SUCCESS) {
+      log_e("connectable advertising not restarted: status %d",
+            param->ext_adv_start.status);
+    }
+    return;
+  }
+
+  int status = ESP_BT_STATUS_SUCCESS;
+  const uint8_t step = completedStep(event, param, status);
+  if (step == EXT_STEP_FAILED || step != extendedStep) {
+    return;
+  }
+
+  if (status != ESP_BT_STATUS_SUCCESS) {
+    log_e("extended advertising step %u failed: status %d", step, status);
+    extendedStep = EXT_STEP_FAILED;
+    return;
+  }
+
+  runStep(static_cast<uint8_t>(step + 1));
+}
+
+static void periodicService() {
+  if (!periodicStarted || periodicUpdateBusy) {
+    return;
+  }
+
+  const int64_t nowUs = esp_timer_get_time();
+  if (nowUs - lastPeriodicUs <
+      static_cast<int64_t>(periodicUpdateMs) * 1000LL) {
+    return;
+  }
+  lastPeriodicUs = nowUs;
+
+  publishPeriodic();
+}
+
+#else
+
+static bool extendedAdvertising = false;
+
+static void beginExtended(const char*, const char*) {}
+static void restartConnectable() {}
+static void publishExtended(const uint8_t*, size_t) {}
+static void periodicService() {}
+
+#endif
+
+/* --------------------------------------------------------------------------
+   Library hooks
+   -------------------------------------------------------------------------- */
+
+static void publish(const uint8_t* payload, size_t length) {
+  uint8_t data[2 + LIVE_BROADCAST_MAX_SIZE];
+  const size_t dataLength = manufacturerData(data, payload, length);
+
+  if (extendedAdvertising) {
+    publishExtended(data, dataLength);
+    return;
+  }
+
+  BLEAdvertisementData advertisement;
+  advertisement.setFlags(BROADCAST_ADV_FLAGS);
+  advertisement.setManufacturerData(
+      String(reinterpret_cast<const char*>(data), dataLength));
+
+  broadcastAdvertising->setAdvertisementData(advertisement);
+}
+
+
+void liveBroadcastBegin(
+    BLEAdvertising* advertising,
+    const char* serviceUuid,
+    const char* deviceName) {
+
+  broadcastAdvertising = advertising;
+
+  // The legacy BLEAdvertising object issues its commands as soon as its
+  // data is set, so it is left alone once the sets are extended.
+  if (periodicEnabled) {
+    beginExtended(serviceUuid, deviceName);
+    return;
+  }
+
+  if (!broadcastEnabled) {
+    return;
+  }
+
+  BLEAdvertisementData scanResponse;
+  scanResponse.setCompleteServices(BLEUUID(serviceUuid));
+
+  const String name(deviceName);
+  if (name.length() > BROADCAST_NAME_LENGTH) {
+    scanResponse.setShortName(name.substring(0, BROADCAST_NAME_LENGTH));
+  } else {
+    scanResponse.setName(name);
+  }
+
+  advertising->setScanResponseData(scanResponse);
+
+  // Until the first frame is captured, the record carries no probes.
+  uint8_t payload[LIVE_BROADCAST_MAX_SIZE];
+  const size_t length =
+      liveBroadcastEncode(payload, sizeof(payload), 0, nullptr, 0);
+  publish(payload, length);
+}
+
+void liveBroadcastAdvertise() {
+  if (extendedAdvertising) {
+    restartConnectable();
+    return;
+  }
+
+  BLEDevice::startAdvertising();
+}
+
+bool liveBroadcastEnabled() {
+  return broadcastEnabled || periodicEnabled;
+}
+
+// Legacy advertising stops while a client is connected, so its payload is
+// only refreshed while the board is discoverable. The periodic train keeps
+// running during connections.
+void liveBroadcastService() {
+  periodicService();
+
+  if (!broadcastEnabled ||
+      broadcastAdvertising == nullptr ||
+      esp32_live_is_connected()) {
+    return;
+  }
+
+  const int64_t nowUs = esp_timer_get_time();
+  if (nowUs - lastBroadcastUs <
+      static_cast<int64_t>(broadcastUpdateMs) * 1000LL) {
+    return;
+  }
+
+  uint32_t sampleId = 0;
+  uint64_t timestampMs = 0;
+  size_t count = 0;
+
+  if (!liveCopyLatestFrame(sampleId, timestampMs, frameProbes, count) ||
+      count == 0) {
+    return;
+  }
+  lastBroadcastUs = nowUs;
+
+  LiveCompactProbe selected[LIVE_BROADCAST_MAX_PROBES];
+  const size_t selectedCount = nextSubset(count, selected);
+
+  uint8_t payload[LIVE_BROADCAST_MAX_SIZE];
+  const size_t length = liveBroadcastEncode(
+      payload, sizeof(payload), sampleId, selected, selectedCount);
+  publish(payload, length);
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+void esp32_live_broadcast_enable(uint32_t updateMs) {
+  broadcastEnabled = true;
+  broadcastUpdateMs = updateMs < ESP32_LIVE_RATE_MIN
+                          ? ESP32_LIVE_RATE_MIN
+                          : updateMs;
+}
+
+bool esp32_live_broadcast_probe(uint16_t n) {
+  if (n > 255 || broadcastNumCount >= ESP32_LIVE_BROADCAST_MAX_PROBES) {
+    return false;
+  }
+
+  for (size_t i = 0; i < broadcastNumCount; ++i) {
+    if (broadcastNums[i] == n) {
+      return true;
+    }
+  }
+
+  broadcastNums[broadcastNumCount++] = static_cast<uint8_t>(n);
+  return true;
+}
+
+bool esp32_live_periodic_enable(uint32_t updateMs) {
+#if defined(CONFIG_BT_BLE_50_FEATURES_SUPPORTED)
+  periodicEnabled = true;
+  periodicUpdateMs = updateMs < ESP32_LIVE_RATE_MIN
+                         ? ESP32_LIVE_RATE_MIN
+                         : updateMs;
+  return true;
+#else
+  (void)updateMs;
+  (void)periodicUpdateMs;
+  return false;
+#endif
+}
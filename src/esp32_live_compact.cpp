@@ -0,0 +1,86 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_compact.h"
+
+static uint8_t* putLittleEndian(uint8_t* out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+  return out + bytes;
+}
+
+size_t liveCompactEncode(
+    uint8_t* out,
+    size_t capacity,
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const LiveCompactProbe* probes,
+    size_t count) {
+
+  if (capacity < LIVE_COMPACT_HEADER_SIZE) {
+    return 0;
+  }
+
+  const size_t room =
+      (capacity - LIVE_COMPACT_HEADER_SIZE) / LIVE_COMPACT_PROBE_SIZE;
+  const size_t encoded = count < room ? count : room;
+
+  uint8_t* cursor = out;
+  cursor = putLittleEndian(cursor, LIVE_COMPACT_FORMAT, 1);
+  cursor = putLittleEndian(
+      cursor, encoded < count ? LIVE_COMPACT_TRUNCATED : 0, 1);
+  cursor = putLittleEndian(cursor, encoded, 2);
+  cursor = putLittleEndian(cursor, sampleId, 4);
+  cursor = putLittleEndian(cursor, timestampMs, 8);
+
+  for (size_t i = 0; i < encoded; ++i) {
+    cursor = putLittleEndian(cursor, probes[i].num, 1);
+    cursor = putLittleEndian(cursor, probes[i].type, 1);
+    cursor = putLittleEndian(cursor, probes[i].bits, 4);
+  }
+
+  return static_cast<size_t>(cursor - out);
+}
+
+size_t liveBroadcastEncode(
+    uint8_t* out,
+    size_t capacity,
+    uint32_t sampleId,
+    const LiveCompactProbe* probes,
+    size_t count) {
+
+  if (capacity < LIVE_BROADCAST_HEADER_SIZE) {
+    return 0;
+  }
+
+  size_t encoded =
+      (capacity - LIVE_BROADCAST_HEADER_SIZE) / LIVE_BROADCAST_PROBE_SIZE;
+  if (encoded > count) {
+    encoded = count;
+  }
+  if (encoded > 8) {
+    encoded = 8;
+  }
+
+  uint8_t types = 0;
+  for (size_t i = 0; i < encoded; ++i) {
+    if (probes[i].type == LIVE_COMPACT_INT32) {
+      types = static_cast<uint8_t>(types | (1u << i));
+    }
+  }
+
+  uint8_t* cursor = out;
+  cursor = putLittleEndian(cursor, LIVE_BROADCAST_FORMAT, 1);
+  cursor = putLittleEndian(cursor, types, 1);
+  cursor = putLittleEndian(cursor, sampleId, 4);
+
+  for (size_t i = 0; i < encoded; ++i) {
+    cursor = putLittleEndian(cursor, probes[i].num, 1);
+    cursor = putLittleEndian(cursor, probes[i].bits, 4);
+  }
+
+  return static_cast<size_t>(cursor - out);
+}
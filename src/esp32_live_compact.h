@@ -0,0 +1,90 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Compact binary snapshot encoding, served by the snapshot read
+// characteristic. All fields are little-endian:
+//
+//   offset  size  field
+//   0       1     format (LIVE_COMPACT_FORMAT)
+//   1       1     flags (LIVE_COMPACT_TRUNCATED)
+//   2       2     probe count in this record
+//   4       4     sample_id
+//   8       8     timestamp in milliseconds
+//   16      6*n   per probe: num (1), type (1), value (4)
+//
+// type is LIVE_COMPACT_FLOAT (IEEE-754 float) or LIVE_COMPACT_INT32.
+//
+// Broadcast records carry a few probes in manufacturer-specific advertising
+// data, after the 16-bit company identifier:
+//
+//   offset  size  field
+//   0       1     format (LIVE_BROADCAST_FORMAT)
+//   1       1     types: bit i set when probe i is LIVE_COMPACT_INT32
+//   2       4     sample_id
+//   6       5*n   per probe: num (1), value (4)
+//
+// The probe count follows from the record length.
+//
+// This file has no Arduino dependency.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+static const uint8_t LIVE_COMPACT_FORMAT = 1;
+static const uint8_t LIVE_COMPACT_TRUNCATED = 0x01;
+
+static const size_t LIVE_COMPACT_HEADER_SIZE = 16;
+static const size_t LIVE_COMPACT_PROBE_SIZE = 6;
+
+// Largest attribute value allowed by the ATT protocol.
+static const size_t LIVE_COMPACT_MAX_SIZE = 512;
+static const size_t LIVE_COMPACT_MAX_PROBES =
+    (LIVE_COMPACT_MAX_SIZE - LIVE_COMPACT_HEADER_SIZE) /
+    LIVE_COMPACT_PROBE_SIZE;
+
+enum LiveCompactType : uint8_t {
+  LIVE_COMPACT_FLOAT = 0,
+  LIVE_COMPACT_INT32 = 1
+};
+
+struct LiveCompactProbe {
+  uint8_t num;
+  uint8_t type;
+  uint32_t bits;
+};
+
+// Encodes as many probes as fit in capacity and sets LIVE_COMPACT_TRUNCATED
+// when some were left out. Returns the encoded length, or 0 when capacity
+// cannot hold the header.
+size_t liveCompactEncode(
+    uint8_t* out,
+    size_t capacity,
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const LiveCompactProbe* probes,
+    size_t count);
+
+static const uint8_t LIVE_BROADCAST_FORMAT = 1;
+
+static const size_t LIVE_BROADCAST_HEADER_SIZE = 6;
+static const size_t LIVE_BROADCAST_PROBE_SIZE = 5;
+
+// Legacy advertising data is 31 bytes: 3 for the flags, 2 for the
+// manufacturer data header and 2 for the company identifier.
+static const size_t LIVE_BROADCAST_MAX_SIZE = 24;
+static const size_t LIVE_BROADCAST_MAX_PROBES =
+    (LIVE_BROADCAST_MAX_SIZE - LIVE_BROADCAST_HEADER_SIZE) /
+    LIVE_BROADCAST_PROBE_SIZE;
+
+// Encodes as many probes as fit in capacity, at most 8. Returns the encoded
+// length, or 0 when capacity cannot hold the header.
+size_t liveBroadcastEncode(
+    uint8_t* out,
+    size_t capacity,
+    uint32_t sampleId,
+    const LiveCompactProbe* probes,
+    size_t count);
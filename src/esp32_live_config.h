@@ -0,0 +1,181 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Version and compile-time configuration. Every setting can be overridden
+// with a -D build flag or a #define before esp32_live.h is included.
+//
+// This file has no Arduino dependency.
+//
+
+#pragma once
+
+/* --------------------------------------------------------------------------
+   Version and configuration
+   -------------------------------------------------------------------------- */
+
+#define ESP32_LIVE_VERSION "1.7.2"
+
+// Include internal chip temperature in the JSON header when the selected
+// ESP32 target provides temperatureRead(). This is chip temperature, not
+// ambient room temperature.
+#ifndef ESP32_LIVE_INCLUDE_CHIP_TEMP
+#define ESP32_LIVE_INCLUDE_CHIP_TEMP 1
+#endif
+
+// Preferred JSON payload size for a BLE notification.
+// The companion app should request an MTU of 247 after connecting.
+#ifndef BLE_CHUNK_LIMIT
+#define BLE_CHUNK_LIMIT 240
+#endif
+
+#ifndef ESP32_LIVE_PREFERRED_MTU
+#define ESP32_LIVE_PREFERRED_MTU 247
+#endif
+
+// Attribute handles reserved for the ESP32 Live GATT service. The default
+// of 15 used by BLEServer::createService() leaves no room for additional
+// characteristics.
+#ifndef ESP32_LIVE_SERVICE_HANDLES
+#define ESP32_LIVE_SERVICE_HANDLES 32
+#endif
+
+
+#ifndef ESP32_LIVE_RATE_MIN
+#define ESP32_LIVE_RATE_MIN 20
+#endif
+
+#ifndef ESP32_LIVE_RATE_MAX
+#define ESP32_LIVE_RATE_MAX 60000
+#endif
+
+// Captured snapshots waiting for serialization. Frames are captured by the
+// background task or by esp32_live_sample_point() and transmitted in order.
+// Must be a power of two. Large depths are placed in PSRAM when the board
+// has it, so minutes of high-rate capture fit on boards with 2-8 MB.
+#ifndef ESP32_LIVE_CAPTURE_DEPTH
+#define ESP32_LIVE_CAPTURE_DEPTH 8
+#endif
+
+// Buffers of at least this many bytes go to PSRAM when available; smaller
+// ones and the ring indices stay in internal RAM.
+#ifndef ESP32_LIVE_PSRAM_MIN_BYTES
+#define ESP32_LIVE_PSRAM_MIN_BYTES 4096
+#endif
+
+// Alignment of PSRAM buffers and of capture frames inside them, so that one
+// frame never shares a cache line with its neighbours.
+#ifndef ESP32_LIVE_CACHE_LINE
+#define ESP32_LIVE_CACHE_LINE 32
+#endif
+
+// Stack of the background task.
+#ifndef ESP32_LIVE_TASK_STACK
+#define ESP32_LIVE_TASK_STACK 4096
+#endif
+
+// Stack of the one-shot task that starts Bluetooth for
+// esp32_live_begin_async().
+#ifndef ESP32_LIVE_INIT_STACK
+#define ESP32_LIVE_INIT_STACK 4096
+#endif
+
+// Dual-core chips serialize the chunks of large snapshots on two tasks: an
+// encoder task takes half of every batch of ESP32_LIVE_ENCODE_BATCH chunks
+// while the background task encodes the rest. Chunks are still sent in
+// order. Single-core chips encode and send one chunk at a time.
+#ifndef ESP32_LIVE_PARALLEL_ENCODE
+  #if defined(CONFIG_FREERTOS_UNICORE) && CONFIG_FREERTOS_UNICORE
+    #define ESP32_LIVE_PARALLEL_ENCODE 0
+  #else
+    #define ESP32_LIVE_PARALLEL_ENCODE 1
+  #endif
+#endif
+
+#ifndef ESP32_LIVE_ENCODE_BATCH
+#define ESP32_LIVE_ENCODE_BATCH 8
+#endif
+
+#ifndef ESP32_LIVE_ENCODE_STACK
+#define ESP32_LIVE_ENCODE_STACK 4096
+#endif
+
+// Deep-sleep sampling with the ULP coprocessor. The buffer lives in RTC slow
+// memory and is shared by all ULP probes; each record uses one word per
+// probe.
+#ifndef ESP32_LIVE_ULP_MAX_PROBES
+#define ESP32_LIVE_ULP_MAX_PROBES 8
+#endif
+
+#ifndef ESP32_LIVE_ULP_BUFFER_WORDS
+#define ESP32_LIVE_ULP_BUFFER_WORDS 512
+#endif
+
+// Pause between uploaded frames so batch uploads do not overrun the BLE
+// notification queue.
+#ifndef ESP32_LIVE_UPLOAD_PACING_MS
+#define ESP32_LIVE_UPLOAD_PACING_MS 8
+#endif
+
+// Crash black box: snapshots kept in RTC memory that survives panics,
+// watchdog and brownout resets. Each record stores the first
+// ESP32_LIVE_BLACKBOX_PROBES probes.
+#ifndef ESP32_LIVE_BLACKBOX_DEPTH
+#define ESP32_LIVE_BLACKBOX_DEPTH 16
+#endif
+
+#ifndef ESP32_LIVE_BLACKBOX_PROBES
+#define ESP32_LIVE_BLACKBOX_PROBES 16
+#endif
+
+// Write events queued between two runs of the background task. When the
+// queue is full, the watch on that variable pauses until it is drained.
+#ifndef ESP32_LIVE_WATCH_EVENTS
+#define ESP32_LIVE_WATCH_EVENTS 16
+#endif
+
+// Alarm rules and alarm transitions queued for transmission.
+#ifndef ESP32_LIVE_MAX_ALARMS
+#define ESP32_LIVE_MAX_ALARMS 8
+#endif
+
+#ifndef ESP32_LIVE_ALARM_EVENTS
+#define ESP32_LIVE_ALARM_EVENTS 8
+#endif
+
+// Period of the stats frame sent on the events characteristic while a
+// client is connected. 0 disables the frame; counters are still collected.
+#ifndef ESP32_LIVE_STATS_INTERVAL_MS
+#define ESP32_LIVE_STATS_INTERVAL_MS 5000
+#endif
+
+// History messages sent per background cycle while a query is running.
+#ifndef ESP32_LIVE_HISTORY_BURST
+#define ESP32_LIVE_HISTORY_BURST 8
+#endif
+
+// Connectionless broadcast: company identifier placed in the manufacturer
+// data (Espressif by default) and probes that can be put in the rotation.
+#ifndef ESP32_LIVE_BROADCAST_COMPANY_ID
+#define ESP32_LIVE_BROADCAST_COMPANY_ID 0x02E5
+#endif
+
+#ifndef ESP32_LIVE_BROADCAST_MAX_PROBES
+#define ESP32_LIVE_BROADCAST_MAX_PROBES 16
+#endif
+
+// Extended advertising sets used with the periodic advertising train: the
+// connectable advertisement and the train itself.
+#ifndef ESP32_LIVE_ADVERTISING_INSTANCE
+#define ESP32_LIVE_ADVERTISING_INSTANCE 0
+#endif
+
+#ifndef ESP32_LIVE_PERIODIC_INSTANCE
+#define ESP32_LIVE_PERIODIC_INSTANCE 1
+#endif
+
+// Read attempts for one probe group before the sampler keeps the previous
+// consistent values. Attempts after the first four yield for one tick.
+#ifndef ESP32_LIVE_GROUP_RETRIES
+#define ESP32_LIVE_GROUP_RETRIES 16
+#endif
@@ -0,0 +1,135 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_delta.h"
+
+#include <math.h>
+#include <string.h>
+
+static inline float asFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static inline uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Each lane yields 0 or 1; the bit and the reference update are formed
+// with masks instead of branches.
+static inline uint32_t floatLane(
+    uint32_t current,
+    uint32_t reference,
+    float deadband,
+    uint32_t& delta) {
+
+  const float a = asFloat(current);
+  const float b = asFloat(reference);
+  const float difference = a - b;
+
+  delta = floatBits(difference);
+
+  const uint32_t moved = fabsf(difference) > deadband;
+  const uint32_t nanChanged = isnan(a) != isnan(b);
+  return moved | nanChanged;
+}
+
+static inline uint32_t integerLane(
+    uint32_t current,
+    uint32_t reference,
+    float deadband,
+    uint32_t& delta) {
+
+  const int64_t difference =
+      static_cast<int64_t>(static_cast<int32_t>(current)) -
+      static_cast<int32_t>(reference);
+
+  delta = current - reference;
+
+  const int64_t magnitude = difference < 0 ? -difference : difference;
+  return static_cast<float>(magnitude) > deadband;
+}
+
+size_t liveDeltaScan(
+    const uint32_t* current,
+    uint32_t* reference,
+    const float* deadband,
+    const uint32_t* integerMask,
+    size_t count,
+    uint32_t* changed,
+    uint32_t* delta) {
+
+  size_t total = 0;
+
+  for (size_t word = 0; word * 32 < count; ++word) {
+    const size_t base = word * 32;
+    const size_t lanes = count - base < 32 ? count - base : 32;
+    const uint32_t laneMask = lanes == 32 ? UINT32_MAX : (1u << lanes) - 1;
+    const uint32_t integers = integerMask[word] & laneMask;
+
+    uint32_t bits = 0;
+    uint32_t deltas[32];
+
+    // Blocks of one type, the usual case, run without the type select.
+    if (integers == 0) {
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        bits |= floatLane(
+                    current[base + lane],
+                    reference[base + lane],
+                    deadband[base + lane],
+                    deltas[lane])
+                << lane;
+      }
+    } else if (integers == laneMask) {
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        bits |= integerLane(
+                    current[base + lane],
+                    reference[base + lane],
+                    deadband[base + lane],
+                    deltas[lane])
+                << lane;
+      }
+    } else {
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        uint32_t floatDelta;
+        uint32_t integerDelta;
+        const uint32_t asFloatLane = floatLane(
+            current[base + lane],
+            reference[base + lane],
+            deadband[base + lane],
+            floatDelta);
+        const uint32_t asIntegerLane = integerLane(
+            current[base + lane],
+            reference[base + lane],
+            deadband[base + lane],
+            integerDelta);
+
+        const uint32_t isInteger = (integers >> lane) & 1u;
+        const uint32_t select = 0u - isInteger;
+
+        deltas[lane] = (integerDelta & select) | (floatDelta & ~select);
+        bits |= ((asIntegerLane & select) | (asFloatLane & ~select)) << lane;
+      }
+    }
+
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      const uint32_t take = 0u - ((bits >> lane) & 1u);
+      reference[base + lane] =
+          (current[base + lane] & take) | (reference[base + lane] & ~take);
+    }
+
+    if (delta != nullptr) {
+      memcpy(delta + base, deltas, lanes * sizeof(uint32_t));
+    }
+
+    changed[word] = bits;
+    total += __builtin_popcount(bits);
+  }
+
+  return total;
+}
@@ -0,0 +1,44 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Change detection over a frame of probe values. One pass compares every
+// value with its reference, applies the probe's deadband, computes the
+// delta and moves the reference of changed probes, producing a bitmap with
+// one bit per probe.
+//
+// Values are 32-bit words, as in LiveValue: IEEE-754 floats, or int32 for
+// the probes whose bit is set in integerMask. Probes are processed 32 at a
+// time, one bitmap word per block, without branches on the values, so the
+// compiler can keep the loop in registers or vectorize it.
+//
+// This file has no Arduino dependency.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bitmap words needed for count probes.
+inline size_t liveDeltaWords(size_t count) {
+  return (count + 31) / 32;
+}
+
+// Bit i of changed is set when probe i moved by more than deadband[i] from
+// reference[i]; a deadband of 0 reports every change. A float that becomes
+// or stops being NaN always counts as a change. For changed probes,
+// reference[i] takes the current value and, when delta is not nullptr,
+// delta[i] receives current - reference in the probe's own type. Unchanged
+// probes keep their reference, so slow drift is reported once it adds up
+// to more than the deadband.
+//
+// Returns the number of changed probes.
+size_t liveDeltaScan(
+    const uint32_t* current,
+    uint32_t* reference,
+    const float* deadband,
+    const uint32_t* integerMask,
+    size_t count,
+    uint32_t* changed,
+    uint32_t* delta);
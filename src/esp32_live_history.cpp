@@ -0,0 +1,1012 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_history.h"
+
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+   Record layout
+   -------------------------------------------------------------------------- */
+
+// Level 0:   id (4), padding (4), timestamp (8), values (4 * probes)
+// Level 1+:  first id (4), last id (4), start (8), end (8), samples (4),
+//            padding (4), min, max and mean (3 * 4 * probes)
+static const size_t RAW_HEADER = 16;
+static const size_t SUMMARY_HEADER = 32;
+
+static size_t roundUp8(size_t value) {
+  return (value + 7) & ~static_cast<size_t>(7);
+}
+
+template <typename T>
+static T load(const uint8_t* source) {
+  T value;
+  memcpy(&value, source, sizeof(value));
+  return value;
+}
+
+template <typename T>
+static void store(uint8_t* target, T value) {
+  memcpy(target, &value, sizeof(value));
+}
+
+/* --------------------------------------------------------------------------
+   Setup
+   -------------------------------------------------------------------------- */
+
+bool LiveHistory::begin(
+    void* memory,
+    size_t bytes,
+    size_t probeCount,
+    size_t levels,
+    size_t factor) {
+
+  levelCount = 0;
+
+  if (memory == nullptr ||
+      probeCount == 0 ||
+      levels == 0 ||
+      levels > MAX_LEVELS ||
+      factor < 2) {
+    return false;
+  }
+
+  // Accumulators for levels 1 and up come first.
+  const size_t accumulatorBytes =
+      roundUp8((levels - 1) * 3 * probeCount * sizeof(float));
+
+  if (bytes <= accumulatorBytes) {
+    return false;
+  }
+
+  uint8_t* cursor = static_cast<uint8_t*>(memory);
+  float* accumulatorFloats = reinterpret_cast<float*>(cursor);
+  cursor += accumulatorBytes;
+
+  const size_t share = (bytes - accumulatorBytes) / levels;
+
+  for (size_t level = 0; level < levels; ++level) {
+    Level& data = levelData[level];
+
+    data.recordSize = roundUp8(
+        level == 0
+            ? RAW_HEADER + probeCount * sizeof(float)
+            : SUMMARY_HEADER + 3 * probeCount * sizeof(float));
+    data.capacity = share / data.recordSize;
+    data.base = cursor;
+    data.head = 0;
+    data.count = 0;
+
+    if (data.capacity < 2) {
+      return false;
+    }
+
+    cursor += data.capacity * data.recordSize;
+
+    Accumulator& accumulator = pending[level];
+    accumulator.samples = 0;
+    accumulator.children = 0;
+
+    if (level > 0) {
+      accumulator.min = accumulatorFloats;
+      accumulator.max = accumulator.min + probeCount;
+      accumulator.sum = accumulator.max + probeCount;
+      accumulatorFloats += 3 * probeCount;
+    } else {
+      accumulator.min = nullptr;
+      accumulator.max = nullptr;
+      accumulator.sum = nullptr;
+    }
+  }
+
+  probes = probeCount;
+  mergeFactor = factor;
+  levelCount = levels;
+  return true;
+}
+
+size_t LiveHistory::size(size_t level) const {
+  return level < levelCount ? levelData[level].count : 0;
+}
+
+size_t LiveHistory::capacity(size_t level) const {
+  return level < levelCount ? levelData[level].capacity : 0;
+}
+
+uint8_t* LiveHistory::slot(size_t level, size_t index) const {
+  const Level& data = levelData[level];
+  const size_t oldest =
+      (data.head + data.capacity - data.count) % data.capacity;
+
+  return data.base + ((oldest + index) % data.capacity) * data.recordSize;
+}
+
+/* --------------------------------------------------------------------------
+   Appending and downsampling
+   -------------------------------------------------------------------------- */
+
+void LiveHistory::append(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const float* values) {
+
+  if (levelCount == 0) {
+    return;
+  }
+
+  LiveHistoryRecord record;
+  record.firstId = sampleId;
+  record.lastId = sampleId;
+  record.startMs = timestampMs;
+  record.endMs = timestampMs;
+  record.samples = 1;
+  record.min = values;
+  record.max = values;
+  record.mean = values;
+
+  push(0, record);
+}
+
+void LiveHistory::push(size_t level, const LiveHistoryRecord& record) {
+  Level& data = levelData[level];
+  uint8_t* target = data.base + data.head * data.recordSize;
+  const size_t floatBytes = probes * sizeof(float);
+
+  if (level == 0) {
+    store<uint32_t>(target, record.firstId);
+    store<uint64_t>(target + 8, record.startMs);
+    memcpy(target + RAW_HEADER, record.mean, floatBytes);
+  } else {
+    store<uint32_t>(target, record.firstId);
+    store<uint32_t>(target + 4, record.lastId);
+    store<uint64_t>(target + 8, record.startMs);
+    store<uint64_t>(target + 16, record.endMs);
+    store<uint32_t>(target + 24, record.samples);
+    memcpy(target + SUMMARY_HEADER, record.min, floatBytes);
+    memcpy(target + SUMMARY_HEADER + floatBytes, record.max, floatBytes);
+    memcpy(target + SUMMARY_HEADER + 2 * floatBytes, record.mean, floatBytes);
+  }
+
+  data.head = (data.head + 1) % data.capacity;
+  if (data.count < data.capacity) {
+    ++data.count;
+  }
+
+  if (level + 1 < levelCount) {
+    accumulate(level + 1, record);
+  }
+}
+
+void LiveHistory::accumulate(size_t level, const LiveHistoryRecord& record) {
+  Accumulator& accumulator = pending[level];
+
+  if (accumulator.children == 0) {
+    accumulator.firstId = record.firstId;
+    accumulator.startMs = record.startMs;
+    accumulator.samples = 0;
+
+    for (size_t i = 0; i < probes; ++i) {
+      accumulator.min[i] = record.min[i];
+      accumulator.max[i] = record.max[i];
+      accumulator.sum[i] = 0.0f;
+    }
+  }
+
+  for (size_t i = 0; i < probes; ++i) {
+    if (record.min[i] < accumulator.min[i]) {
+      accumulator.min[i] = record.min[i];
+    }
+    if (record.max[i] > accumulator.max[i]) {
+      accumulator.max[i] = record.max[i];
+    }
+    accumulator.sum[i] += record.mean[i] * static_cast<float>(record.samples);
+  }
+
+  accumulator.lastId = record.lastId;
+  accumulator.endMs = record.endMs;
+  accumulator.samples += record.samples;
+  ++accumulator.children;
+
+  if (accumulator.children < mergeFactor) {
+    return;
+  }
+
+  // The sums are turned into means in place; the accumulator is reset on
+  // the next child anyway.
+  const float divisor = static_cast<float>(accumulator.samples);
+  for (size_t i = 0; i < probes; ++i) {
+    accumulator.sum[i] /= divisor;
+  }
+
+  LiveHistoryRecord summary;
+  summary.firstId = accumulator.firstId;
+  summary.lastId = accumulator.lastId;
+  summary.startMs = accumulator.startMs;
+  summary.endMs = accumulator.endMs;
+  summary.samples = accumulator.samples;
+  summary.min = accumulator.min;
+  summary.max = accumulator.max;
+  summary.mean = accumulator.sum;
+
+  accumulator.children = 0;
+  push(level, summary);
+}
+
+/* --------------------------------------------------------------------------
+   Lookup
+   -------------------------------------------------------------------------- */
+
+bool LiveHistory::record(
+    size_t level,
+    size_t index,
+    LiveHistoryRecord& out) const {
+
+  if (level >= levelCount || index >= levelData[level].count) {
+    return false;
+  }
+
+  const uint8_t* source = slot(level, index);
+  const size_t floatBytes = probes * sizeof(float);
+
+  if (level == 0) {
+    const float* values = reinterpret_cast<const float*>(source + RAW_HEADER);
+
+    out.firstId = load<uint32_t>(source);
+    out.lastId = out.firstId;
+    out.startMs = load<uint64_t>(source + 8);
+    out.endMs = out.startMs;
+    out.samples = 1;
+    out.min = values;
+    out.max = values;
+    out.mean = values;
+    return true;
+  }
+
+  out.firstId = load<uint32_t>(source);
+  out.lastId = load<uint32_t>(source + 4);
+  out.startMs = load<uint64_t>(source + 8);
+  out.endMs = load<uint64_t>(source + 16);
+  out.samples = load<uint32_t>(source + 24);
+  out.min = reinterpret_cast<const float*>(source + SUMMARY_HEADER);
+  out.max = reinterpret_cast<const float*>(
+      source + SUMMARY_HEADER + floatBytes);
+  out.mean = reinterpret_cast<const float*>(
+      source + SUMMARY_HEADER + 2 * floatBytes);
+  return true;
+}
+
+size_t LiveHistory::lowerBoundTime(size_t level, uint64_t timestampMs) const {
+  if (level >= levelCount) {
+    return 0;
+  }
+
+  const size_t endOffset = level == 0 ? 8 : 16;
+  size_t low = 0;
+  size_t high = levelData[level].count;
+
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+
+    if (load<uint64_t>(slot(level, middle) + endOffset) < timestampMs) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+size_t LiveHistory::lowerBoundId(size_t level, uint32_t sampleId) const {
+  if (level >= levelCount) {
+    return 0;
+  }
+
+  const size_t lastOffset = level == 0 ? 0 : 4;
+  size_t low = 0;
+  size_t high = levelData[level].count;
+
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+
+    if (load<uint32_t>(slot(level, middle) + lastOffset) < sampleId) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+uint64_t LiveHistory::timeOfId(uint32_t sampleId, bool rangeEnd) const {
+  for (size_t level = 0; level < levelCount; ++level) {
+    const Level& data = levelData[level];
+
+    // Older levels are only consulted for identifiers this one dropped.
+    if (data.count == 0 ||
+        (load<uint32_t>(slot(level, 0)) > sampleId &&
+         level + 1 < levelCount)) {
+      continue;
+    }
+
+    const size_t index = lowerBoundId(level, sampleId);
+    if (index == data.count) {
+      return UINT64_MAX;
+    }
+
+    LiveHistoryRecord found;
+    record(level, index, found);
+
+    if (!rangeEnd) {
+      return found.startMs;
+    }
+
+    if (found.firstId <= sampleId) {
+      return found.endMs;
+    }
+
+    // Falls in a gap: the range ends with the previous record.
+    if (index == 0) {
+      return 0;
+    }
+
+    record(level, index - 1, found);
+    return found.endMs;
+  }
+
+  return 0;
+}
+
+size_t LiveHistory::countInRange(
+    size_t level,
+    uint64_t fromMs,
+    uint64_t toMs) const {
+
+  if (level >= levelCount || toMs < fromMs) {
+    return 0;
+  }
+
+  const size_t first = lowerBoundTime(level, fromMs);
+
+  // First record starting after toMs.
+  size_t low = first;
+  size_t high = levelData[level].count;
+
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+
+    if (load<uint64_t>(slot(level, middle) + 8) <= toMs) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low - first;
+}
+
+size_t LiveHistory::selectLevel(
+    uint64_t fromMs,
+    uint64_t toMs,
+    size_t maxRecords) const {
+
+  if (levelCount == 0) {
+    return 0;
+  }
+
+  // When less history is kept than requested, the oldest available data
+  // is treated as the start of the request.
+  uint64_t oldestMs = UINT64_MAX;
+  for (size_t level = 0; level < levelCount; ++level) {
+    if (levelData[level].count > 0) {
+      const uint64_t startMs = load<uint64_t>(slot(level, 0) + 8);
+      if (startMs < oldestMs) {
+        oldestMs = startMs;
+      }
+    }
+  }
+
+  const uint64_t wantedMs = fromMs > oldestMs ? fromMs : oldestMs;
+
+  for (size_t level = 0; level + 1 < levelCount; ++level) {
+    if (levelData[level].count == 0) {
+      continue;
+    }
+
+    const bool covers = load<uint64_t>(slot(level, 0) + 8) <= wantedMs;
+
+    if (covers && countInRange(level, fromMs, toMs) <= maxRecords) {
+      return level;
+    }
+  }
+
+  return levelCount - 1;
+}
+
+/* --------------------------------------------------------------------------
+   Range summaries
+   -------------------------------------------------------------------------- */
+
+bool LiveHistory::holdsFrom(size_t level, uint64_t timestampMs) const {
+  return levelData[level].count > 0 &&
+         load<uint64_t>(slot(level, 0) + 8) <= timestampMs;
+}
+
+void LiveHistory::cover(
+    size_t level,
+    uint64_t fromMs,
+    uint64_t toMs,
+    float* min,
+    float* max,
+    float* sum,
+    uint32_t& samples) const {
+
+  size_t index = lowerBoundTime(level, fromMs);
+  uint64_t coveredMs = fromMs;
+  bool any = false;
+  LiveHistoryRecord found;
+
+  while (record(level, index, found) && found.startMs <= toMs) {
+    const uint64_t startMs = found.startMs > fromMs ? found.startMs : fromMs;
+    const uint64_t endMs = found.endMs < toMs ? found.endMs : toMs;
+    const bool inside = found.startMs >= fromMs && found.endMs <= toMs;
+
+    if (!inside && level > 0 && holdsFrom(level - 1, startMs)) {
+      cover(level - 1, startMs, endMs, min, max, sum, samples);
+    } else {
+      for (size_t i = 0; i < probes; ++i) {
+        if (samples == 0 || found.min[i] < min[i]) {
+          min[i] = found.min[i];
+        }
+        if (samples == 0 || found.max[i] > max[i]) {
+          max[i] = found.max[i];
+        }
+      }
+      for (size_t i = 0; i < probes; ++i) {
+        sum[i] += found.mean[i] * static_cast<float>(found.samples);
+      }
+      samples += found.samples;
+    }
+
+    coveredMs = found.endMs;
+    any = true;
+    ++index;
+  }
+
+  // Newer data not summarized on this level yet is still on the level
+  // below.
+  const uint64_t restMs = any ? coveredMs + 1 : fromMs;
+  if (level > 0 && restMs <= toMs) {
+    cover(level - 1, restMs, toMs, min, max, sum, samples);
+  }
+}
+
+uint32_t LiveHistory::summarize(
+    uint64_t fromMs,
+    uint64_t toMs,
+    float* min,
+    float* max,
+    float* mean) const {
+
+  if (levelCount == 0 || toMs < fromMs) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < probes; ++i) {
+    min[i] = 0.0f;
+    max[i] = 0.0f;
+    mean[i] = 0.0f;
+  }
+
+  uint32_t samples = 0;
+  cover(levelCount - 1, fromMs, toMs, min, max, mean, samples);
+
+  if (samples != 0) {
+    for (size_t i = 0; i < probes; ++i) {
+      mean[i] /= static_cast<float>(samples);
+    }
+  }
+  return samples;
+}
+
+/* --------------------------------------------------------------------------
+   Arduino integration
+   -------------------------------------------------------------------------- */
+
+#if defined(ARDUINO)
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+// Probe subsets are kept as a bitmap over probe indices; probe numbers are
+// 8-bit, so this covers every probe that can be registered.
+static const size_t HISTORY_MAX_PROBES = 256;
+static const size_t HISTORY_MASK_WORDS = HISTORY_MAX_PROBES / 32;
+
+static LiveHistory liveHistory;
+static SemaphoreHandle_t historyMutex = nullptr;
+static float* historyValues = nullptr;
+
+// Range summary of the running query: min, max and mean per probe.
+static float* historySummary = nullptr;
+
+static size_t historyBudget = 0;
+static size_t historyLevels = 4;
+static size_t historyFactor = 8;
+
+// One query is served at a time; a new query replaces it. The cursor is a
+// timestamp rather than a record position, so records dropped from the ring
+// while a query runs do not shift it. Probe positions count selected probes
+// only.
+struct HistoryRequest {
+  bool active;
+  bool summary;
+  bool summarized;
+  uint32_t id;
+  uint8_t level;
+  uint64_t fromMs;
+  uint64_t toMs;
+  uint64_t nextMs;
+  uint32_t fromId;
+  uint32_t toId;
+  uint32_t probeMask[HISTORY_MASK_WORDS];
+  uint16_t selected;
+  uint16_t probeStart;
+  uint16_t probeGroup;
+  uint32_t samples;
+  uint32_t sent;
+};
+
+static HistoryRequest historyRequest;
+static uint32_t historyRequestId = 0;
+
+// Probe indices of the message being built. Only used by the background
+// task, and kept off its stack.
+static uint16_t groupIndices[HISTORY_MAX_PROBES];
+
+static bool lockHistory() {
+  return historyMutex != nullptr &&
+         xSemaphoreTake(historyMutex, portMAX_DELAY) == pdTRUE;
+}
+
+static void unlockHistory() {
+  xSemaphoreGive(historyMutex);
+}
+
+// Same three-decimal rounding as snapshot values.
+static float roundValue(float value) {
+  if (isnan(value)) {
+    return 0.0f;
+  }
+
+  char buffer[20];
+  snprintf(buffer, sizeof(buffer), "%.3f", value);
+  return static_cast<float>(atof(buffer));
+}
+
+static bool probeSelected(const HistoryRequest& request, size_t index) {
+  return index < HISTORY_MAX_PROBES &&
+         (request.probeMask[index / 32] & (1UL << (index % 32))) != 0;
+}
+
+// Fills groupIndices with up to probeGroup selected probes starting at
+// position probeStart, and returns how many were found.
+static size_t collectGroup(const HistoryRequest& request) {
+  size_t position = 0;
+  size_t count = 0;
+
+  for (size_t i = 0;
+       i < liveHistory.probeCount() && count < request.probeGroup;
+       ++i) {
+    if (!probeSelected(request, i)) {
+      continue;
+    }
+    if (position++ >= request.probeStart) {
+      groupIndices[count++] = static_cast<uint16_t>(i);
+    }
+  }
+  return count;
+}
+
+static void addRow(
+    JsonArray rows,
+    size_t level,
+    const LiveHistoryRecord& record,
+    size_t probeCount) {
+
+  JsonArray row = rows.createNestedArray();
+  row.add(record.firstId);
+  row.add(record.startMs);
+
+  if (level == 0) {
+    for (size_t i = 0; i < probeCount; ++i) {
+      row.add(roundValue(record.mean[groupIndices[i]]));
+    }
+    return;
+  }
+
+  row.add(record.endMs);
+  row.add(record.samples);
+
+  for (size_t i = 0; i < probeCount; ++i) {
+    const size_t index = groupIndices[i];
+    row.add(roundValue(record.min[index]));
+    row.add(roundValue(record.max[index]));
+    row.add(roundValue(record.mean[index]));
+  }
+}
+
+static JsonObject startMessage(
+    JsonDocument& document,
+    const HistoryRequest& request,
+    size_t probeCount) {
+
+  JsonObject object = document.to<JsonObject>();
+  object["ver"] = ESP32_LIVE_VERSION;
+  object["event"] = "history";
+  object["q"] = request.id;
+
+  if (!request.summary) {
+    object["level"] = request.level;
+  }
+
+  if (probeCount != 0) {
+    JsonArray nums = object.createNestedArray("probes");
+    for (size_t i = 0; i < probeCount; ++i) {
+      nums.add(pins[groupIndices[i]].num);
+    }
+  }
+  return object;
+}
+
+// One message of the range summary: min, max and mean for a probe group.
+static bool addSummary(
+    JsonObject object,
+    const HistoryRequest& request,
+    size_t probeCount) {
+
+  const size_t probeTotal = liveHistory.probeCount();
+
+  object["from"] = request.fromMs;
+  object["to"] = request.toMs;
+  object["samples"] = request.samples;
+
+  JsonArray min = object.createNestedArray("min");
+  JsonArray max = object.createNestedArray("max");
+  JsonArray mean = object.createNestedArray("mean");
+
+  for (size_t i = 0; i < probeCount; ++i) {
+    const size_t index = groupIndices[i];
+    min.add(roundValue(historySummary[index]));
+    max.add(roundValue(historySummary[probeTotal + index]));
+    mean.add(roundValue(historySummary[2 * probeTotal + index]));
+  }
+
+  return measureJson(object) <= liveChunkLimit();
+}
+
+// Builds and sends one message of the running query. Returns false when
+// the query is finished or could not be sent.
+static bool sendHistoryMessage(HistoryRequest& request) {
+  const size_t limit = liveChunkLimit();
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument document;
+#else
+  StaticJsonDocument<1024> document;
+#endif
+
+  if (request.probeStart >= request.selected) {
+    JsonObject object = startMessage(document, request, 0);
+    object["count"] = request.sent;
+    object["last"] = true;
+
+    liveSendEvent(object);
+    return false;
+  }
+
+  const size_t probeCount = collectGroup(request);
+
+  if (request.summary) {
+    if (!request.summarized) {
+      if (!lockHistory()) {
+        return false;
+      }
+
+      const size_t probeTotal = liveHistory.probeCount();
+      request.samples = liveHistory.summarize(
+          request.fromMs,
+          request.toMs,
+          historySummary,
+          historySummary + probeTotal,
+          historySummary + 2 * probeTotal);
+      unlockHistory();
+
+      request.summarized = true;
+    }
+
+    JsonObject object = startMessage(document, request, probeCount);
+    object["summary"] = true;
+
+    if (!addSummary(object, request, probeCount)) {
+      // Too many probes for one message: send fewer per message.
+      if (request.probeGroup > 1) {
+        request.probeGroup = static_cast<uint16_t>(request.probeGroup / 2);
+        return true;
+      }
+      return false;
+    }
+
+    request.probeStart =
+        static_cast<uint16_t>(request.probeStart + probeCount);
+    ++request.sent;
+    return liveSendEvent(object);
+  }
+
+  JsonObject object = startMessage(document, request, probeCount);
+  JsonArray rows = object.createNestedArray("rows");
+
+  size_t added = 0;
+  bool tooWide = false;
+
+  if (!lockHistory()) {
+    return false;
+  }
+
+  size_t index = liveHistory.lowerBoundTime(request.level, request.nextMs);
+  LiveHistoryRecord record;
+
+  while (liveHistory.record(request.level, index, record) &&
+         record.startMs <= request.toMs &&
+         record.firstId <= request.toId) {
+
+    if (record.lastId >= request.fromId) {
+      addRow(rows, request.level, record, probeCount);
+
+      if (measureJson(document) > limit) {
+        rows.remove(rows.size() - 1);
+        tooWide = added == 0;
+        break;
+      }
+      ++added;
+    }
+
+    request.nextMs = record.endMs + 1;
+    ++index;
+  }
+
+  unlockHistory();
+
+  if (tooWide) {
+    // A single row does not fit: send fewer probes per message.
+    if (request.probeGroup > 1) {
+      request.probeGroup = static_cast<uint16_t>(request.probeGroup / 2);
+      return true;
+    }
+    return false;
+  }
+
+  if (added == 0) {
+    // This probe group is complete; continue with the next one.
+    request.probeStart =
+        static_cast<uint16_t>(request.probeStart + probeCount);
+    request.nextMs = request.fromMs;
+    return true;
+  }
+
+  request.sent += added;
+  return liveSendEvent(object);
+}
+
+/* --------------------------------------------------------------------------
+   Library hooks
+   -------------------------------------------------------------------------- */
+
+void liveHistoryBegin(size_t probeCount) {
+  if (historyBudget == 0 || probeCount == 0 || liveHistory.ready()) {
+    return;
+  }
+
+  // The records go to PSRAM when the board has it. The conversion scratch
+  // and range summary are touched on every capture and stay internal.
+  void* memory = liveAlloc(historyBudget, LIVE_MEMORY_BULK);
+  historyValues = static_cast<float*>(
+      liveAlloc(4 * probeCount * sizeof(float), LIVE_MEMORY_INTERNAL));
+  historyMutex = xSemaphoreCreateMutex();
+
+  if (memory == nullptr ||
+      historyValues == nullptr ||
+      historyMutex == nullptr ||
+      !liveHistory.begin(
+          memory, historyBudget, probeCount, historyLevels, historyFactor)) {
+    liveFree(memory);
+    liveFree(historyValues);
+    historyValues = nullptr;
+    if (historyMutex != nullptr) {
+      vSemaphoreDelete(historyMutex);
+      historyMutex = nullptr;
+    }
+    return;
+  }
+
+  historySummary = historyValues + probeCount;
+}
+
+bool liveHistoryEnabled() {
+  return liveHistory.ready();
+}
+
+void liveHistoryRecord(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const LiveValue* values,
+    size_t count) {
+
+  if (!liveHistory.ready() || count != liveHistory.probeCount()) {
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    historyValues[i] = liveProbeNumber(pins[i], values[i]);
+  }
+
+  if (lockHistory()) {
+    liveHistory.append(sampleId, timestampMs, historyValues);
+    unlockHistory();
+  }
+}
+
+// Query object written to the control characteristic. Time bounds are in
+// device milliseconds; "from_id"/"to_id" select by sample_id instead.
+void liveHistoryRequest(JsonObject query) {
+  if (!liveHistory.ready()) {
+    return;
+  }
+
+  HistoryRequest request;
+  memset(&request, 0, sizeof(request));
+
+  const size_t probeTotal = liveHistory.probeCount();
+  JsonArray probes = query["probes"];
+
+  if (probes.isNull()) {
+    for (size_t i = 0; i < probeTotal && i < HISTORY_MAX_PROBES; ++i) {
+      request.probeMask[i / 32] |= 1UL << (i % 32);
+      ++request.selected;
+    }
+  } else {
+    for (JsonVariant num : probes) {
+      const int index = liveFindProbeIndex(num.as<uint8_t>());
+
+      if (index < 0 ||
+          static_cast<size_t>(index) >= probeTotal ||
+          probeSelected(request, index)) {
+        continue;
+      }
+
+      request.probeMask[index / 32] |= 1UL << (index % 32);
+      ++request.selected;
+    }
+  }
+
+  uint32_t points = 200;
+  if (!query["points"].isNull()) {
+    points = query["points"].as<uint32_t>();
+  }
+
+  request.summary = query["summary"].as<bool>();
+  request.fromId = 0;
+  request.toId = UINT32_MAX;
+
+  if (!query["from_id"].isNull()) {
+    request.fromId = query["from_id"].as<uint32_t>();
+  }
+  if (!query["to_id"].isNull()) {
+    request.toId = query["to_id"].as<uint32_t>();
+  }
+
+  if (request.selected == 0 ||
+      request.fromId > request.toId ||
+      (points == 0 && !request.summary) ||
+      !lockHistory()) {
+    return;
+  }
+
+  const uint64_t nowMs = liveNowMs();
+  request.toMs = nowMs;
+
+  if (!query["last"].isNull()) {
+    const uint64_t lastMs = query["last"].as<uint64_t>();
+    request.fromMs = lastMs < nowMs ? nowMs - lastMs : 0;
+  } else {
+    if (!query["from"].isNull()) {
+      request.fromMs = query["from"].as<uint64_t>();
+    }
+    if (!query["to"].isNull()) {
+      request.toMs = query["to"].as<uint64_t>();
+    }
+  }
+
+  // Identifier bounds narrow the time range; both lookups are binary
+  // searches.
+  if (request.fromId != 0) {
+    const uint64_t fromMs = liveHistory.timeOfId(request.fromId, false);
+    if (fromMs > request.fromMs) {
+      request.fromMs = fromMs;
+    }
+  }
+  if (request.toId != UINT32_MAX) {
+    const uint64_t toMs = liveHistory.timeOfId(request.toId, true);
+    if (toMs < request.toMs) {
+      request.toMs = toMs;
+    }
+  }
+
+  // An empty range still gets its closing message.
+  request.active = true;
+  request.id = ++historyRequestId;
+  request.level = static_cast<uint8_t>(
+      liveHistory.selectLevel(request.fromMs, request.toMs, points));
+  request.nextMs = request.fromMs;
+  request.probeGroup = request.selected;
+
+  historyRequest = request;
+  unlockHistory();
+}
+
+void liveHistoryService() {
+  if (!liveHistory.ready() || !lockHistory()) {
+    return;
+  }
+
+  HistoryRequest request = historyRequest;
+  unlockHistory();
+
+  if (!request.active) {
+    return;
+  }
+
+  bool more = true;
+  for (size_t i = 0; i < ESP32_LIVE_HISTORY_BURST && more; ++i) {
+    more = sendHistoryMessage(request);
+  }
+
+  // A newer query replaces this one instead of being overwritten by it.
+  if (lockHistory()) {
+    if (historyRequest.id == request.id) {
+      request.active = more;
+      historyRequest = request;
+    }
+    unlockHistory();
+  }
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+bool esp32_live_history_enable(
+    size_t budgetBytes,
+    size_t levels,
+    size_t factor) {
+
+  if (liveHistory.ready() ||
+      budgetBytes == 0 ||
+      levels == 0 ||
+      levels > LiveHistory::MAX_LEVELS ||
+      factor < 2) {
+    return false;
+  }
+
+  historyBudget = budgetBytes;
+  historyLevels = levels;
+  historyFactor = factor;
+  return true;
+}
+
+bool esp32_live_history_ready() {
+  return liveHistory.ready();
+}
+
+#endif
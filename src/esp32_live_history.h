@@ -0,0 +1,145 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Multi-resolution history of captured snapshots. Level 0 keeps recent
+// snapshots at full rate. Every higher level keeps min/max/mean records,
+// each summarizing `factor` records of the level below, so older data is
+// kept at progressively lower resolution. All levels live in one memory
+// block of fixed size supplied by the caller.
+//
+// This file has no Arduino dependency.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One history record. For level 0 the record is a single snapshot: min, max
+// and mean all point to the captured values and samples is 1. The pointers
+// refer to probeCount() floats inside the history memory and stay valid
+// until the next append().
+struct LiveHistoryRecord {
+  uint32_t firstId;
+  uint32_t lastId;
+  uint64_t startMs;
+  uint64_t endMs;
+  uint32_t samples;
+  const float* min;
+  const float* max;
+  const float* mean;
+};
+
+class LiveHistory {
+public:
+  static const size_t MAX_LEVELS = 6;
+
+  // Divides memory evenly between the levels. Returns false when the block
+  // cannot hold at least two records on every level.
+  bool begin(
+      void* memory,
+      size_t bytes,
+      size_t probeCount,
+      size_t levels = 4,
+      size_t factor = 8);
+
+  bool ready() const {
+    return levelCount != 0;
+  }
+
+  size_t levels() const {
+    return levelCount;
+  }
+
+  size_t probeCount() const {
+    return probes;
+  }
+
+  size_t factor() const {
+    return mergeFactor;
+  }
+
+  size_t size(size_t level) const;
+  size_t capacity(size_t level) const;
+
+  // Appends one snapshot. sample_id and timestamp must not decrease.
+  void append(uint32_t sampleId, uint64_t timestampMs, const float* values);
+
+  // Record by position, 0 being the oldest record kept on that level.
+  bool record(size_t level, size_t index, LiveHistoryRecord& out) const;
+
+  // Position of the first record on level whose time span ends at or after
+  // timestampMs, or size(level) when there is none. Binary search.
+  size_t lowerBoundTime(size_t level, uint64_t timestampMs) const;
+
+  // Position of the first record on level whose last sample_id is at or
+  // after sampleId, or size(level) when there is none. Binary search.
+  size_t lowerBoundId(size_t level, uint32_t sampleId) const;
+
+  // Time of sampleId, taken from the finest level that still holds it: the
+  // start of its record, or the end when rangeEnd is set. Identifiers lost
+  // to gaps resolve to the neighbouring record. Returns 0 for identifiers
+  // older than the history and UINT64_MAX for newer ones.
+  uint64_t timeOfId(uint32_t sampleId, bool rangeEnd) const;
+
+  // Number of records on level overlapping [fromMs, toMs].
+  size_t countInRange(size_t level, uint64_t fromMs, uint64_t toMs) const;
+
+  // Finest level that still covers fromMs and returns at most maxRecords
+  // records for [fromMs, toMs]. Falls back to the coarsest level.
+  size_t selectLevel(uint64_t fromMs, uint64_t toMs, size_t maxRecords) const;
+
+  // Min, max and mean of every probe over [fromMs, toMs], each array holding
+  // probeCount() floats. Whole summary records are used where they fit in
+  // the range and finer levels only at its edges, so the cost grows with
+  // the logarithm of the range. Where the finer data was already dropped,
+  // an edge record is used whole. Returns the number of samples covered.
+  uint32_t summarize(
+      uint64_t fromMs,
+      uint64_t toMs,
+      float* min,
+      float* max,
+      float* mean) const;
+
+private:
+  struct Level {
+    uint8_t* base;
+    size_t recordSize;
+    size_t capacity;
+    size_t head;
+    size_t count;
+  };
+
+  // Partial summary being built for the level above.
+  struct Accumulator {
+    uint32_t firstId;
+    uint32_t lastId;
+    uint64_t startMs;
+    uint64_t endMs;
+    uint32_t samples;
+    uint32_t children;
+    float* min;
+    float* max;
+    float* sum;
+  };
+
+  uint8_t* slot(size_t level, size_t index) const;
+  void push(size_t level, const LiveHistoryRecord& record);
+  void accumulate(size_t level, const LiveHistoryRecord& record);
+  bool holdsFrom(size_t level, uint64_t timestampMs) const;
+  void cover(
+      size_t level,
+      uint64_t fromMs,
+      uint64_t toMs,
+      float* min,
+      float* max,
+      float* sum,
+      uint32_t& samples) const;
+
+  Level levelData[MAX_LEVELS];
+  Accumulator pending[MAX_LEVELS];
+  size_t levelCount = 0;
+  size_t probes = 0;
+  size_t mergeFactor = 0;
+};
@@ -0,0 +1,194 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Library-internal helpers shared between the source files in src/. Not part
+// of the public API and not included by esp32_live.h.
+//
+
+#pragma once
+
+#include "esp32_live.h"
+#include "esp32_live_compact.h"
+#include "esp32_live_json.h"
+
+// Monotonic milliseconds used for every timestamp the library sends. Equal
+// to esp_timer time unless a deep-sleep cycle moved the clock offset.
+uint64_t liveNowMs();
+void liveSetClockOffsetMs(int64_t offsetMs);
+
+// Advances the snapshot identifier by count and returns the first reserved
+// identifier. Safe from any task: a reserved identifier is never handed to a
+// captured frame.
+uint32_t liveReserveSampleIds(uint32_t count);
+
+// True while a client is connected and subscribed to the notify
+// characteristic.
+bool liveClientSubscribed();
+
+// Sends values for an arbitrary subset of pins as regular JSON snapshot
+// chunks. indices refers to entries of pins. When tagKey is not null, the
+// header carries tagKey set to tagValue (or true when tagValue is null) so
+// the app can tell these frames from live data. Chunks are split with the
+// same worst-case plan as full frames. A call with no values sends one chunk
+// with an empty probe array. Background task only: it shares the notify
+// characteristic with the periodic stream.
+bool liveSendProbeValues(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const uint16_t* indices,
+    const LiveValue* values,
+    size_t count,
+    const char* tagKey,
+    const char* tagValue);
+
+int liveFindProbeIndex(uint8_t num);
+
+// True, after logging an error, once esp32_live_begin() has laid out the
+// capture ring for the registered probes: probe n cannot be added any more.
+bool liveRejectLateProbe(uint8_t n);
+
+// Client Characteristic Configuration state of the notify characteristics,
+// as a mask of LiveSubscription bits.
+enum LiveSubscription : uint8_t {
+  LIVE_SUBSCRIBED_STREAM = 0x01,
+  LIVE_SUBSCRIBED_EVENTS = 0x02
+};
+
+uint8_t liveSubscriptions();
+void liveRestoreSubscriptions(uint8_t mask);
+
+// Capability-aware allocation. LIVE_MEMORY_BULK places large buffers in
+// PSRAM, aligned to ESP32_LIVE_CACHE_LINE, and falls back to internal RAM;
+// LIVE_MEMORY_INTERNAL is for small, frequently touched state. Release with
+// liveFree().
+enum LiveMemory : uint8_t {
+  LIVE_MEMORY_BULK,
+  LIVE_MEMORY_INTERNAL
+};
+
+void* liveAlloc(size_t bytes, LiveMemory memory);
+void liveFree(void* buffer);
+
+uint16_t liveNegotiatedMtu();
+void liveRestoreMtu(uint16_t mtu);
+uint32_t liveSamplingIntervalMs();
+
+// Sends one JSON object on the events characteristic. Returns false when no
+// client is subscribed to events or the object does not fit in one chunk.
+bool liveSendEvent(JsonObject event);
+
+// Largest notification payload for the negotiated MTU.
+size_t liveChunkLimit();
+
+// Copies the newest captured frame, at most LIVE_COMPACT_MAX_PROBES probes.
+// Returns false when nothing was captured yet.
+bool liveCopyLatestFrame(
+    uint32_t& sampleId,
+    uint64_t& timestampMs,
+    LiveCompactProbe* probes,
+    size_t& count);
+
+// Black box (esp32_live_blackbox.cpp). liveBlackboxRecord() is called by the
+// background task for every captured frame; liveBlackboxService() by the
+// background task to upload a recovered record once a client subscribes.
+bool liveBlackboxEnabled();
+void liveBlackboxRecord(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const LiveValue* values,
+    size_t count);
+void liveBlackboxService();
+
+// Deep-sleep sampling (esp32_live_ulp.cpp). liveUlpService() is called by
+// the background task to send a batch requested by esp32_live_ulp_upload().
+void liveUlpService();
+
+// Write watch (esp32_live_watch.cpp). liveWatchService() is called by the
+// background task to send the queued write events.
+void liveWatchService();
+
+// Alarm rules (esp32_live_alarm.cpp). liveAlarmEvaluate() is called by the
+// background task for every captured frame and returns true when a
+// transition was queued; liveAlarmService() sends queued transitions.
+bool liveAlarmsEnabled();
+bool liveAlarmEvaluate(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const LiveValue* values,
+    size_t count);
+bool liveAlarmPending();
+void liveAlarmService();
+
+// Bonding (esp32_live_bond.cpp). liveBondGapEvent() receives GAP events from
+// the stack and liveBondGattsInterface() the server's GATT interface;
+// liveBondService() restores and persists peer preferences from the
+// background task.
+void liveBondBegin();
+#if defined(CONFIG_BLUEDROID_ENABLED)
+void liveBondGapEvent(
+    esp_gap_ble_cb_event_t event,
+    esp_ble_gap_cb_param_t* param);
+void liveBondGattsInterface(esp_gatt_if_t gattsIf);
+#endif
+void liveBondPreferencesChanged();
+void liveBondDisconnected();
+void liveBondService();
+
+// Link telemetry (esp32_live_stats.cpp). The stack hooks run on the
+// Bluetooth task; liveStatsService() sends the periodic stats frame.
+#if defined(CONFIG_BLUEDROID_ENABLED)
+void liveStatsConnected(esp_ble_gatts_cb_param_t* param);
+void liveStatsGapEvent(
+    esp_gap_ble_cb_event_t event,
+    esp_ble_gap_cb_param_t* param);
+void liveStatsGattsEvent(
+    esp_gatts_cb_event_t event,
+    esp_ble_gatts_cb_param_t* param);
+#endif
+void liveStatsDisconnected();
+void liveStatsNotifyStatus(bool sent);
+void liveStatsCaptureDropped();
+void liveStatsService();
+
+// History (esp32_live_history.cpp). liveHistoryBegin() allocates the store
+// once the probe list is fixed; liveHistoryRecord() is called by the
+// background task for every captured frame. liveHistoryRequest() starts the
+// "history" query written to the control characteristic and
+// liveHistoryService() streams it from the background task.
+void liveHistoryBegin(size_t probeCount);
+bool liveHistoryEnabled();
+void liveHistoryRecord(
+    uint32_t sampleId,
+    uint64_t timestampMs,
+    const LiveValue* values,
+    size_t count);
+void liveHistoryRequest(JsonObject query);
+void liveHistoryService();
+
+// Broadcast (esp32_live_broadcast.cpp). liveBroadcastBegin() installs the
+// advertising and scan response data; liveBroadcastService() refreshes the
+// advertised values from the background task. With the periodic train, both
+// advertisements are extended sets, set up from the completion events, and
+// liveBroadcastAdvertise() restarts the connectable one; otherwise it starts
+// legacy advertising.
+void liveBroadcastBegin(
+    BLEAdvertising* advertising,
+    const char* serviceUuid,
+    const char* deviceName);
+void liveBroadcastAdvertise();
+bool liveBroadcastEnabled();
+void liveBroadcastService();
+#if defined(CONFIG_BT_BLE_50_FEATURES_SUPPORTED)
+void liveBroadcastGapEvent(
+    esp_gap_ble_cb_event_t event,
+    esp_ble_gap_cb_param_t* param);
+#endif
+
+// Boot timing (esp32_live_boot.cpp). The hooks record the first occurrence
+// of each step; liveBootService() reports them once to a subscribed client.
+void liveBootBegin(bool async);
+void liveBootReturned();
+void liveBootAdvertising();
+void liveBootSampleStored();
+void liveBootService();
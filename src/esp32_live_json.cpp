@@ -0,0 +1,256 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_json.h"
+#include "esp32_live_config.h"
+#include "esp32_live_quant.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* --------------------------------------------------------------------------
+   Header
+   -------------------------------------------------------------------------- */
+
+void liveJsonAddHeader(
+    JsonObject header,
+    uint64_t timestampMs,
+    uint32_t rateMs,
+    const float* temperature) {
+
+  header["ver"] = ESP32_LIVE_VERSION;
+  header["timestamp"] = timestampMs;
+  header["rate"] = rateMs;
+
+  if (temperature != nullptr) {
+    header["temp"] = *temperature;
+  }
+}
+
+size_t liveJsonAddTag(
+    JsonObject header,
+    const char* tagKey,
+    const char* tagValue) {
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument tagDocument;
+#else
+  StaticJsonDocument<64> tagDocument;
+#endif
+
+  if (tagValue != nullptr) {
+    header[tagKey] = tagValue;
+    tagDocument[tagKey] = tagValue;
+  } else {
+    header[tagKey] = true;
+    tagDocument[tagKey] = true;
+  }
+
+  // {"key":value} without the braces, plus the separating comma.
+  return measureJson(tagDocument) - 1;
+}
+
+/* --------------------------------------------------------------------------
+   Probe values
+   -------------------------------------------------------------------------- */
+
+// Value of a quantized probe in its declared units: volts for analog pins,
+// the captured number for virtual probes.
+static float quantizedNumber(const ProbeEntry& pin, LiveValue captured) {
+  if (pin.kind == LIVE_PROBE_ANALOG || pin.kind == LIVE_PROBE_DAC_OUT) {
+    return 3.3f * captured.i / 4095.0f;
+  }
+  return liveProbeNumber(pin, captured);
+}
+
+void jsonAddProbeValue(
+    JsonObject object,
+    const ProbeEntry& pin,
+    LiveValue captured) {
+
+  if (pin.quantBits > 0) {
+    object["num"] = pin.num;
+    object["q"] = liveQuantize(
+        quantizedNumber(pin, captured),
+        pin.quantMin,
+        pin.quantMax,
+        pin.quantBits);
+    return;
+  }
+
+  const bool isVirtual = liveIsVirtualProbe(pin);
+
+  object["num"] = pin.num;
+  object["config"] = isVirtual ? "VIRTUAL" : pin.cfg;
+  object["direction"] = pin.dir;
+  object["src"] =
+      isVirtual ? "virtual" : (isDacPin(pin.num) ? "dac" : "hw");
+
+  if (isVirtual) {
+    if (liveIsIntegerProbe(pin)) {
+      object["value"] = captured.i;
+      object["voltage"] = "-";
+      return;
+    }
+
+    const float value = isnan(captured.f) ? 0.0f : captured.f;
+
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+
+    object["value"] = atof(buffer);
+    object["voltage"] = "-";
+    return;
+  }
+
+  if (pin.kind == LIVE_PROBE_DIGITAL) {
+    const int digitalValue = captured.i;
+
+    object["value"] = digitalValue;
+    object["digital"] = digitalValue;
+    // Written as text: a float 3.3 would print as 3.299999952.
+    object["voltage"] =
+        digitalValue ? serialized("3.3") : serialized("0");
+    return;
+  }
+
+  const int analogValue = captured.i;
+
+  object["value"] = analogValue;
+  object["analog"] = analogValue;
+  object["voltage"] = 3.3f * analogValue / 4095.0f;
+}
+
+/* --------------------------------------------------------------------------
+   Worst-case widths
+   -------------------------------------------------------------------------- */
+
+// Worst-case encodings used only to measure widths, each the longest text
+// ArduinoJson prints for the values the field can hold. Floats print with
+// at most 9 decimals, and with a 10-digit mantissa and an exponent from
+// 1e7 up.
+//
+// Virtual floats are rounded to three decimals and come from a float, so
+// they are either a plain decimal below 1e7 or an exponent of at most 38.
+// Voltages lie between 0 and 3.3, and the chip temperature has at most
+// three integer digits. Timestamps are milliseconds since boot, 13 digits
+// for three centuries.
+static const char* const WORST_VIRTUAL_FLOAT = "-1.234567891e38";
+static const char* const WORST_VOLTAGE = "3.299999952";
+static const char* const WORST_TEMPERATURE = "-123.123456789";
+static const char* const WORST_TIMESTAMP = "9999999999999";
+static const char* const WORST_INT32 = "-2147483648";
+static const char* const WORST_UINT32 = "4294967295";
+
+// Quantized probes are planned for the widest code of any bit depth, so the
+// plan does not depend on the schema.
+static const char* const WORST_CODE = "65535";
+
+size_t liveJsonWorstHeaderWidth(bool withTemperature) {
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument document;
+#else
+  StaticJsonDocument<512> document;
+#endif
+
+  const float temperature = 0.0f;
+  liveJsonAddHeader(
+      document.to<JsonObject>(),
+      0,
+      ESP32_LIVE_RATE_MAX,
+      withTemperature ? &temperature : nullptr);
+
+  document["timestamp"] = serialized(WORST_TIMESTAMP);
+  if (withTemperature) {
+    document["temp"] = serialized(WORST_TEMPERATURE);
+  }
+  document["sample_id"] = serialized(WORST_UINT32);
+  document["seq"] = serialized("65535");
+  document["last"] = false;
+  document.createNestedArray("pins");
+
+  return measureJson(document);
+}
+
+uint16_t liveJsonWorstProbeWidth(const ProbeEntry& pin) {
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument document;
+#else
+  StaticJsonDocument<512> document;
+#endif
+
+  JsonObject object = document.to<JsonObject>();
+  LiveValue placeholder;
+  placeholder.i = 0;
+  jsonAddProbeValue(object, pin, placeholder);
+
+  if (pin.quantBits > 0) {
+    object["q"] = serialized(WORST_CODE);
+    const size_t width = measureJson(object);
+    return static_cast<uint16_t>(width > UINT16_MAX ? UINT16_MAX : width);
+  }
+
+  switch (pin.kind) {
+    case LIVE_PROBE_VIRTUAL:
+      object["value"] = serialized(
+          liveIsIntegerProbe(pin) ? WORST_INT32 : WORST_VIRTUAL_FLOAT);
+      break;
+    case LIVE_PROBE_DIGITAL:
+      object["value"] = serialized("1");
+      object["digital"] = serialized("1");
+      object["voltage"] = serialized("3.3");
+      break;
+    case LIVE_PROBE_ANALOG:
+    case LIVE_PROBE_DAC_OUT:
+      object["value"] = serialized("4095");
+      object["analog"] = serialized("4095");
+      object["voltage"] = serialized(WORST_VOLTAGE);
+      break;
+  }
+
+  const size_t width = measureJson(object);
+  return static_cast<uint16_t>(width > UINT16_MAX ? UINT16_MAX : width);
+}
+
+/* --------------------------------------------------------------------------
+   Chunks
+   -------------------------------------------------------------------------- */
+
+// The header fields are the same for every chunk of a frame; each chunk
+// copies them from the frame header and appends its sequence and probes.
+size_t liveJsonEncodeChunk(
+    JsonObjectConst header,
+    const ProbeEntry* probes,
+    const uint16_t* indices,
+    const LiveValue* values,
+    size_t first,
+    size_t end,
+    uint16_t sequence,
+    bool last,
+    char* out,
+    size_t size) {
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument document;
+#else
+  StaticJsonDocument<LIVE_JSON_CHUNK_BYTES> document;
+#endif
+
+  document.set(header);
+  document["seq"] = sequence;
+  document["last"] = last;
+
+  JsonArray pinArray = document.createNestedArray("pins");
+
+  for (size_t i = first; i < end; ++i) {
+    jsonAddProbeValue(
+        pinArray.createNestedObject(),
+        probes[indices != nullptr ? indices[i] : i],
+        values[i]);
+  }
+
+  return serializeJson(document, out, size);
+}
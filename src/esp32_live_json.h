@@ -0,0 +1,64 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// JSON encoding of snapshot chunks: the header, the probe objects and the
+// worst-case widths the chunk plan is built from. Depends on ArduinoJson 6
+// or 7 and on ProbeEntry only; the values, the clock and the chip
+// temperature are passed in, so the host tests build this file against both
+// ArduinoJson versions and compare its chunks with the golden frames.
+//
+
+#pragma once
+
+#include <ArduinoJson.h>
+
+#include "esp32_live_probe.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of one serialized chunk, the largest BLE payload the library sends.
+static const size_t LIVE_JSON_CHUNK_BYTES = 512;
+
+// Writes ver, timestamp, rate and, when temperature is not null, temp.
+void liveJsonAddHeader(
+    JsonObject header,
+    uint64_t timestampMs,
+    uint32_t rateMs,
+    const float* temperature);
+
+// Adds the tag of a partial frame: tagKey set to tagValue, or to true when
+// tagValue is null. Returns the width the tag adds to the header.
+size_t liveJsonAddTag(
+    JsonObject header,
+    const char* tagKey,
+    const char* tagValue);
+
+// Formats one captured probe value in the snapshot pin format.
+void jsonAddProbeValue(
+    JsonObject object,
+    const ProbeEntry& pin,
+    LiveValue captured);
+
+// Worst-case encoded widths of a frame header (with sample_id, seq, last
+// and the empty probe array) and of one probe object, for
+// liveBuildChunkPlan().
+size_t liveJsonWorstHeaderWidth(bool withTemperature);
+uint16_t liveJsonWorstProbeWidth(const ProbeEntry& pin);
+
+// Serializes one chunk: a copy of header, then seq, last and the values
+// [first, end). They belong to the entries of probes listed in indices, or
+// to the entries at the same positions when indices is null. Returns the
+// length written to out.
+size_t liveJsonEncodeChunk(
+    JsonObjectConst header,
+    const ProbeEntry* probes,
+    const uint16_t* indices,
+    const LiveValue* values,
+    size_t first,
+    size_t end,
+    uint16_t sequence,
+    bool last,
+    char* out,
+    size_t size);
@@ -0,0 +1,44 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_plan.h"
+
+void liveBuildChunkPlan(
+    LiveChunkPlan& plan,
+    size_t headerWidth,
+    const uint16_t* widths,
+    size_t count,
+    size_t limit) {
+
+  plan.starts.clear();
+  plan.limit = limit;
+
+  size_t used = 0;
+  size_t inChunk = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    const size_t separator = inChunk > 0 ? 1 : 0;
+
+    if (inChunk == 0) {
+      plan.starts.push_back(static_cast<uint16_t>(i));
+      used = headerWidth + widths[i];
+      inChunk = 1;
+      continue;
+    }
+
+    if (used + separator + widths[i] > limit) {
+      plan.starts.push_back(static_cast<uint16_t>(i));
+      used = headerWidth + widths[i];
+      inChunk = 1;
+      continue;
+    }
+
+    used += separator + widths[i];
+    ++inChunk;
+  }
+
+  plan.starts.push_back(static_cast<uint16_t>(count));
+  plan.valid = true;
+}
@@ -0,0 +1,41 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Chunk layout plan: how one snapshot is split into BLE notifications.
+// The plan is computed from worst-case encoded widths, so it stays valid
+// for every value a probe can take and is only rebuilt when the probe set,
+// the MTU or the encoding changes.
+//
+// This file has no Arduino dependency.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+struct LiveChunkPlan {
+  // First probe index of every chunk, followed by the probe count.
+  std::vector<uint16_t> starts;
+  uint32_t generation = 0;
+  size_t limit = 0;
+  bool valid = false;
+
+  size_t chunkCount() const {
+    return starts.empty() ? 0 : starts.size() - 1;
+  }
+};
+
+// Packs probes greedily in order. headerWidth is the worst-case size of a
+// chunk without probes (including the empty probe array); widths holds the
+// worst-case size of each probe object. Array separators are accounted for.
+// A probe that does not fit even in an empty chunk is given its own chunk.
+void liveBuildChunkPlan(
+    LiveChunkPlan& plan,
+    size_t headerWidth,
+    const uint16_t* widths,
+    size_t count,
+    size_t limit);
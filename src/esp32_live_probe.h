@@ -0,0 +1,119 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Probe entries and captured values. Depends on the Arduino String class
+// only, so the host tests build the serializer (esp32_live_json.cpp) with a
+// small String shim.
+//
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <atomic>
+
+// True on the DAC pins of the classic ESP32. Defined in esp32_live.cpp for
+// the selected target.
+bool isDacPin(uint8_t n);
+
+// Value type produced by a context getter. Integer and boolean values are
+// sent without the three-decimal float formatting used for float probes.
+enum LiveValueType : uint8_t {
+  LIVE_VALUE_FLOAT = 0,
+  LIVE_VALUE_INT32,
+  LIVE_VALUE_BOOL
+};
+
+// Getter that receives a user context pointer, for example the address of
+// one sensor object in an array. The function pointer and the context are
+// stored inline in the probe entry, so no heap allocation is made.
+struct ProbeGetter {
+  union {
+    float (*asFloat)(void* context);
+    int32_t (*asInt32)(void* context);
+    bool (*asBool)(void* context);
+  } fn;
+  void* context;
+  LiveValueType type;
+};
+
+// One captured probe value. GPIO levels, ADC counts and integer or boolean
+// getters use i; float variables and float getters use f.
+union LiveValue {
+  float f;
+  int32_t i;
+};
+
+// Variables that are updated together in loop(), for example a position
+// and its timestamp. The application brackets each update with
+// esp32_live_group_write_begin() and esp32_live_group_write_end(); the
+// sampler re-reads the group until it sees no write in progress.
+struct LiveProbeGroup {
+  std::atomic<uint32_t> sequence{0};
+};
+
+inline void esp32_live_group_write_begin(LiveProbeGroup& group) {
+  group.sequence.store(
+      group.sequence.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline void esp32_live_group_write_end(LiveProbeGroup& group) {
+  std::atomic_thread_fence(std::memory_order_release);
+  group.sequence.store(
+      group.sequence.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+}
+
+// Probe classification cached at registration, so capturing a snapshot does
+// not compare configuration strings.
+enum LiveProbeKind : uint8_t {
+  LIVE_PROBE_DIGITAL = 0,
+  LIVE_PROBE_ANALOG,
+  LIVE_PROBE_DAC_OUT,
+  LIVE_PROBE_VIRTUAL
+};
+
+struct ProbeEntry {
+  uint8_t num;
+  String cfg;
+  String dir;
+  float (*getter)();
+  float cur;
+  bool hasCur;
+  const volatile float* ptr;
+  bool hasPtr;
+  ProbeGetter ctxGetter;
+  bool hasCtxGetter;
+  LiveProbeGroup* group;
+  LiveValue held;
+  LiveProbeKind kind;
+  float deadband;
+  bool hasSchema;
+  uint8_t quantBits;
+  float quantMin;
+  float quantMax;
+  String units;
+};
+
+inline bool liveIsVirtualProbe(const ProbeEntry& pin) {
+  return pin.kind == LIVE_PROBE_VIRTUAL;
+}
+
+// Integer probes carry LiveValue::i: GPIO levels, ADC counts and integer or
+// boolean getters. Every other probe carries a float in LiveValue::f.
+inline bool liveIsIntegerProbe(const ProbeEntry& pin) {
+  if (!liveIsVirtualProbe(pin)) {
+    return true;
+  }
+  return pin.hasCtxGetter && pin.ctxGetter.type != LIVE_VALUE_FLOAT;
+}
+
+// Captured value as a number: integer probes are converted to float.
+inline float liveProbeNumber(const ProbeEntry& pin, LiveValue captured) {
+  return liveIsIntegerProbe(pin)
+             ? static_cast<float>(captured.i)
+             : captured.f;
+}
@@ -0,0 +1,66 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Fixed-point quantization of probe values. A probe declared with a range
+// and a bit depth is sent as the nearest of 2^bits evenly spaced codes:
+//
+//   scale = (maximum - minimum) / (2^bits - 1)
+//   code  = round((value - minimum) / scale), clamped to [0, 2^bits - 1]
+//   value = minimum + code * scale
+//
+// The device and the host receiver share these functions, so both sides
+// round the same way.
+//
+// This file has no Arduino dependency.
+//
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+// Codes are sent as JSON integers of at most 16 bits.
+static const uint8_t LIVE_QUANT_MAX_BITS = 16;
+
+inline uint32_t liveQuantMaxCode(uint8_t bits) {
+  return (1UL << bits) - 1;
+}
+
+inline double liveQuantScale(double minimum, double maximum, uint8_t bits) {
+  return (maximum - minimum) / liveQuantMaxCode(bits);
+}
+
+// NaN is sent as the code of 0, as unquantized virtual floats send 0.
+inline uint32_t liveQuantize(
+    float value,
+    float minimum,
+    float maximum,
+    uint8_t bits) {
+
+  const uint32_t maxCode = liveQuantMaxCode(bits);
+
+  if (isnan(value)) {
+    value = 0.0f;
+  }
+
+  const float position =
+      (value - minimum) * static_cast<float>(maxCode) / (maximum - minimum);
+
+  if (!(position > 0.0f)) {
+    return 0;
+  }
+  if (position >= static_cast<float>(maxCode)) {
+    return maxCode;
+  }
+  return static_cast<uint32_t>(position + 0.5f);
+}
+
+inline double liveDequantize(
+    uint32_t code,
+    double minimum,
+    double maximum,
+    uint8_t bits) {
+
+  return minimum + code * liveQuantScale(minimum, maximum, bits);
+}
@@ -0,0 +1,515 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+
+#include "esp32_live_sensors.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+/* --------------------------------------------------------------------------
+   Register decoding
+   -------------------------------------------------------------------------- */
+
+size_t liveSensorDecodeWidth(LiveSensorDecode decode) {
+  switch (decode) {
+    case LIVE_DECODE_U8:
+    case LIVE_DECODE_S8:
+      return 1;
+    case LIVE_DECODE_U16_BE:
+    case LIVE_DECODE_S16_BE:
+    case LIVE_DECODE_U16_LE:
+    case LIVE_DECODE_S16_LE:
+      return 2;
+    case LIVE_DECODE_U24_BE:
+      return 3;
+    case LIVE_DECODE_U32_BE:
+    case LIVE_DECODE_S32_BE:
+    case LIVE_DECODE_U32_LE:
+    case LIVE_DECODE_S32_LE:
+    case LIVE_DECODE_FLOAT_LE:
+      return 4;
+    case LIVE_DECODE_CUSTOM:
+    default:
+      return 0;
+  }
+}
+
+static uint32_t readBigEndian(const uint8_t* data, size_t width) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < width; ++i) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
+
+static uint32_t readLittleEndian(const uint8_t* data, size_t width) {
+  uint32_t value = 0;
+  for (size_t i = width; i > 0; --i) {
+    value = (value << 8) | data[i - 1];
+  }
+  return value;
+}
+
+float liveSensorDecode(
+    LiveSensorDecode decode,
+    const uint8_t* data) {
+
+  switch (decode) {
+    case LIVE_DECODE_U8:
+      return static_cast<float>(data[0]);
+    case LIVE_DECODE_S8:
+      return static_cast<float>(static_cast<int8_t>(data[0]));
+    case LIVE_DECODE_U16_BE:
+      return static_cast<float>(readBigEndian(data, 2));
+    case LIVE_DECODE_S16_BE:
+      return static_cast<float>(
+          static_cast<int16_t>(readBigEndian(data, 2)));
+    case LIVE_DECODE_U16_LE:
+      return static_cast<float>(readLittleEndian(data, 2));
+    case LIVE_DECODE_S16_LE:
+      return static_cast<float>(
+          static_cast<int16_t>(readLittleEndian(data, 2)));
+    case LIVE_DECODE_U24_BE:
+      return static_cast<float>(readBigEndian(data, 3));
+    case LIVE_DECODE_U32_BE:
+      return static_cast<float>(readBigEndian(data, 4));
+    case LIVE_DECODE_S32_BE:
+      return static_cast<float>(
+          static_cast<int32_t>(readBigEndian(data, 4)));
+    case LIVE_DECODE_U32_LE:
+      return static_cast<float>(readLittleEndian(data, 4));
+    case LIVE_DECODE_S32_LE:
+      return static_cast<float>(
+          static_cast<int32_t>(readLittleEndian(data, 4)));
+    case LIVE_DECODE_FLOAT_LE: {
+      const uint32_t bits = readLittleEndian(data, 4);
+      float value;
+      memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+    case LIVE_DECODE_CUSTOM:
+    default:
+      return NAN;
+  }
+}
+
+/* --------------------------------------------------------------------------
+   Simulated bus
+   -------------------------------------------------------------------------- */
+
+LiveSimulatedBus::Device* LiveSimulatedBus::device(
+    uint8_t address,
+    bool create) {
+
+  for (auto& candidate : devices) {
+    if (candidate.address == address) {
+      return &candidate;
+    }
+  }
+
+  if (!create) {
+    return nullptr;
+  }
+
+  Device added;
+  added.address = address;
+  added.failing = false;
+  memset(added.registers, 0, sizeof(added.registers));
+  devices.push_back(added);
+  return &devices.back();
+}
+
+void LiveSimulatedBus::setRegister(
+    uint8_t address,
+    uint8_t reg,
+    uint8_t value) {
+
+  device(address, true)->registers[reg] = value;
+}
+
+void LiveSimulatedBus::setRegisters(
+    uint8_t address,
+    uint8_t reg,
+    const uint8_t* data,
+    size_t length) {
+
+  Device* target = device(address, true);
+  for (size_t i = 0; i < length && reg + i < sizeof(target->registers); ++i) {
+    target->registers[reg + i] = data[i];
+  }
+}
+
+void LiveSimulatedBus::setFailing(uint8_t address, bool failing) {
+  device(address, true)->failing = failing;
+}
+
+bool LiveSimulatedBus::readRegisters(
+    uint8_t address,
+    uint8_t reg,
+    uint8_t* data,
+    size_t length) {
+
+  ++transactionCount;
+
+  const Device* source = device(address, false);
+  if (source == nullptr ||
+      source->failing ||
+      reg + length > sizeof(source->registers)) {
+    return false;
+  }
+
+  memcpy(data, &source->registers[reg], length);
+  return true;
+}
+
+/* --------------------------------------------------------------------------
+   Scheduler
+   -------------------------------------------------------------------------- */
+
+LiveSensorSlot* LiveSensorScheduler::add(
+    uint16_t id,
+    const LiveSensorRead& read) {
+
+  if (read.bus == nullptr ||
+      read.length == 0 ||
+      read.length > ESP32_LIVE_SENSOR_MAX_BURST ||
+      read.reg + read.length > 256) {
+    return nullptr;
+  }
+
+  if (read.decode == LIVE_DECODE_CUSTOM && read.decoder == nullptr) {
+    return nullptr;
+  }
+
+  size_t index = 0;
+  while (index < slotCount && slots[index].id != id) {
+    ++index;
+  }
+
+  if (index == ESP32_LIVE_MAX_SENSOR_PROBES) {
+    return nullptr;
+  }
+
+  LiveSensorSlot& slot = slots[index];
+  slot.id = id;
+  slot.read = read;
+  if (slot.read.periodMs == 0) {
+    slot.read.periodMs = 1;
+  }
+  slot.value = 0.0f;
+  slot.valid = false;
+  slot.errors = 0;
+
+  if (index == slotCount) {
+    ++slotCount;
+  }
+  planned = false;
+  return &slot;
+}
+
+size_t LiveSensorScheduler::batchCount() {
+  if (!planned) {
+    plan();
+  }
+  return batches.size();
+}
+
+// Sorts the reads by bus, device, period and register, then merges
+// neighbouring reads on one device into a single burst when they share a
+// period, the merged span fits the bus limit and it leaves at most
+// ESP32_LIVE_SENSOR_MAX_GAP unused registers. Reads with different periods
+// stay in separate batches, so no register is polled faster than declared.
+void LiveSensorScheduler::plan() {
+  for (size_t i = 0; i < slotCount; ++i) {
+    order[i] = static_cast<uint8_t>(i);
+  }
+
+  std::sort(order, order + slotCount, [this](uint8_t a, uint8_t b) {
+    const LiveSensorRead& left = slots[a].read;
+    const LiveSensorRead& right = slots[b].read;
+
+    if (left.bus != right.bus) {
+      return left.bus < right.bus;
+    }
+    if (left.address != right.address) {
+      return left.address < right.address;
+    }
+    if (left.periodMs != right.periodMs) {
+      return left.periodMs < right.periodMs;
+    }
+    return left.reg < right.reg;
+  });
+
+  batches.clear();
+
+  for (size_t i = 0; i < slotCount; ++i) {
+    const LiveSensorRead& read = slots[order[i]].read;
+    const size_t readEnd = read.reg + read.length;
+
+    if (!batches.empty()) {
+      Batch& batch = batches.back();
+      const size_t batchEnd = batch.reg + batch.length;
+      const size_t limit = std::min<size_t>(
+          read.bus->maxBurst(), ESP32_LIVE_SENSOR_MAX_BURST);
+      const size_t mergedEnd = std::max(batchEnd, readEnd);
+
+      if (batch.bus == read.bus &&
+          batch.address == read.address &&
+          batch.periodMs == read.periodMs &&
+          read.reg <= batchEnd + ESP32_LIVE_SENSOR_MAX_GAP &&
+          mergedEnd - batch.reg <= limit) {
+        batch.length = static_cast<uint8_t>(mergedEnd - batch.reg);
+        ++batch.count;
+        continue;
+      }
+    }
+
+    Batch batch;
+    batch.bus = read.bus;
+    batch.address = read.address;
+    batch.reg = read.reg;
+    batch.length = read.length;
+    batch.first = static_cast<uint8_t>(i);
+    batch.count = 1;
+    batch.periodMs = read.periodMs;
+    batch.lastRunMs = 0;
+    batch.hasRun = false;
+    batches.push_back(batch);
+  }
+
+  planned = true;
+}
+
+void LiveSensorScheduler::runBatch(const Batch& batch) {
+  uint8_t buffer[ESP32_LIVE_SENSOR_MAX_BURST];
+
+  const bool ok = batch.bus->readRegisters(
+      batch.address, batch.reg, buffer, batch.length);
+
+  for (size_t i = 0; i < batch.count; ++i) {
+    LiveSensorSlot& slot = slots[order[batch.first + i]];
+    const LiveSensorRead& read = slot.read;
+
+    if (!ok) {
+      ++slot.errors;
+      slot.valid = false;
+      continue;
+    }
+
+    const uint8_t* data = &buffer[read.reg - batch.reg];
+    float value;
+
+    if (read.decode == LIVE_DECODE_CUSTOM) {
+      value = read.decoder(data, read.length, read.decoderContext);
+    } else {
+      value = liveSensorDecode(read.decode, data) * read.scale +
+              read.offset;
+    }
+
+    slot.value = value;
+    slot.valid = true;
+  }
+}
+
+uint32_t LiveSensorScheduler::poll(uint32_t nowMs) {
+  if (!planned) {
+    plan();
+  }
+
+  uint32_t waitMs = UINT32_MAX;
+
+  for (auto& batch : batches) {
+    const uint32_t elapsed = nowMs - batch.lastRunMs;
+
+    if (!batch.hasRun || elapsed >= batch.periodMs) {
+      runBatch(batch);
+      batch.lastRunMs = nowMs;
+      batch.hasRun = true;
+      waitMs = std::min(waitMs, batch.periodMs);
+    } else {
+      waitMs = std::min(waitMs, batch.periodMs - elapsed);
+    }
+  }
+
+  return batches.empty() ? 1000 : waitMs;
+}
+
+/* --------------------------------------------------------------------------
+   Arduino bus backends and registration
+   -------------------------------------------------------------------------- */
+
+#if defined(ARDUINO)
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+static LiveSensorScheduler liveSensors;
+static TaskHandle_t sensorTaskHandle = nullptr;
+
+bool LiveI2CBus::readRegisters(
+    uint8_t address,
+    uint8_t reg,
+    uint8_t* data,
+    size_t length) {
+
+  // A repeated start keeps the bus lock between the register write and the
+  // read, so application code sharing the same TwoWire object is safe.
+  wire.beginTransmission(address);
+  wire.write(reg);
+  if (wire.endTransmission(false) != 0) {
+    return false;
+  }
+
+  const size_t received =
+      wire.requestFrom(static_cast<uint16_t>(address), length);
+
+  if (received != length) {
+    return false;
+  }
+
+  for (size_t i = 0; i < length; ++i) {
+    data[i] = static_cast<uint8_t>(wire.read());
+  }
+  return true;
+}
+
+bool LiveSpiBus::readRegisters(
+    uint8_t address,
+    uint8_t reg,
+    uint8_t* data,
+    size_t length) {
+
+  if (!isRealGpio(address)) {
+    return false;
+  }
+
+  const uint64_t pinMask = 1ULL << address;
+  if ((configuredPins & pinMask) == 0) {
+    pinMode(address, OUTPUT);
+    digitalWrite(address, HIGH);
+    configuredPins |= pinMask;
+  }
+
+  memset(data, 0, length);
+
+  spi.beginTransaction(settings);
+  digitalWrite(address, LOW);
+  spi.transfer(static_cast<uint8_t>(reg | readFlag));
+  spi.transfer(data, static_cast<uint32_t>(length));
+  digitalWrite(address, HIGH);
+  spi.endTransaction();
+  return true;
+}
+
+static float readSensorSlot(void* context) {
+  const LiveSensorSlot* slot = static_cast<const LiveSensorSlot*>(context);
+  return slot->valid ? slot->value : NAN;
+}
+
+static void addSensorProbe(
+    uint16_t n,
+    const char* name,
+    const LiveSensorRead& read) {
+
+  if (n < 100 || n > 255) {
+    return;
+  }
+
+  // The sensor task plans and polls the slots without a lock, so the
+  // scheduler is only changed before it starts.
+  if (liveRejectLateProbe(static_cast<uint8_t>(n))) {
+    return;
+  }
+
+  LiveSensorSlot* slot = liveSensors.add(n, read);
+  if (slot == nullptr) {
+    return;
+  }
+
+  esp32_live_probe_getter(n, name, readSensorSlot, slot);
+}
+
+void esp32_live_probe_sensor(
+    uint16_t n,
+    const char* name,
+    LiveSensorBus& bus,
+    uint8_t address,
+    uint8_t reg,
+    LiveSensorDecode decode,
+    float scale,
+    float offset,
+    uint32_t periodMs) {
+
+  LiveSensorRead read;
+  read.bus = &bus;
+  read.address = address;
+  read.reg = reg;
+  read.length = static_cast<uint8_t>(liveSensorDecodeWidth(decode));
+  read.decode = decode;
+  read.scale = scale;
+  read.offset = offset;
+  read.decoder = nullptr;
+  read.decoderContext = nullptr;
+  read.periodMs = periodMs;
+  addSensorProbe(n, name, read);
+}
+
+void esp32_live_probe_sensor(
+    uint16_t n,
+    const char* name,
+    LiveSensorBus& bus,
+    uint8_t address,
+    uint8_t reg,
+    uint8_t length,
+    LiveSensorDecoder decoder,
+    void* context,
+    uint32_t periodMs) {
+
+  LiveSensorRead read;
+  read.bus = &bus;
+  read.address = address;
+  read.reg = reg;
+  read.length = length;
+  read.decode = LIVE_DECODE_CUSTOM;
+  read.scale = 1.0f;
+  read.offset = 0.0f;
+  read.decoder = decoder;
+  read.decoderContext = context;
+  read.periodMs = periodMs;
+  addSensorProbe(n, name, read);
+}
+
+static void esp32LiveSensorTask(void*) {
+  while (true) {
+    const uint32_t waitMs = liveSensors.poll(millis());
+
+    TickType_t waitTicks = pdMS_TO_TICKS(waitMs);
+    if (waitTicks < 1) {
+      waitTicks = 1;
+    }
+
+    vTaskDelay(waitTicks);
+  }
+}
+
+// Called from esp32_live_begin(). Sensor probes must therefore be registered
+// before esp32_live_begin(), like every other probe.
+void esp32_live_sensors_start() {
+  if (sensorTaskHandle != nullptr || liveSensors.size() == 0) {
+    return;
+  }
+
+  xTaskCreate(
+      esp32LiveSensorTask,
+      "esp32_live_bus",
+      ESP32_LIVE_SENSOR_STACK,
+      nullptr,
+      1,
+      &sensorTaskHandle);
+}
+
+#endif
@@ -0,0 +1,275 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Sensor probes: register reads on I2C or SPI devices that are declared once
+// and polled by the library in its own FreeRTOS task. Reads on the same
+// device are merged into burst transactions.
+//
+// The scheduler and the simulated bus do not depend on Arduino and can be
+// compiled on a Linux host.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/* --------------------------------------------------------------------------
+   Configuration
+   -------------------------------------------------------------------------- */
+
+#ifndef ESP32_LIVE_MAX_SENSOR_PROBES
+#define ESP32_LIVE_MAX_SENSOR_PROBES 32
+#endif
+
+// Longest burst transaction issued by the scheduler. Individual buses may
+// report a lower limit through LiveSensorBus::maxBurst().
+#ifndef ESP32_LIVE_SENSOR_MAX_BURST
+#define ESP32_LIVE_SENSOR_MAX_BURST 32
+#endif
+
+// Unused registers tolerated between two reads merged into one burst.
+#ifndef ESP32_LIVE_SENSOR_MAX_GAP
+#define ESP32_LIVE_SENSOR_MAX_GAP 4
+#endif
+
+// Stack of the esp32_live_bus task that polls the sensors.
+#ifndef ESP32_LIVE_SENSOR_STACK
+#define ESP32_LIVE_SENSOR_STACK 3072
+#endif
+
+/* --------------------------------------------------------------------------
+   Register decoding
+   -------------------------------------------------------------------------- */
+
+enum LiveSensorDecode : uint8_t {
+  LIVE_DECODE_U8 = 0,
+  LIVE_DECODE_S8,
+  LIVE_DECODE_U16_BE,
+  LIVE_DECODE_S16_BE,
+  LIVE_DECODE_U16_LE,
+  LIVE_DECODE_S16_LE,
+  LIVE_DECODE_U24_BE,
+  LIVE_DECODE_U32_BE,
+  LIVE_DECODE_S32_BE,
+  LIVE_DECODE_U32_LE,
+  LIVE_DECODE_S32_LE,
+  LIVE_DECODE_FLOAT_LE,
+  LIVE_DECODE_CUSTOM
+};
+
+// Decoder for registers that need more than a fixed-width conversion.
+typedef float (*LiveSensorDecoder)(
+    const uint8_t* data,
+    size_t length,
+    void* context);
+
+// Number of bytes consumed by a fixed-width decode, or 0 for custom decoders.
+size_t liveSensorDecodeWidth(LiveSensorDecode decode);
+
+float liveSensorDecode(
+    LiveSensorDecode decode,
+    const uint8_t* data);
+
+/* --------------------------------------------------------------------------
+   Bus backends
+   -------------------------------------------------------------------------- */
+
+class LiveSensorBus {
+public:
+  virtual ~LiveSensorBus() {}
+
+  // Reads length consecutive registers starting at reg. For SPI buses the
+  // address selects the chip-select pin. Returns false on a bus error.
+  virtual bool readRegisters(
+      uint8_t address,
+      uint8_t reg,
+      uint8_t* data,
+      size_t length) = 0;
+
+  virtual size_t maxBurst() const {
+    return ESP32_LIVE_SENSOR_MAX_BURST;
+  }
+};
+
+// In-memory register images for host builds and bench testing. Each
+// readRegisters() call counts as one transaction.
+class LiveSimulatedBus : public LiveSensorBus {
+public:
+  void setRegister(uint8_t address, uint8_t reg, uint8_t value);
+  void setRegisters(
+      uint8_t address,
+      uint8_t reg,
+      const uint8_t* data,
+      size_t length);
+
+  // Makes every transaction to address fail until cleared.
+  void setFailing(uint8_t address, bool failing);
+
+  uint32_t transactions() const {
+    return transactionCount;
+  }
+
+  bool readRegisters(
+      uint8_t address,
+      uint8_t reg,
+      uint8_t* data,
+      size_t length) override;
+
+private:
+  struct Device {
+    uint8_t address;
+    bool failing;
+    uint8_t registers[256];
+  };
+
+  Device* device(uint8_t address, bool create);
+
+  std::vector<Device> devices;
+  uint32_t transactionCount = 0;
+};
+
+/* --------------------------------------------------------------------------
+   Scheduler
+   -------------------------------------------------------------------------- */
+
+struct LiveSensorRead {
+  LiveSensorBus* bus;
+  uint8_t address;
+  uint8_t reg;
+  uint8_t length;
+  LiveSensorDecode decode;
+  float scale;
+  float offset;
+  LiveSensorDecoder decoder;
+  void* decoderContext;
+  uint32_t periodMs;
+};
+
+// Latest decoded value of one sensor read. value is written by the bus task
+// and read by the sampler; a 32-bit float store is atomic on ESP32 targets.
+struct LiveSensorSlot {
+  uint16_t id;
+  LiveSensorRead read;
+  volatile float value;
+  volatile bool valid;
+  uint32_t errors;
+};
+
+class LiveSensorScheduler {
+public:
+  // Returns the slot that receives the decoded value, or nullptr when the
+  // read is invalid or all ESP32_LIVE_MAX_SENSOR_PROBES slots are used.
+  // Adding an id again replaces the read of its slot.
+  LiveSensorSlot* add(uint16_t id, const LiveSensorRead& read);
+
+  size_t size() const {
+    return slotCount;
+  }
+
+  size_t batchCount();
+
+  // Runs every batch that is due at nowMs and returns the number of
+  // milliseconds until the next batch is due.
+  uint32_t poll(uint32_t nowMs);
+
+private:
+  struct Batch {
+    LiveSensorBus* bus;
+    uint8_t address;
+    uint8_t reg;
+    uint8_t length;
+    uint8_t first;
+    uint8_t count;
+    uint32_t periodMs;
+    uint32_t lastRunMs;
+    bool hasRun;
+  };
+
+  void plan();
+  void runBatch(const Batch& batch);
+
+  LiveSensorSlot slots[ESP32_LIVE_MAX_SENSOR_PROBES];
+  uint8_t order[ESP32_LIVE_MAX_SENSOR_PROBES];
+  size_t slotCount = 0;
+  std::vector<Batch> batches;
+  bool planned = false;
+};
+
+/* --------------------------------------------------------------------------
+   Arduino bus backends and registration
+   -------------------------------------------------------------------------- */
+
+#if defined(ARDUINO)
+
+#include <Wire.h>
+#include <SPI.h>
+
+class LiveI2CBus : public LiveSensorBus {
+public:
+  explicit LiveI2CBus(TwoWire& wire) : wire(wire) {}
+
+  bool readRegisters(
+      uint8_t address,
+      uint8_t reg,
+      uint8_t* data,
+      size_t length) override;
+
+private:
+  TwoWire& wire;
+};
+
+// The address passed to readRegisters() is the chip-select GPIO. readFlag is
+// OR-ed into the register byte, 0x80 for most SPI sensors.
+class LiveSpiBus : public LiveSensorBus {
+public:
+  LiveSpiBus(
+      SPIClass& spi,
+      const SPISettings& settings,
+      uint8_t readFlag = 0x80)
+      : spi(spi), settings(settings), readFlag(readFlag) {}
+
+  bool readRegisters(
+      uint8_t address,
+      uint8_t reg,
+      uint8_t* data,
+      size_t length) override;
+
+private:
+  SPIClass& spi;
+  SPISettings settings;
+  uint8_t readFlag;
+  uint64_t configuredPins = 0;
+};
+
+// Monitor a register read performed by the library's bus task. The probe
+// shows the latest decoded value multiplied by scale plus offset.
+void esp32_live_probe_sensor(
+    uint16_t n,
+    const char* name,
+    LiveSensorBus& bus,
+    uint8_t address,
+    uint8_t reg,
+    LiveSensorDecode decode,
+    float scale = 1.0f,
+    float offset = 0.0f,
+    uint32_t periodMs = 100);
+
+// Monitor a register block decoded by a user function.
+void esp32_live_probe_sensor(
+    uint16_t n,
+    const char* name,
+    LiveSensorBus& bus,
+    uint8_t address,
+    uint8_t reg,
+    uint8_t length,
+    LiveSensorDecoder decoder,
+    void* context = nullptr,
+    uint32_t periodMs = 100);
+
+void esp32_live_sensors_start();
+
+#endif
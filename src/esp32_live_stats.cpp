@@ -0,0 +1,197 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Link telemetry. Counters are collected from the Bluetooth stack callbacks
+// and the acquisition stage, and published periodically as a stats frame on
+// the events characteristic. Together with sample_id gaps they show whether
+// a throughput problem comes from the radio link, the phone or the sampling
+// budget on the device.
+//
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+#include <esp_timer.h>
+
+/* --------------------------------------------------------------------------
+   Counters
+   -------------------------------------------------------------------------- */
+
+// Written by the stack task, the acquisition stage and the background task.
+// Every field is a single 32-bit or smaller word, so readers see whole
+// values; a stats frame is not required to be an atomic snapshot.
+static volatile LiveLinkStats linkStats;
+
+#if defined(CONFIG_BLUEDROID_ENABLED)
+static esp_bd_addr_t peerAddress;
+#endif
+static volatile uint16_t peerConnId = 0;
+static volatile bool peerKnown = false;
+static int64_t lastStatsUs = 0;
+
+static void resetCounters() {
+  linkStats.rssi = 0;
+  linkStats.connIntervalUs = 0;
+  linkStats.connLatency = 0;
+  linkStats.supervisionTimeoutMs = 0;
+  linkStats.notifyOk = 0;
+  linkStats.notifyFailed = 0;
+  linkStats.congestionEvents = 0;
+  linkStats.congested = false;
+  linkStats.txBuffersFree = 0;
+  linkStats.captureDrops = 0;
+}
+
+/* --------------------------------------------------------------------------
+   Stack and pipeline hooks
+   -------------------------------------------------------------------------- */
+
+#if defined(CONFIG_BLUEDROID_ENABLED)
+
+static void storeConnParams(
+    uint16_t interval,
+    uint16_t latency,
+    uint16_t timeout) {
+
+  // Interval in units of 1.25 ms, supervision timeout in units of 10 ms.
+  linkStats.connIntervalUs = static_cast<uint32_t>(interval) * 1250;
+  linkStats.connLatency = latency;
+  linkStats.supervisionTimeoutMs = static_cast<uint32_t>(timeout) * 10;
+}
+
+void liveStatsConnected(esp_ble_gatts_cb_param_t* param) {
+  resetCounters();
+
+  memcpy(peerAddress, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+  peerConnId = param->connect.conn_id;
+  peerKnown = true;
+
+  storeConnParams(
+      param->connect.conn_params.interval,
+      param->connect.conn_params.latency,
+      param->connect.conn_params.timeout);
+}
+
+void liveStatsGapEvent(
+    esp_gap_ble_cb_event_t event,
+    esp_ble_gap_cb_param_t* param) {
+
+  if (event == ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT) {
+    if (param->read_rssi_cmpl.status == 0) {
+      linkStats.rssi = param->read_rssi_cmpl.rssi;
+    }
+    return;
+  }
+
+  if (event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT &&
+      param->update_conn_params.status == 0) {
+    storeConnParams(
+        param->update_conn_params.conn_int,
+        param->update_conn_params.latency,
+        param->update_conn_params.timeout);
+  }
+}
+
+// ESP_GATTS_CONGEST_EVT means the controller ran out of transmit buffers:
+// notifications sent while congested are dropped by the stack.
+void liveStatsGattsEvent(
+    esp_gatts_cb_event_t event,
+    esp_ble_gatts_cb_param_t* param) {
+
+  if (event != ESP_GATTS_CONGEST_EVT) {
+    return;
+  }
+
+  if (param->congest.congested && !linkStats.congested) {
+    linkStats.congestionEvents = linkStats.congestionEvents + 1;
+  }
+  linkStats.congested = param->congest.congested;
+}
+
+#endif
+
+void liveStatsDisconnected() {
+  peerKnown = false;
+}
+
+void liveStatsNotifyStatus(bool sent) {
+  if (sent) {
+    linkStats.notifyOk = linkStats.notifyOk + 1;
+  } else {
+    linkStats.notifyFailed = linkStats.notifyFailed + 1;
+  }
+}
+
+void liveStatsCaptureDropped() {
+  linkStats.captureDrops = linkStats.captureDrops + 1;
+}
+
+/* --------------------------------------------------------------------------
+   Stats frame
+   -------------------------------------------------------------------------- */
+
+void liveStatsService() {
+  if (ESP32_LIVE_STATS_INTERVAL_MS == 0 || !peerKnown) {
+    return;
+  }
+
+  const int64_t nowUs = esp_timer_get_time();
+  if (nowUs - lastStatsUs <
+      static_cast<int64_t>(ESP32_LIVE_STATS_INTERVAL_MS) * 1000LL) {
+    return;
+  }
+  lastStatsUs = nowUs;
+
+#if defined(CONFIG_BLUEDROID_ENABLED)
+  linkStats.txBuffersFree = esp_ble_get_cur_sendable_packets_num(peerConnId);
+
+  // The result arrives asynchronously and is reported in the next frame.
+  esp_ble_gap_read_rssi(peerAddress);
+#endif
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+  JsonDocument document;
+#else
+  StaticJsonDocument<384> document;
+#endif
+
+  // Copied out of the volatile counters before formatting.
+  LiveLinkStats stats;
+  esp32_live_link_stats(stats);
+
+  JsonObject object = document.to<JsonObject>();
+  object["ver"] = ESP32_LIVE_VERSION;
+  object["event"] = "stats";
+  object["timestamp"] = liveNowMs();
+  object["rssi"] = stats.rssi;
+  object["interval_us"] = stats.connIntervalUs;
+  object["latency"] = stats.connLatency;
+  object["timeout_ms"] = stats.supervisionTimeoutMs;
+  object["mtu"] = liveNegotiatedMtu();
+  object["notify_ok"] = stats.notifyOk;
+  object["notify_failed"] = stats.notifyFailed;
+  object["congestion"] = stats.congestionEvents;
+  object["congested"] = stats.congested;
+  object["tx_free"] = stats.txBuffersFree;
+  object["capture_drops"] = stats.captureDrops;
+
+  liveSendEvent(object);
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+void esp32_live_link_stats(LiveLinkStats& stats) {
+  stats.rssi = linkStats.rssi;
+  stats.connIntervalUs = linkStats.connIntervalUs;
+  stats.connLatency = linkStats.connLatency;
+  stats.supervisionTimeoutMs = linkStats.supervisionTimeoutMs;
+  stats.notifyOk = linkStats.notifyOk;
+  stats.notifyFailed = linkStats.notifyFailed;
+  stats.congestionEvents = linkStats.congestionEvents;
+  stats.congested = linkStats.congested;
+  stats.txBuffersFree = linkStats.txBuffersFree;
+  stats.captureDrops = linkStats.captureDrops;
+}
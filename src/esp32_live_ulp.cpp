@@ -0,0 +1,487 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Deep-sleep sampling with the ULP-FSM coprocessor. While the main CPU is in
+// deep sleep, a small ULP program samples RTC GPIO levels and one ADC1
+// channel into RTC slow memory. The main CPU wakes when the buffer is full,
+// when an ADC threshold is crossed or when the sleep timer expires, uploads
+// the batch over BLE and goes back to sleep.
+//
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+
+#include <atomic>
+
+#if defined(CONFIG_ULP_COPROC_ENABLED) && \
+    defined(CONFIG_ULP_COPROC_TYPE_FSM) && \
+    (LIVE_TARGET_CLASSIC_ESP32 || LIVE_TARGET_S3)
+#define LIVE_ULP_SUPPORTED 1
+#else
+#define LIVE_ULP_SUPPORTED 0
+#endif
+
+#if LIVE_ULP_SUPPORTED
+
+#include <driver/rtc_io.h>
+#include <esp_adc/adc_oneshot.h>
+#include <soc/rtc_cntl_reg.h>
+#include <soc/rtc_io_reg.h>
+#include <soc/soc.h>
+#include <ulp_adc.h>
+
+#if LIVE_TARGET_S3
+#include <esp32s3/ulp.h>
+#else
+#include <esp32/ulp.h>
+#endif
+
+/* --------------------------------------------------------------------------
+   State retained in RTC slow memory
+   -------------------------------------------------------------------------- */
+
+// Every ULP word holds a 16-bit value in its lower half; the ULP writes its
+// program counter into the upper half.
+RTC_SLOW_ATTR static uint32_t ulpRecords[ESP32_LIVE_ULP_BUFFER_WORDS];
+
+// ulpControl[0] is the ULP word address of the next record.
+RTC_SLOW_ATTR static uint32_t ulpControl[1];
+
+RTC_DATA_ATTR static uint8_t ulpProbeNums[ESP32_LIVE_ULP_MAX_PROBES];
+RTC_DATA_ATTR static uint8_t ulpProbeCount = 0;
+RTC_DATA_ATTR static uint32_t ulpPeriodMs = 0;
+RTC_DATA_ATTR static uint32_t ulpFirstSampleId = 0;
+RTC_DATA_ATTR static uint64_t ulpSleepStartLiveMs = 0;
+RTC_DATA_ATTR static int64_t ulpSleepStartRtcUs = 0;
+RTC_DATA_ATTR static bool ulpArmed = false;
+
+/* --------------------------------------------------------------------------
+   Probe selection for the next sleep
+   -------------------------------------------------------------------------- */
+
+struct UlpProbe {
+  uint8_t gpio;
+  bool adc;
+  adc_channel_t channel;
+  uint16_t wakeAbove;
+  uint16_t wakeBelow;
+};
+
+static UlpProbe ulpProbes[ESP32_LIVE_ULP_MAX_PROBES];
+static size_t ulpSelected = 0;
+static bool ulpRestored = false;
+
+// esp32_live_ulp_upload() hands the batch to the background task, which
+// owns the notify characteristic, and waits for the outcome.
+enum UlpUpload : uint8_t {
+  ULP_UPLOAD_IDLE,
+  ULP_UPLOAD_REQUESTED,
+  ULP_UPLOAD_RUNNING,
+  ULP_UPLOAD_DONE,
+  ULP_UPLOAD_FAILED
+};
+
+static std::atomic<uint8_t> ulpUploadState{ULP_UPLOAD_IDLE};
+
+static uint32_t ulpAddress(const volatile void* pointer) {
+  return static_cast<uint32_t>(
+      (reinterpret_cast<uintptr_t>(pointer) - SOC_RTC_DATA_LOW) / 4);
+}
+
+static int64_t rtcTimeUs() {
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  return static_cast<int64_t>(now.tv_sec) * 1000000LL + now.tv_usec;
+}
+
+// After a wake from ULP deep sleep, continue the timestamps and snapshot
+// identifiers of the previous session instead of restarting at zero.
+static void restoreSession() {
+  if (ulpRestored) {
+    return;
+  }
+  ulpRestored = true;
+
+  // Stop the ULP timer so the program cannot append records while the batch
+  // is being uploaded.
+  CLEAR_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_ULP_CP_SLP_TIMER_EN);
+
+  // Return the sampled pins to the digital GPIO matrix so digitalRead()
+  // works again while awake.
+  for (size_t i = 0; i < ulpProbeCount && i < ESP32_LIVE_ULP_MAX_PROBES; ++i) {
+    rtc_gpio_deinit(static_cast<gpio_num_t>(ulpProbeNums[i]));
+  }
+
+  const esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  if (!ulpArmed ||
+      (cause != ESP_SLEEP_WAKEUP_ULP && cause != ESP_SLEEP_WAKEUP_TIMER)) {
+    ulpArmed = false;
+    return;
+  }
+
+  const int64_t sleptMs = (rtcTimeUs() - ulpSleepStartRtcUs) / 1000LL;
+  const int64_t bootMs = esp_timer_get_time() / 1000LL;
+  liveSetClockOffsetMs(
+      static_cast<int64_t>(ulpSleepStartLiveMs) + sleptMs - bootMs);
+
+  liveReserveSampleIds(
+      ulpFirstSampleId + static_cast<uint32_t>(esp32_live_ulp_pending()));
+}
+
+static bool selectProbe(
+    uint8_t gpio,
+    bool adc,
+    uint16_t wakeAbove,
+    uint16_t wakeBelow) {
+
+  restoreSession();
+
+  if (ulpSelected >= ESP32_LIVE_ULP_MAX_PROBES ||
+      !rtc_gpio_is_valid_gpio(static_cast<gpio_num_t>(gpio))) {
+    return false;
+  }
+
+  UlpProbe probe;
+  probe.gpio = gpio;
+  probe.adc = adc;
+  probe.channel = ADC_CHANNEL_0;
+  probe.wakeAbove = wakeAbove;
+  probe.wakeBelow = wakeBelow;
+
+  if (adc) {
+    adc_unit_t unit;
+    if (adc_oneshot_io_to_channel(gpio, &unit, &probe.channel) != ESP_OK ||
+        unit != ADC_UNIT_1) {
+      return false;
+    }
+
+    // ulp_adc_init() claims ADC1 for the ULP, so only one channel is
+    // supported per sleep cycle.
+    for (size_t i = 0; i < ulpSelected; ++i) {
+      if (ulpProbes[i].adc) {
+        return false;
+      }
+    }
+  }
+
+  ulpProbes[ulpSelected++] = probe;
+
+  esp32_live_register_pin(
+      gpio,
+      adc ? "ANALOG" : "DIGITAL",
+      "IN",
+      nullptr);
+  return true;
+}
+
+/* --------------------------------------------------------------------------
+   ULP program
+   -------------------------------------------------------------------------- */
+
+enum : uint32_t {
+  LABEL_WAKE = 1
+};
+
+static bool loadProgram(size_t recordWords, uint32_t recordsBase) {
+  const uint32_t end =
+      recordsBase +
+      static_cast<uint32_t>(
+          (ESP32_LIVE_ULP_BUFFER_WORDS / recordWords) * recordWords);
+
+  ulp_insn_t program[16 + ESP32_LIVE_ULP_MAX_PROBES * 5];
+  size_t count = 0;
+
+  // R1 = write pointer, R2 = start of the record written in this run.
+  program[count++] = I_MOVI(R3, ulpAddress(ulpControl));
+  program[count++] = I_LD(R1, R3, 0);
+  program[count++] = I_MOVR(R2, R1);
+
+  for (size_t i = 0; i < ulpSelected; ++i) {
+    const UlpProbe& probe = ulpProbes[i];
+
+    if (probe.adc) {
+      program[count++] = I_ADC(R0, 0, probe.channel);
+    } else {
+      const int rtcio =
+          rtc_io_number_get(static_cast<gpio_num_t>(probe.gpio));
+      program[count++] = I_RD_REG(
+          RTC_GPIO_IN_REG,
+          RTC_GPIO_IN_NEXT_S + rtcio,
+          RTC_GPIO_IN_NEXT_S + rtcio);
+    }
+
+    program[count++] = I_ST(R0, R1, i);
+  }
+
+  program[count++] = I_ADDI(R1, R1, recordWords);
+  program[count++] = I_ST(R1, R3, 0);
+
+  for (size_t i = 0; i < ulpSelected; ++i) {
+    const UlpProbe& probe = ulpProbes[i];
+
+    if (!probe.adc || (probe.wakeAbove == 0 && probe.wakeBelow == 0)) {
+      continue;
+    }
+
+    program[count++] = I_LD(R0, R2, i);
+    if (probe.wakeAbove != 0) {
+      program[count++] = M_BGE(LABEL_WAKE, probe.wakeAbove);
+    }
+    if (probe.wakeBelow != 0) {
+      program[count++] = M_BL(LABEL_WAKE, probe.wakeBelow);
+    }
+  }
+
+  // Wake the main CPU once no further record fits.
+  program[count++] = I_MOVR(R0, R1);
+  program[count++] = M_BGE(LABEL_WAKE, end);
+  program[count++] = I_HALT();
+
+  program[count++] = M_LABEL(LABEL_WAKE);
+  program[count++] = I_WAKE();
+  program[count++] = I_END();
+  program[count++] = I_HALT();
+
+  size_t size = count;
+  return ulp_process_macros_and_load(0, program, &size) == ESP_OK;
+}
+
+static bool initAdc() {
+  for (size_t i = 0; i < ulpSelected; ++i) {
+    if (!ulpProbes[i].adc) {
+      continue;
+    }
+
+    ulp_adc_cfg_t config = {};
+    config.adc_n = ADC_UNIT_1;
+    config.channel = ulpProbes[i].channel;
+    config.width = ADC_BITWIDTH_DEFAULT;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+    config.atten = ADC_ATTEN_DB_12;
+#else
+    config.atten = ADC_ATTEN_DB_11;
+#endif
+    config.ulp_mode = ADC_ULP_MODE_FSM;
+
+    if (ulp_adc_init(&config) != ESP_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void initGpio() {
+  for (size_t i = 0; i < ulpSelected; ++i) {
+    if (ulpProbes[i].adc) {
+      continue;
+    }
+
+    const gpio_num_t gpio = static_cast<gpio_num_t>(ulpProbes[i].gpio);
+    rtc_gpio_init(gpio);
+    rtc_gpio_set_direction(gpio, RTC_GPIO_MODE_INPUT_ONLY);
+  }
+}
+
+/* --------------------------------------------------------------------------
+   Upload
+   -------------------------------------------------------------------------- */
+
+static bool uploadRecords() {
+  const size_t records = esp32_live_ulp_pending();
+
+  uint16_t indices[ESP32_LIVE_ULP_MAX_PROBES];
+  for (size_t i = 0; i < ulpProbeCount; ++i) {
+    const int index = liveFindProbeIndex(ulpProbeNums[i]);
+    if (index < 0) {
+      return false;
+    }
+    indices[i] = static_cast<uint16_t>(index);
+  }
+
+  LiveValue values[ESP32_LIVE_ULP_MAX_PROBES];
+
+  for (size_t record = 0; record < records; ++record) {
+    for (size_t i = 0; i < ulpProbeCount; ++i) {
+      values[i].i = static_cast<int32_t>(
+          ulpRecords[record * ulpProbeCount + i] & 0xFFFF);
+    }
+
+    const bool sent = liveSendProbeValues(
+        ulpFirstSampleId + static_cast<uint32_t>(record),
+        ulpSleepStartLiveMs + record * ulpPeriodMs,
+        indices,
+        values,
+        ulpProbeCount,
+        "ulp",
+        nullptr);
+
+    if (!sent) {
+      return false;
+    }
+
+    delay(ESP32_LIVE_UPLOAD_PACING_MS);
+  }
+
+  ulpArmed = false;
+  return true;
+}
+
+#endif
+
+void liveUlpService() {
+#if LIVE_ULP_SUPPORTED
+  uint8_t expected = ULP_UPLOAD_REQUESTED;
+  if (!ulpUploadState.compare_exchange_strong(expected, ULP_UPLOAD_RUNNING)) {
+    return;
+  }
+
+  ulpUploadState.store(uploadRecords() ? ULP_UPLOAD_DONE : ULP_UPLOAD_FAILED);
+#endif
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+bool esp32_live_ulp_probe_gpio(uint8_t gpio) {
+#if LIVE_ULP_SUPPORTED
+  return selectProbe(gpio, false, 0, 0);
+#else
+  (void)gpio;
+  return false;
+#endif
+}
+
+bool esp32_live_ulp_probe_adc(
+    uint8_t gpio,
+    uint16_t wakeAbove,
+    uint16_t wakeBelow) {
+
+#if LIVE_ULP_SUPPORTED
+  return selectProbe(gpio, true, wakeAbove, wakeBelow);
+#else
+  (void)gpio;
+  (void)wakeAbove;
+  (void)wakeBelow;
+  return false;
+#endif
+}
+
+size_t esp32_live_ulp_pending() {
+#if LIVE_ULP_SUPPORTED
+  if (!ulpArmed || ulpProbeCount == 0) {
+    return 0;
+  }
+
+  const uint32_t base = ulpAddress(ulpRecords);
+  const uint32_t next = ulpControl[0] & 0xFFFF;
+
+  if (next <= base) {
+    return 0;
+  }
+
+  const size_t records = (next - base) / ulpProbeCount;
+  const size_t capacity = ESP32_LIVE_ULP_BUFFER_WORDS / ulpProbeCount;
+  return records < capacity ? records : capacity;
+#else
+  return 0;
+#endif
+}
+
+bool esp32_live_ulp_upload(uint32_t timeoutMs) {
+#if LIVE_ULP_SUPPORTED
+  restoreSession();
+
+  if (esp32_live_ulp_pending() == 0) {
+    return true;
+  }
+
+  const uint32_t startedAt = millis();
+  while (!liveClientSubscribed()) {
+    if (millis() - startedAt >= timeoutMs) {
+      return false;
+    }
+    delay(20);
+  }
+
+  ulpUploadState.store(ULP_UPLOAD_REQUESTED);
+
+  while (true) {
+    const uint8_t state = ulpUploadState.load();
+
+    if (state == ULP_UPLOAD_DONE || state == ULP_UPLOAD_FAILED) {
+      ulpUploadState.store(ULP_UPLOAD_IDLE);
+      return state == ULP_UPLOAD_DONE;
+    }
+
+    // Only a request the task has not picked up yet is withdrawn. An upload
+    // that has started is waited for, so the records are not overwritten by
+    // the next sleep while they are being sent.
+    uint8_t requested = ULP_UPLOAD_REQUESTED;
+    if (millis() - startedAt >= timeoutMs &&
+        ulpUploadState.compare_exchange_strong(
+            requested, ULP_UPLOAD_IDLE)) {
+      return false;
+    }
+
+    delay(20);
+  }
+#else
+  (void)timeoutMs;
+  return true;
+#endif
+}
+
+void esp32_live_ulp_sleep(uint32_t samplePeriodMs, uint32_t maxSleepMs) {
+#if LIVE_ULP_SUPPORTED
+  restoreSession();
+
+  if (ulpSelected == 0 || samplePeriodMs == 0) {
+    return;
+  }
+
+  if (!initAdc()) {
+    return;
+  }
+  initGpio();
+
+  const uint32_t base = ulpAddress(ulpRecords);
+  ulpControl[0] = base;
+
+  if (!loadProgram(ulpSelected, base)) {
+    return;
+  }
+
+  ulpProbeCount = static_cast<uint8_t>(ulpSelected);
+  for (size_t i = 0; i < ulpSelected; ++i) {
+    ulpProbeNums[i] = ulpProbes[i].gpio;
+  }
+
+  ulpPeriodMs = samplePeriodMs;
+  ulpFirstSampleId = liveReserveSampleIds(0);
+  ulpSleepStartLiveMs = liveNowMs();
+  ulpSleepStartRtcUs = rtcTimeUs();
+  ulpArmed = true;
+
+  ulp_set_wakeup_period(0, samplePeriodMs * 1000UL);
+  esp_sleep_enable_ulp_wakeup();
+  if (maxSleepMs > 0) {
+    esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(maxSleepMs) * 1000ULL);
+  }
+
+  if (ulp_run(0) != ESP_OK) {
+    ulpArmed = false;
+    return;
+  }
+
+  esp_deep_sleep_start();
+#else
+  (void)samplePeriodMs;
+  (void)maxSleepMs;
+#endif
+}
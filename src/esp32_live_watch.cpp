@@ -0,0 +1,389 @@
+//
+// ESP32 Live
+// Version 1.7.2
+//
+// Write watch for virtual probes. The Debug Assistant region monitor of the
+// ESP32-S3 and ESP32-C3 raises an interrupt on every CPU write to a watched
+// variable and latches the program counter of the writing instruction. The
+// interrupt queues the new value with its timestamp and PC, and the
+// background task streams the queue on the events characteristic.
+//
+// Xtensa and RISC-V debug watchpoints are not used: in ESP-IDF a watchpoint
+// hit is a fatal debug exception, not an event the application can handle.
+//
+
+#include "esp32_live.h"
+#include "esp32_live_internal.h"
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32C3)
+#define LIVE_WATCH_SUPPORTED 1
+#else
+#define LIVE_WATCH_SUPPORTED 0
+#endif
+
+#if LIVE_WATCH_SUPPORTED
+
+#include <atomic>
+
+#include <esp_intr_alloc.h>
+#include <esp_memory_utils.h>
+#include <esp_timer.h>
+#include <esp_private/periph_ctrl.h>
+#include "soc/assist_debug_reg.h"
+#include "soc/periph_defs.h"
+
+/* --------------------------------------------------------------------------
+   Region monitor registers
+   -------------------------------------------------------------------------- */
+
+// Each core has its own monitor, so a variable is armed on every core to
+// catch writes from tasks pinned anywhere.
+static const size_t WATCH_SLOTS = 2;
+
+struct WatchCoreRegs {
+  uint32_t enable;
+  uint32_t raw;
+  uint32_t interruptEnable;
+  uint32_t clear;
+  uint32_t pc;
+  uint32_t min[WATCH_SLOTS];
+  uint32_t max[WATCH_SLOTS];
+};
+
+static DRAM_ATTR const WatchCoreRegs watchCores[] = {
+  {
+    ASSIST_DEBUG_CORE_0_MONTR_ENA_REG,
+    ASSIST_DEBUG_CORE_0_INTR_RAW_REG,
+    ASSIST_DEBUG_CORE_0_INTR_ENA_REG,
+    ASSIST_DEBUG_CORE_0_INTR_CLR_REG,
+    ASSIST_DEBUG_CORE_0_AREA_PC_REG,
+    {
+      ASSIST_DEBUG_CORE_0_AREA_DRAM0_0_MIN_REG,
+      ASSIST_DEBUG_CORE_0_AREA_DRAM0_1_MIN_REG
+    },
+    {
+      ASSIST_DEBUG_CORE_0_AREA_DRAM0_0_MAX_REG,
+      ASSIST_DEBUG_CORE_0_AREA_DRAM0_1_MAX_REG
+    }
+  },
+#if SOC_CPU_CORES_NUM > 1
+  {
+    ASSIST_DEBUG_CORE_1_MONTR_ENA_REG,
+    ASSIST_DEBUG_CORE_1_INTR_RAW_REG,
+    ASSIST_DEBUG_CORE_1_INTR_ENA_REG,
+    ASSIST_DEBUG_CORE_1_INTR_CLR_REG,
+    ASSIST_DEBUG_CORE_1_AREA_PC_REG,
+    {
+      ASSIST_DEBUG_CORE_1_AREA_DRAM0_0_MIN_REG,
+      ASSIST_DEBUG_CORE_1_AREA_DRAM0_1_MIN_REG
+    },
+    {
+      ASSIST_DEBUG_CORE_1_AREA_DRAM0_0_MAX_REG,
+      ASSIST_DEBUG_CORE_1_AREA_DRAM0_1_MAX_REG
+    }
+  },
+#endif
+};
+
+static const size_t WATCH_CORES = sizeof(watchCores) / sizeof(watchCores[0]);
+
+// Bit positions are the same in both cores' registers.
+static DRAM_ATTR const uint32_t enableBits[WATCH_SLOTS] = {
+  ASSIST_DEBUG_CORE_0_AREA_DRAM0_0_WR_ENA,
+  ASSIST_DEBUG_CORE_0_AREA_DRAM0_1_WR_ENA
+};
+
+static DRAM_ATTR const uint32_t rawBits[WATCH_SLOTS] = {
+  ASSIST_DEBUG_CORE_0_AREA_DRAM0_0_WR_RAW,
+  ASSIST_DEBUG_CORE_0_AREA_DRAM0_1_WR_RAW
+};
+
+static DRAM_ATTR const uint32_t interruptBits[WATCH_SLOTS] = {
+  ASSIST_DEBUG_CORE_0_AREA_DRAM0_0_WR_INTR_ENA,
+  ASSIST_DEBUG_CORE_0_AREA_DRAM0_1_WR_INTR_ENA
+};
+
+static DRAM_ATTR const uint32_t clearBits[WATCH_SLOTS] = {
+  ASSIST_DEBUG_CORE_0_AREA_DRAM0_0_WR_CLR,
+  ASSIST_DEBUG_CORE_0_AREA_DRAM0_1_WR_CLR
+};
+
+/* --------------------------------------------------------------------------
+   Watch state
+   -------------------------------------------------------------------------- */
+
+struct WatchSlot {
+  const volatile uint32_t* address;
+  uint16_t probeIndex;
+  bool armed;
+  volatile bool suspended;
+};
+
+struct WatchEvent {
+  int64_t timeUs;
+  uint32_t value;
+  uint32_t pc;
+  uint8_t slot;
+  uint8_t core;
+};
+
+static WatchSlot watchSlots[WATCH_SLOTS];
+
+// Single-producer ring: the interrupt is allocated on one core and is the
+// only writer of watchHead.
+static WatchEvent watchEvents[ESP32_LIVE_WATCH_EVENTS];
+static volatile uint32_t watchHead = 0;
+static volatile uint32_t watchTail = 0;
+static std::atomic<uint32_t> watchDropped{0};
+
+static intr_handle_t watchInterrupt = nullptr;
+
+// Serializes read-modify-writes of the interrupt enable registers between
+// the interrupt, which suspends slots, and the tasks that arm and resume
+// them.
+static portMUX_TYPE watchMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR setSlotInterrupt(size_t slot, bool enabled) {
+  portENTER_CRITICAL_SAFE(&watchMux);
+
+  for (size_t core = 0; core < WATCH_CORES; ++core) {
+    const WatchCoreRegs& regs = watchCores[core];
+
+    if (enabled) {
+      REG_WRITE(regs.clear, clearBits[slot]);
+      REG_SET_BIT(regs.interruptEnable, interruptBits[slot]);
+    } else {
+      REG_CLR_BIT(regs.interruptEnable, interruptBits[slot]);
+    }
+  }
+
+  portEXIT_CRITICAL_SAFE(&watchMux);
+}
+
+// A full queue suspends the slot instead of dropping events one by one, so a
+// variable written in a tight loop cannot turn into an interrupt storm. The
+// task resumes the slot after draining the queue.
+static void IRAM_ATTR watchIsr(void*) {
+  for (size_t core = 0; core < WATCH_CORES; ++core) {
+    const WatchCoreRegs& regs = watchCores[core];
+    const uint32_t raw = REG_READ(regs.raw);
+
+    for (size_t slot = 0; slot < WATCH_SLOTS; ++slot) {
+      if ((raw & rawBits[slot]) == 0) {
+        continue;
+      }
+
+      const uint32_t pc = REG_READ(regs.pc);
+      REG_WRITE(regs.clear, clearBits[slot]);
+
+      const WatchSlot& watched = watchSlots[slot];
+      if (!watched.armed) {
+        continue;
+      }
+
+      const uint32_t head = watchHead;
+      if (head - watchTail >= ESP32_LIVE_WATCH_EVENTS) {
+        watchDropped.fetch_add(1, std::memory_order_relaxed);
+        watchSlots[slot].suspended = true;
+        setSlotInterrupt(slot, false);
+        continue;
+      }
+
+      WatchEvent& event = watchEvents[head % ESP32_LIVE_WATCH_EVENTS];
+      event.timeUs = esp_timer_get_time();
+      event.value = *watched.address;
+      event.pc = pc;
+      event.slot = static_cast<uint8_t>(slot);
+      event.core = static_cast<uint8_t>(core);
+
+      watchHead = head + 1;
+    }
+  }
+}
+
+static void armSlot(size_t slot, uintptr_t address) {
+  for (size_t core = 0; core < WATCH_CORES; ++core) {
+    const WatchCoreRegs& regs = watchCores[core];
+
+    REG_WRITE(regs.min[slot], address);
+    REG_WRITE(regs.max[slot], address + sizeof(uint32_t) - 1);
+    REG_SET_BIT(regs.enable, enableBits[slot]);
+  }
+
+  setSlotInterrupt(slot, true);
+}
+
+static void disarmSlot(size_t slot) {
+  setSlotInterrupt(slot, false);
+
+  for (size_t core = 0; core < WATCH_CORES; ++core) {
+    REG_CLR_BIT(watchCores[core].enable, enableBits[slot]);
+  }
+}
+
+static int findSlot(uint16_t probeIndex) {
+  for (size_t slot = 0; slot < WATCH_SLOTS; ++slot) {
+    if (watchSlots[slot].armed &&
+        watchSlots[slot].probeIndex == probeIndex) {
+      return static_cast<int>(slot);
+    }
+  }
+  return -1;
+}
+
+/* --------------------------------------------------------------------------
+   Event transmission
+   -------------------------------------------------------------------------- */
+
+void liveWatchService() {
+  uint32_t tail = watchTail;
+
+  if (tail == watchHead &&
+      watchDropped.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+
+  // Event times are esp_timer based; shift them onto the library clock.
+  const int64_t offsetMs =
+      static_cast<int64_t>(liveNowMs()) - esp_timer_get_time() / 1000;
+
+  while (tail != watchHead) {
+    const WatchEvent& event = watchEvents[tail % ESP32_LIVE_WATCH_EVENTS];
+    const WatchSlot& watched = watchSlots[event.slot];
+
+#if ARDUINOJSON_VERSION_MAJOR >= 7
+    JsonDocument document;
+#else
+    StaticJsonDocument<384> document;
+#endif
+
+    char pc[12];
+    snprintf(pc, sizeof(pc), "0x%08lx", static_cast<unsigned long>(event.pc));
+
+    LiveValue value;
+    value.i = static_cast<int32_t>(event.value);
+
+    JsonObject object = document.to<JsonObject>();
+    object["ver"] = ESP32_LIVE_VERSION;
+    object["event"] = "write";
+    object["timestamp"] = event.timeUs / 1000 + offsetMs;
+    object["pc"] = pc;
+    object["core"] = event.core;
+
+    // Drops counted by the interrupt meanwhile go out with the next event.
+    const uint32_t dropped =
+        watchDropped.exchange(0, std::memory_order_relaxed);
+    if (dropped != 0) {
+      object["dropped"] = dropped;
+    }
+
+    jsonAddProbeValue(
+        object.createNestedObject("pin"),
+        pins[watched.probeIndex],
+        value);
+
+    // Events are live data; without a subscriber they are discarded.
+    liveSendEvent(object);
+
+    ++tail;
+    watchTail = tail;
+  }
+
+  for (size_t slot = 0; slot < WATCH_SLOTS; ++slot) {
+    if (watchSlots[slot].armed && watchSlots[slot].suspended) {
+      watchSlots[slot].suspended = false;
+      setSlotInterrupt(slot, true);
+    }
+  }
+}
+
+/* --------------------------------------------------------------------------
+   Public API
+   -------------------------------------------------------------------------- */
+
+bool esp32_live_watch(uint16_t n) {
+  if (n > 255) {
+    return false;
+  }
+
+  const int index = liveFindProbeIndex(static_cast<uint8_t>(n));
+  if (index < 0 || !pins[index].hasPtr) {
+    return false;
+  }
+
+  const uint16_t probeIndex = static_cast<uint16_t>(index);
+  if (findSlot(probeIndex) >= 0) {
+    return true;
+  }
+
+  const volatile float* variable = pins[index].ptr;
+  if (!esp_ptr_in_dram(const_cast<const float*>(variable))) {
+    return false;
+  }
+
+  int freeSlot = -1;
+  for (size_t slot = 0; slot < WATCH_SLOTS; ++slot) {
+    if (!watchSlots[slot].armed) {
+      freeSlot = static_cast<int>(slot);
+      break;
+    }
+  }
+
+  if (freeSlot < 0) {
+    return false;
+  }
+
+  if (watchInterrupt == nullptr) {
+    periph_module_enable(PERIPH_ASSIST_DEBUG_MODULE);
+
+    if (esp_intr_alloc(
+            ETS_ASSIST_DEBUG_INTR_SOURCE,
+            ESP_INTR_FLAG_IRAM,
+            watchIsr,
+            nullptr,
+            &watchInterrupt) != ESP_OK) {
+      watchInterrupt = nullptr;
+      return false;
+    }
+  }
+
+  WatchSlot& watched = watchSlots[freeSlot];
+  watched.address = reinterpret_cast<const volatile uint32_t*>(variable);
+  watched.probeIndex = probeIndex;
+  watched.suspended = false;
+  watched.armed = true;
+
+  armSlot(freeSlot, reinterpret_cast<uintptr_t>(variable));
+  return true;
+}
+
+void esp32_live_unwatch(uint16_t n) {
+  if (n > 255) {
+    return;
+  }
+
+  const int index = liveFindProbeIndex(static_cast<uint8_t>(n));
+  if (index < 0) {
+    return;
+  }
+
+  const int slot = findSlot(static_cast<uint16_t>(index));
+  if (slot < 0) {
+    return;
+  }
+
+  disarmSlot(slot);
+  watchSlots[slot].armed = false;
+}
+
+#else
+
+void liveWatchService() {}
+
+bool esp32_live_watch(uint16_t) {
+  return false;
+}
+
+void esp32_live_unwatch(uint16_t) {}
+
+#endif